@@ -0,0 +1,148 @@
+#include "bench_report.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void bench_report_add(BenchReport* report, const char* name, const char* unit, double value, bool higher_is_better) {
+    if (report->count == BENCH_MAX_RESULTS) {
+        fprintf(stderr, "Warning: too many benchmark results, '%s' dropped\n", name);
+        return;
+    }
+    BenchResult* result = &report->results[report->count++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->unit, sizeof(result->unit), "%s", unit);
+    result->value = value;
+    result->higher_is_better = higher_is_better;
+    printf("%-44s %14.2f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+bool bench_report_write(const BenchReport* report, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error opening benchmark results file");
+        return false;
+    }
+    fprintf(file, "{\n  \"suite\": \"%s\",\n  \"results\": [\n", report->suite);
+    for (int i = 0; i < report->count; i++) {
+        const BenchResult* r = &report->results[i];
+        fprintf(file, "    { \"name\": \"%s\", \"unit\": \"%s\", \"value\": %.6g, \"higher_is_better\": %s }%s\n",
+                r->name, r->unit, r->value, r->higher_is_better ? "true" : "false",
+                (i + 1 < report->count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    if (fclose(file) != 0) {
+        perror("Error writing benchmark results file");
+        return false;
+    }
+    return true;
+}
+
+// --- Baseline Comparison ---
+
+/**
+ * Reads a whole file into a NUL-terminated buffer (caller frees).
+ */
+static char* read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        perror("Error opening benchmark baseline");
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (size >= 0) ? (char*)malloc((size_t)size + 1) : NULL;
+    if (text == NULL || fread(text, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "Error: cannot read benchmark baseline '%s'\n", path);
+        free(text);
+        fclose(file);
+        return NULL;
+    }
+    text[size] = '\0';
+    fclose(file);
+    return text;
+}
+
+/**
+ * Finds the value recorded for name in a baseline written by bench_report_write.
+ */
+static bool find_baseline_value(const char* text, const char* name, double* value) {
+    char key[BENCH_NAME_LENGTH + 16];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    const char* entry = strstr(text, key);
+    if (entry == NULL) {
+        return false;
+    }
+    const char* end = strchr(entry, '}');
+    const char* field = strstr(entry, "\"value\":");
+    if (field == NULL || (end != NULL && field > end)) {
+        return false;
+    }
+    char* parsed_end;
+    *value = strtod(field + strlen("\"value\":"), &parsed_end);
+    return parsed_end != field + strlen("\"value\":");
+}
+
+int bench_report_compare(const BenchReport* report, const char* baseline_path, double tolerance) {
+    char* text = read_file(baseline_path);
+    if (text == NULL) {
+        return -1;
+    }
+
+    printf("\nComparison with %s (regression: worse by more than %.0f%%)\n", baseline_path, tolerance * 100.0);
+    printf("%-44s %14s %14s %9s\n", "benchmark", "baseline", "current", "change");
+    int regressions = 0;
+    for (int i = 0; i < report->count; i++) {
+        const BenchResult* r = &report->results[i];
+        double baseline;
+        if (!find_baseline_value(text, r->name, &baseline)) {
+            printf("%-44s %14s %14.2f %9s\n", r->name, "-", r->value, "new");
+            continue;
+        }
+        double change = (baseline != 0.0) ? (r->value - baseline) / baseline : 0.0;
+        double worsening = r->higher_is_better ? -change : change;
+        bool regressed = worsening > tolerance;
+        regressions += regressed;
+        printf("%-44s %14.2f %14.2f %+8.1f%%%s\n", r->name, baseline, r->value, change * 100.0,
+               regressed ? "  REGRESSION" : "");
+    }
+    free(text);
+    return regressions;
+}
+
+// --- Command Line ---
+
+bool bench_parse_common_option(int argc, char* argv[], int* i, const char** json_path,
+                               const char** baseline_path, double* tolerance) {
+    if (*i + 1 >= argc) {
+        return false;
+    }
+    if (strcmp(argv[*i], "--json") == 0) {
+        *json_path = argv[++*i];
+    } else if (strcmp(argv[*i], "--baseline") == 0) {
+        *baseline_path = argv[++*i];
+    } else if (strcmp(argv[*i], "--tolerance") == 0) {
+        *tolerance = atof(argv[++*i]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int bench_report_finish(const BenchReport* report, const char* json_path, const char* baseline_path, double tolerance) {
+    if (json_path != NULL) {
+        if (!bench_report_write(report, json_path)) {
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    if (baseline_path != NULL) {
+        int regressions = bench_report_compare(report, baseline_path, tolerance);
+        if (regressions != 0) {
+            if (regressions > 0) printf("%d regression(s) against %s\n", regressions, baseline_path);
+            return 1;
+        }
+    }
+    return 0;
+}
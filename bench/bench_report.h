@@ -0,0 +1,63 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <stdbool.h>
+
+// --- Benchmark Results: JSON output and baseline comparison ---
+
+#define BENCH_MAX_RESULTS 256
+#define BENCH_NAME_LENGTH 96
+#define DEFAULT_BENCH_TOLERANCE 0.10 // Relative change counted as a regression
+
+/**
+ * @brief One measured value.
+ */
+typedef struct {
+    char name[BENCH_NAME_LENGTH];  // Unique within a suite, e.g. "score/T=100"
+    char unit[16];                 // e.g. "ns/op", "points/s"
+    double value;
+    bool higher_is_better;         // Throughputs; latencies are lower-is-better
+} BenchResult;
+
+/**
+ * @brief The results of one benchmark suite.
+ */
+typedef struct {
+    const char* suite;
+    BenchResult results[BENCH_MAX_RESULTS];
+    int count;
+} BenchReport;
+
+/**
+ * @brief Records a result (also echoed to stdout as a table row).
+ */
+void bench_report_add(BenchReport* report, const char* name, const char* unit, double value, bool higher_is_better);
+
+/**
+ * @brief Writes the report as JSON: {"suite": ..., "results": [{"name", "unit", "value", "higher_is_better"}]}.
+ * @return false (with a message) on I/O failure.
+ */
+bool bench_report_write(const BenchReport* report, const char* path);
+
+/**
+ * @brief Compares the report against a baseline written by bench_report_write and prints
+ * the relative change of every result present in both.
+ * @param tolerance Relative worsening above which a result counts as a regression.
+ * @return The number of regressions, or -1 if the baseline cannot be read.
+ */
+int bench_report_compare(const BenchReport* report, const char* baseline_path, double tolerance);
+
+/**
+ * @brief Handles the options shared by all suites: --json FILE, --baseline FILE, --tolerance X.
+ * @return true if argv[*i] was one of them (*i is advanced past its value).
+ */
+bool bench_parse_common_option(int argc, char* argv[], int* i, const char** json_path,
+                               const char** baseline_path, double* tolerance);
+
+/**
+ * @brief Writes and compares the report as requested on the command line.
+ * @return The process exit status: 0, or 1 on I/O failure or regressions.
+ */
+int bench_report_finish(const BenchReport* report, const char* json_path, const char* baseline_path, double tolerance);
+
+#endif // BENCH_REPORT_H
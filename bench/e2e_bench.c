@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L // For mkstemp, dup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "core_ds.h"
+#include "iforest.h"
+#include "stream_manager.h"
+#include "stream_reader.h"
+#include "config.h"
+#include "utils.h"
+#include "thread_pool.h"
+#include "rng.h"
+#include "bench_report.h"
+#include "synthetic_stream.h"
+
+// --- End-to-End Replay Benchmark ---
+//
+// Generates a seeded synthetic stream (dimensions, anomaly rate and drift points are
+// configurable), writes it as CSV and replays it through the real pipeline:
+// process_stream in each update mode, score_stream_offline and, as the alternative
+// model, process_hst_stream. The per-point output
+// is captured in a temporary file, so the timings include formatting and writing it,
+// and is then checked against the injected anomalies.
+
+#define ROLLING_BENCH_TREES 10
+
+typedef struct {
+    const char* name;
+    bool offline;
+    int rolling_trees;
+    int async_retrain;
+    int pipeline;
+    bool half_space_trees;
+} ReplayMode;
+
+static const ReplayMode replay_modes[] = {
+    { "online/full_retrain", false, 0, 0, 0, false },
+    { "online/rolling_k=10", false, ROLLING_BENCH_TREES, 0, 0, false },
+    { "online/async", false, 0, 1, 0, false },
+    { "online/pipeline", false, 0, 0, 1, false },
+    { "online/hst", false, 0, 0, 0, true },
+    { "offline", true, 0, 0, 0, false },
+};
+
+typedef struct {
+    double seconds;
+    long scored;            // Points with a score line
+    long true_positives;    // Injected anomalies flagged
+    long false_positives;
+    long anomalies;         // Injected anomalies among the scored points
+} ReplayResult;
+
+/**
+ * Matches the captured "Point N: Score=S (ANOMALY|Normal)" lines against the labels.
+ */
+static void check_output(const char* path, const unsigned char* labels, int points, ReplayResult* result) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Error reading captured output");
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int index;
+        double score;
+        char verdict[16];
+        if (sscanf(line, "Point %d: Score=%lf (%15[A-Za-z])", &index, &score, verdict) != 3 ||
+            index < 0 || index >= points) {
+            continue;
+        }
+        bool flagged = strcmp(verdict, "ANOMALY") == 0;
+        result->scored++;
+        result->anomalies += labels[index];
+        result->true_positives += flagged && labels[index];
+        result->false_positives += flagged && !labels[index];
+    }
+    fclose(file);
+}
+
+/**
+ * Replays the stream file through one mode with stdout captured in output_path.
+ */
+static ReplayResult replay(const ReplayMode* mode, IForestConfig config, ThreadPool* pool,
+                           const char* stream_path, const char* output_path, int points) {
+    ReplayResult result;
+    memset(&result, 0, sizeof(result));
+    config.rolling_trees = mode->rolling_trees;
+    config.async_retrain = mode->async_retrain;
+    config.pipeline = mode->pipeline;
+
+    IsolationForest* forest = create_forest(&config);
+    HalfSpaceForest* hs_forest = mode->half_space_trees ? hst_create(&config) : NULL;
+    SlidingWindow* sw = create_sliding_window(&config);
+    if (forest == NULL || sw == NULL || (mode->half_space_trees && hs_forest == NULL) || !open_stream(stream_path)) {
+        fprintf(stderr, "Fatal error: cannot set up replay '%s'.\n", mode->name);
+        exit(1);
+    }
+    forest->pool = pool;
+    set_stream_num_features(config.num_features);
+    initialize_rng(12345u); // Same tree seeds in every run
+
+    // Capture the per-point output; the pipeline writes it exactly as in production
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int output = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (saved_stdout < 0 || output < 0 || dup2(output, STDOUT_FILENO) < 0) {
+        perror("Error redirecting replay output");
+        exit(1);
+    }
+    close(output);
+
+    double start = now_seconds();
+    if (mode->offline) {
+        score_stream_offline(forest, sw, points + 1);
+    } else if (mode->half_space_trees) {
+        process_hst_stream(hs_forest, sw, &config, points + 1);
+    } else {
+        process_stream(forest, sw, &config, points + 1);
+    }
+    fflush(stdout);
+    result.seconds = now_seconds() - start;
+
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    destroy_sliding_window(sw);
+    free_forest(forest);
+    hst_destroy(hs_forest);
+    return result;
+}
+
+/**
+ * Throughput of the CSV reader alone over the same file.
+ */
+static double parse_points_per_second(const char* stream_path, int num_features) {
+    StreamReader* reader = stream_reader_open(stream_path);
+    double* row = (double*)malloc(sizeof(double) * (size_t)num_features);
+    if (reader == NULL || row == NULL) {
+        fprintf(stderr, "Fatal error: cannot open '%s' for parsing.\n", stream_path);
+        exit(1);
+    }
+    long rows = 0;
+    double start = now_seconds();
+    while (stream_reader_next(reader, row, num_features) != READ_EOF) {
+        rows++;
+    }
+    double elapsed = now_seconds() - start;
+    stream_reader_close(reader);
+    free(row);
+    return (elapsed > 0.0) ? (double)rows / elapsed : 0.0;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --points N         Stream length (default 20000)\n"
+            "  --features N       Dimensions (default 16)\n"
+            "  --anomaly-rate X   Fraction of injected anomalies (default 0.01)\n"
+            "  --drift-period N   A drift every N points (default 2500, 0 = none)\n"
+            "  --drift-at LIST    Drifts at these positions instead, e.g. 5000,12000\n"
+            "  --seed N           Generator seed (default 42)\n"
+            "  --stream-file FILE Keep the generated CSV at FILE\n"
+            "  --json FILE        Write the results as JSON\n"
+            "  --baseline FILE    Compare against a previous --json file\n"
+            "  --tolerance X      Relative worsening counted as a regression (default %.2f)\n",
+            program, DEFAULT_BENCH_TOLERANCE);
+}
+
+int main(int argc, char* argv[]) {
+    SyntheticStreamConfig shape;
+    synthetic_stream_defaults(&shape);
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    const char* stream_file = NULL;
+    double tolerance = DEFAULT_BENCH_TOLERANCE;
+    bool args_ok = true;
+    for (int i = 1; i < argc && args_ok; i++) {
+        if (bench_parse_common_option(argc, argv, &i, &json_path, &baseline_path, &tolerance)) {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            args_ok = false;
+        } else if (strcmp(argv[i], "--points") == 0) {
+            shape.points = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--features") == 0) {
+            shape.num_features = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--anomaly-rate") == 0) {
+            shape.anomaly_rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--drift-period") == 0) {
+            shape.drift_period = atoi(argv[++i]);
+            shape.num_drift_points = 0;
+        } else if (strcmp(argv[i], "--drift-at") == 0) {
+            args_ok = synthetic_stream_parse_drifts(&shape, argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            shape.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--stream-file") == 0) {
+            stream_file = argv[++i];
+        } else {
+            args_ok = false;
+        }
+    }
+
+    IForestConfig config;
+    init_default_config(&config);
+    config.num_features = shape.num_features;
+    if (!args_ok || shape.drift_period < 0 || shape.anomaly_rate < 0.0 || shape.anomaly_rate > 1.0 ||
+        !validate_config(&config) || shape.points <= config.window_size) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 1. Generate the stream and write it where the pipeline can read it
+    double* data = (double*)malloc(sizeof(double) * (size_t)shape.points * (size_t)shape.num_features);
+    unsigned char* labels = (unsigned char*)malloc((size_t)shape.points);
+    ThreadPool* pool = thread_pool_create(thread_pool_default_size());
+    if (data == NULL || labels == NULL || pool == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        return 1;
+    }
+    generate_synthetic_stream(&shape, data, labels);
+
+    char stream_path[] = "/tmp/iforest_e2e_stream_XXXXXX";
+    char output_path[] = "/tmp/iforest_e2e_output_XXXXXX";
+    int stream_fd = (stream_file == NULL) ? mkstemp(stream_path) : -1;
+    int output_fd = mkstemp(output_path);
+    if ((stream_file == NULL && stream_fd < 0) || output_fd < 0) {
+        perror("Error creating temporary files");
+        return 1;
+    }
+    if (stream_fd >= 0) close(stream_fd);
+    close(output_fd);
+    const char* path = (stream_file != NULL) ? stream_file : stream_path;
+    if (!write_synthetic_csv(path, data, shape.points, shape.num_features)) {
+        return 1;
+    }
+
+    printf("End-to-end replay, %d points, D=%d, anomaly rate %.3f, ", shape.points, shape.num_features, shape.anomaly_rate);
+    if (shape.drift_period > 0) printf("drift every %d points", shape.drift_period);
+    else printf("%d drift points", shape.num_drift_points);
+    printf(", seed %llu, %d threads\n", (unsigned long long)shape.seed, thread_pool_size(pool));
+
+    // 2. Replay each mode and check its verdicts against the injected anomalies
+    static BenchReport report;
+    report.suite = "e2e";
+    char name[BENCH_NAME_LENGTH];
+    bench_report_add(&report, "parse/csv", "points/s", parse_points_per_second(path, shape.num_features), true);
+    for (size_t m = 0; m < sizeof(replay_modes) / sizeof(replay_modes[0]); m++) {
+        const ReplayMode* mode = &replay_modes[m];
+        ReplayResult result = replay(mode, config, pool, path, output_path, shape.points);
+        check_output(output_path, labels, shape.points, &result);
+
+        snprintf(name, sizeof(name), "%s/throughput", mode->name);
+        bench_report_add(&report, name, "points/s", shape.points / result.seconds, true);
+        snprintf(name, sizeof(name), "%s/recall", mode->name);
+        bench_report_add(&report, name, "ratio",
+                         (result.anomalies > 0) ? (double)result.true_positives / result.anomalies : 0.0, true);
+        long flagged = result.true_positives + result.false_positives;
+        snprintf(name, sizeof(name), "%s/precision", mode->name);
+        bench_report_add(&report, name, "ratio", (flagged > 0) ? (double)result.true_positives / flagged : 0.0, true);
+    }
+
+    if (stream_file == NULL) remove(stream_path);
+    remove(output_path);
+    thread_pool_destroy(pool);
+    free(data);
+    free(labels);
+    return bench_report_finish(&report, json_path, baseline_path, tolerance);
+}
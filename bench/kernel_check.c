@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core_ds.h"
+#include "iforest.h"
+#include "config.h"
+#include "score_kernels.h"
+#include "synthetic_stream.h"
+
+// --- Scoring Kernel Equivalence Check ---
+//
+// Trains seeded forests on a stream (the sample data by default) at tree depths from 2
+// to 13, so both the depth-unrolled kernels (4..12) and the generic kernels run, and
+// scores every point with calculate_score_batch under each kernel the CPU supports.
+// Every score must be bit-identical to the scalar path, and every classify_batch
+// decision must equal score >= threshold; any difference fails the run (make check
+// builds and runs this for the double and the float32 storage).
+
+#define CHECK_SEED 12345u
+#define CHECK_TREES 100
+
+// psi = 4 and 8 (depths 2, 3) and 5000 (depth 13) use the generic kernels
+static const int check_sample_sizes[] = { 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 5000 };
+
+static const ScoreKernelType check_kernels[] = { SCORE_KERNEL_AVX2, SCORE_KERNEL_AVX512 };
+static const char* const check_kernel_names[] = { "avx2", "avx512" };
+
+/**
+ * Returns the index of the first early-terminated decision that disagrees with the
+ * exact score, or -1 if none does.
+ */
+static int first_wrong_decision(const IsolationForest* forest, const DataPoint* pts, const double* expected,
+                                bool* decisions, int n) {
+    classify_batch(forest, pts, n, forest->sample_size, DEFAULT_ANOMALY_THRESHOLD, decisions);
+    for (int i = 0; i < n; i++) {
+        if (decisions[i] != (expected[i] >= DEFAULT_ANOMALY_THRESHOLD)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Returns the index of the first score that differs bit for bit, or -1 if none does.
+ */
+static int first_difference(const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (memcmp(&a[i], &b[i], sizeof(double)) != 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* stream_path = (argc > 1) ? argv[1] : "data/stream_data.csv";
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [stream file (default data/stream_data.csv)]\n", argv[0]);
+        return 1;
+    }
+
+    // 1. The stream, repeated until it covers the largest sample
+    int num_features = 0, points = 0;
+    double* values = read_stream_file(stream_path, &num_features, &points);
+    int max_sample = check_sample_sizes[sizeof(check_sample_sizes) / sizeof(check_sample_sizes[0]) - 1];
+    if (values == NULL || points < 1) {
+        fprintf(stderr, "Error: cannot read points from '%s'.\n", stream_path);
+        return 1;
+    }
+    int n = (points > max_sample) ? points : max_sample;
+    double* tiled = (double*)malloc(sizeof(double) * (size_t)n * (size_t)num_features);
+    if (tiled == NULL) {
+        fprintf(stderr, "Fatal error: check allocation failed.\n");
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        memcpy(tiled + (size_t)i * num_features, values + (size_t)(i % points) * num_features,
+               sizeof(double) * (size_t)num_features);
+    }
+    feature_t* data = copy_as_features(tiled, (size_t)n * num_features);
+    feature_t* column_data = copy_as_columns(tiled, n, num_features);
+    DataPoint* view = (DataPoint*)malloc(sizeof(DataPoint) * (size_t)n);
+    double* expected = (double*)malloc(sizeof(double) * (size_t)n);
+    double* scores = (double*)malloc(sizeof(double) * (size_t)n);
+    bool* decisions = (bool*)malloc(sizeof(bool) * (size_t)n);
+    if (data == NULL || column_data == NULL || view == NULL || expected == NULL || scores == NULL || decisions == NULL) {
+        fprintf(stderr, "Fatal error: check allocation failed.\n");
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        view[i].features = data + (size_t)i * num_features;
+    }
+    FeatureColumns columns = { column_data, (size_t)n };
+
+    const char* precision = (sizeof(feature_t) == sizeof(float)) ? "float32" : "double";
+    printf("Kernel check (%s): %d points (%d read from %s), D=%d, T=%d\n",
+           precision, n, points, stream_path, num_features, CHECK_TREES);
+
+    // 2. Per depth: the scalar scores are the reference for every other kernel
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(check_sample_sizes) / sizeof(check_sample_sizes[0]); s++) {
+        IForestConfig config;
+        init_default_config(&config);
+        config.num_features = num_features;
+        config.num_trees = CHECK_TREES;
+        config.window_size = check_sample_sizes[s];
+        config.sample_size = check_sample_sizes[s];
+        IsolationForest* forest = create_forest(&config);
+        if (!validate_config(&config) || forest == NULL) {
+            fprintf(stderr, "Fatal error: cannot create a forest with psi=%d.\n", config.sample_size);
+            return 1;
+        }
+        train_iforest_seeded(forest, &columns, config.window_size, CHECK_SEED);
+
+        select_score_kernel(SCORE_KERNEL_SCALAR);
+        calculate_score_batch(forest, view, n, forest->sample_size, expected);
+        printf("  depth %2d (psi=%4d):", forest->max_depth, config.sample_size);
+        int wrong = first_wrong_decision(forest, view, expected, decisions, n);
+        if (wrong < 0) {
+            printf(" classify ok");
+        } else {
+            printf(" classify WRONG at point %d (score %.17g)", wrong, expected[wrong]);
+            failures++;
+        }
+        for (size_t k = 0; k < sizeof(check_kernels) / sizeof(check_kernels[0]); k++) {
+            if (!select_score_kernel(check_kernels[k])) {
+                printf(" %s unsupported", check_kernel_names[k]);
+                continue;
+            }
+            calculate_score_batch(forest, view, n, forest->sample_size, scores);
+            int diff = first_difference(expected, scores, n);
+            int wrong_decision = first_wrong_decision(forest, view, expected, decisions, n);
+            if (wrong_decision >= 0) {
+                printf(" %s classify WRONG at point %d", check_kernel_names[k], wrong_decision);
+                failures++;
+            }
+            if (diff < 0) {
+                printf(" %s ok", check_kernel_names[k]);
+            } else {
+                printf(" %s MISMATCH at point %d (%.17g vs scalar %.17g)", check_kernel_names[k], diff,
+                       scores[diff], expected[diff]);
+                failures++;
+            }
+        }
+        printf("\n");
+        free_forest(forest);
+    }
+    select_score_kernel(SCORE_KERNEL_AUTO);
+
+    free(values);
+    free(tiled);
+    free(data);
+    free(column_data);
+    free(view);
+    free(expected);
+    free(scores);
+    free(decisions);
+    if (failures > 0) {
+        printf("FAILED: %d kernel/depth combinations differ from the scalar path\n", failures);
+        return 1;
+    }
+    printf("All kernels match the scalar path bit for bit\n");
+    return 0;
+}
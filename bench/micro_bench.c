@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core_ds.h"
+#include "iforest.h"
+#include "config.h"
+#include "utils.h"
+#include "score_kernels.h"
+#include "adwin.h"
+#include "kswin.h"
+#include "result_sink.h"
+#include "bench_report.h"
+#include "synthetic_stream.h"
+
+// --- Microbenchmarks ---
+//
+// Times the hot functions of the detector in isolation across a few sizes: tree
+// construction, training, single-point, batch and thresholded (early-terminating)
+// scoring (per point and batched), window sampling, random number generation, the two drift detectors and per-point result output. Every result is the median
+// of several timed runs, each long enough to dwarf the clock resolution. Training runs serially (no thread pool), so
+// results are comparable across machines with different core counts.
+
+#define DEFAULT_MIN_RUN_SECONDS 0.05 // Minimum duration of one timed run
+#define TIMED_RUNS 5
+#define BENCH_FEATURES 16
+#define BENCH_WINDOW 2048
+
+typedef void (*BenchFunction)(void* ctx, long iterations);
+
+static double min_run_seconds = DEFAULT_MIN_RUN_SECONDS;
+static volatile double sink; // Keeps benchmarked results alive
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * Calibrates an iteration count that runs for at least min_run_seconds, then returns
+ * the median time per iteration (nanoseconds) over TIMED_RUNS runs.
+ */
+static double time_per_op(BenchFunction function, void* ctx) {
+    long iterations = 1;
+    for (;;) {
+        double start = now_seconds();
+        function(ctx, iterations);
+        double elapsed = now_seconds() - start;
+        if (elapsed >= min_run_seconds) break;
+        iterations = (elapsed > min_run_seconds / 100.0)
+                   ? (long)(iterations * 1.2 * min_run_seconds / elapsed) + 1
+                   : iterations * 10;
+    }
+    double runs[TIMED_RUNS];
+    for (int r = 0; r < TIMED_RUNS; r++) {
+        double start = now_seconds();
+        function(ctx, iterations);
+        runs[r] = (now_seconds() - start) * 1e9 / (double)iterations;
+    }
+    qsort(runs, TIMED_RUNS, sizeof(double), compare_doubles);
+    return runs[TIMED_RUNS / 2];
+}
+
+// --- Fixtures ---
+
+/**
+ * A window of drift-free synthetic points with its DataPoint views and training columns.
+ */
+typedef struct {
+    feature_t* data;
+    DataPoint* points;
+    feature_t* column_data;
+    FeatureColumns columns;
+    int size;
+} BenchWindow;
+
+static BenchWindow make_window(int size, uint64_t seed) {
+    SyntheticStreamConfig shape;
+    synthetic_stream_defaults(&shape);
+    shape.num_features = BENCH_FEATURES;
+    shape.points = size;
+    shape.drift_period = 0;
+    shape.seed = seed;
+
+    BenchWindow window;
+    window.size = size;
+    double* values = (double*)malloc(sizeof(double) * (size_t)size * BENCH_FEATURES);
+    window.points = (DataPoint*)malloc(sizeof(DataPoint) * (size_t)size);
+    if (values == NULL || window.points == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    generate_synthetic_stream(&shape, values, NULL);
+    window.data = copy_as_features(values, (size_t)size * BENCH_FEATURES);
+    window.column_data = copy_as_columns(values, size, BENCH_FEATURES);
+    free(values);
+    if (window.data == NULL || window.column_data == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    for (int i = 0; i < size; i++) {
+        window.points[i].features = window.data + (size_t)i * BENCH_FEATURES;
+    }
+    window.columns.values = window.column_data;
+    window.columns.stride = (size_t)size;
+    return window;
+}
+
+static void free_window(BenchWindow* window) {
+    free(window->data);
+    free(window->points);
+    free(window->column_data);
+}
+
+static IsolationForest* make_forest(int num_trees, int sample_size, const BenchWindow* window) {
+    IForestConfig config;
+    init_default_config(&config);
+    config.num_features = BENCH_FEATURES;
+    config.num_trees = num_trees;
+    config.window_size = window->size;
+    config.sample_size = sample_size;
+    IsolationForest* forest = create_forest(&config);
+    if (forest == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    train_iforest_seeded(forest, &window->columns, window->size, 7);
+    return forest;
+}
+
+// --- Benchmarks ---
+
+typedef struct {
+    IsolationForest* forest;
+    const BenchWindow* window;
+    int* indices;
+    int sample_count;
+    RngState rng;
+    double* scores;
+} ForestContext;
+
+static void bench_build_tree(void* ctx, long iterations) {
+    ForestContext* c = (ForestContext*)ctx;
+    ITree* tree = &c->forest->trees[0];
+    for (long i = 0; i < iterations; i++) {
+        build_iTree(tree, &c->rng, &c->window->columns, BENCH_FEATURES, c->indices, c->sample_count, 0, 0, tree->depth);
+    }
+    sink = tree->nodes[0].value;
+}
+
+static void bench_train(void* ctx, long iterations) {
+    ForestContext* c = (ForestContext*)ctx;
+    for (long i = 0; i < iterations; i++) {
+        train_iforest_seeded(c->forest, &c->window->columns, c->window->size, (uint64_t)i);
+    }
+    sink = c->forest->trees[0].nodes[0].value;
+}
+
+static void bench_score(void* ctx, long iterations) {
+    ForestContext* c = (ForestContext*)ctx;
+    double total = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        total += calculate_score(c->forest, &c->window->points[i % c->window->size], c->forest->sample_size);
+    }
+    sink = total;
+}
+
+static void bench_classify(void* ctx, long iterations) {
+    ForestContext* c = (ForestContext*)ctx;
+    long anomalies = 0;
+    for (long i = 0; i < iterations; i++) {
+        anomalies += classify_point(c->forest, &c->window->points[i % c->window->size], c->forest->sample_size,
+                                    DEFAULT_ANOMALY_THRESHOLD, NULL);
+    }
+    sink = (double)anomalies;
+}
+
+/**
+ * Mean number of trees classify_point walks per window point.
+ */
+static double mean_trees_evaluated(const ForestContext* c) {
+    long total = 0;
+    for (int i = 0; i < c->window->size; i++) {
+        int evaluated = 0;
+        classify_point(c->forest, &c->window->points[i], c->forest->sample_size, DEFAULT_ANOMALY_THRESHOLD, &evaluated);
+        total += evaluated;
+    }
+    return (double)total / (double)c->window->size;
+}
+
+static void bench_score_batch(void* ctx, long iterations) {
+    // One iteration scores the whole window; reported per point by the caller
+    ForestContext* c = (ForestContext*)ctx;
+    for (long i = 0; i < iterations; i++) {
+        calculate_score_batch(c->forest, c->window->points, c->window->size, c->forest->sample_size, c->scores);
+    }
+    sink = c->scores[0];
+}
+
+static void bench_classify_batch(void* ctx, long iterations) {
+    // One iteration classifies the whole window; reported per point by the caller
+    static bool decisions[BENCH_WINDOW];
+    ForestContext* c = (ForestContext*)ctx;
+    for (long i = 0; i < iterations; i++) {
+        classify_batch(c->forest, c->window->points, c->window->size, c->forest->sample_size,
+                       DEFAULT_ANOMALY_THRESHOLD, decisions);
+    }
+    sink = decisions[0];
+}
+
+static void bench_sample(void* ctx, long iterations) {
+    ForestContext* c = (ForestContext*)ctx;
+    int total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += sample_data_stream(&c->rng, c->window->size, c->indices, c->sample_count);
+    }
+    sink = total + c->indices[0];
+}
+
+typedef struct {
+    int capacity;
+    const double* values;
+    int num_values;
+} DetectorContext;
+
+static void bench_adwin(void* ctx, long iterations) {
+    DetectorContext* c = (DetectorContext*)ctx;
+    ADWIN* adw = adwin_create(c->capacity, 0.02);
+    int changes = 0;
+    for (long i = 0; i < iterations; i++) {
+        adwin_add(adw, c->values[i % c->num_values]);
+        changes += adwin_detect_change(adw);
+    }
+    adwin_destroy(adw);
+    sink = changes;
+}
+
+static void bench_kswin(void* ctx, long iterations) {
+    DetectorContext* c = (DetectorContext*)ctx;
+    KSWIN* kswin = kswin_create(c->capacity, c->capacity / 4, 0.05);
+    int changes = 0;
+    for (long i = 0; i < iterations; i++) {
+        kswin_add(kswin, c->values[i % c->num_values]);
+        changes += kswin_detect_change(kswin);
+    }
+    kswin_destroy(kswin);
+    sink = changes;
+}
+
+typedef struct {
+    const double* values;
+    int num_values;
+    SinkFormat format;
+} OutputContext;
+
+static void bench_printf(void* ctx, long iterations) {
+    OutputContext* c = (OutputContext*)ctx;
+    FILE* out = fopen("/dev/null", "w");
+    if (out == NULL) return;
+    for (long i = 0; i < iterations; i++) {
+        double score = c->values[i % c->num_values];
+        fprintf(out, "Point %ld: Score=%.4f (%s)\n", i, score, (score >= DEFAULT_ANOMALY_THRESHOLD) ? "ANOMALY" : "Normal");
+    }
+    fclose(out);
+}
+
+static void bench_result_sink(void* ctx, long iterations) {
+    OutputContext* c = (OutputContext*)ctx;
+    ResultSink* out = result_sink_create("/dev/null", c->format, SINK_VERBOSITY_ALL, false);
+    if (out == NULL) return;
+    for (long i = 0; i < iterations; i++) {
+        double score = c->values[i % c->num_values];
+        result_sink_point(out, 0, i, score, score >= DEFAULT_ANOMALY_THRESHOLD);
+    }
+    result_sink_close(out);
+}
+
+enum { RNG_BLOCK = 1024 }; // Values per call of the bulk generators
+
+typedef struct {
+    RngState rng;
+    double* doubles;
+    int* ints;
+} RngContext;
+
+static void bench_libc_rand(void* ctx, long iterations) {
+    (void)ctx;
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += rand() % DEFAULT_WINDOW_SIZE;
+    }
+    sink = (double)total;
+}
+
+static void bench_rng_integer(void* ctx, long iterations) {
+    RngContext* c = (RngContext*)ctx;
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += rng_integer(&c->rng, 0, DEFAULT_WINDOW_SIZE - 1);
+    }
+    sink = (double)total;
+}
+
+static void bench_rng_uniform(void* ctx, long iterations) {
+    RngContext* c = (RngContext*)ctx;
+    double total = 0.0;
+    for (long i = 0; i < iterations; i++) {
+        total += rng_uniform(&c->rng, -1.0, 1.0);
+    }
+    sink = total;
+}
+
+// Bulk variants: one iteration is one value, generated RNG_BLOCK at a time
+static void bench_rng_fill_integers(void* ctx, long iterations) {
+    RngContext* c = (RngContext*)ctx;
+    for (long i = 0; i < iterations; i += RNG_BLOCK) {
+        rng_fill_integers(&c->rng, c->ints, RNG_BLOCK, 0, DEFAULT_WINDOW_SIZE - 1);
+    }
+    sink = c->ints[0];
+}
+
+static void bench_rng_fill_uniform(void* ctx, long iterations) {
+    RngContext* c = (RngContext*)ctx;
+    for (long i = 0; i < iterations; i += RNG_BLOCK) {
+        rng_fill_uniform(&c->rng, c->doubles, RNG_BLOCK, -1.0, 1.0);
+    }
+    sink = c->doubles[0];
+}
+
+// --- Suite ---
+
+static void run_forest_benchmarks(BenchReport* report) {
+    char name[BENCH_NAME_LENGTH];
+    BenchWindow window = make_window(BENCH_WINDOW, 1);
+    int* indices = (int*)malloc(sizeof(int) * BENCH_WINDOW);
+    if (indices == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+
+    // 1. One tree, from a fixed sample (the build partitions the sample in place)
+    static const int sample_sizes[] = { 64, 256, 1024 };
+    for (size_t s = 0; s < sizeof(sample_sizes) / sizeof(sample_sizes[0]); s++) {
+        ForestContext c = { make_forest(1, sample_sizes[s], &window), &window, indices, 0, { { 0 } }, NULL };
+        rng_seed(&c.rng, 11, 0);
+        c.sample_count = sample_data_stream(&c.rng, window.size, indices, sample_sizes[s]);
+        snprintf(name, sizeof(name), "build_iTree/psi=%d", sample_sizes[s]);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_build_tree, &c), false);
+        free_forest(c.forest);
+    }
+
+    // 2. Whole forest, serial
+    static const int train_windows[] = { 256, 2048 };
+    for (size_t w = 0; w < sizeof(train_windows) / sizeof(train_windows[0]); w++) {
+        BenchWindow train_window = make_window(train_windows[w], 2);
+        ForestContext c = { make_forest(DEFAULT_NUM_TREES, DEFAULT_SAMPLE_SIZE, &train_window), &train_window, NULL, 0, { { 0 } }, NULL };
+        snprintf(name, sizeof(name), "train_iforest/T=%d/psi=%d/W=%d", DEFAULT_NUM_TREES, DEFAULT_SAMPLE_SIZE, train_windows[w]);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_train, &c), false);
+        free_forest(c.forest);
+        free_window(&train_window);
+    }
+
+    // 3. Scoring: one point at a time, and the batch kernel per point
+    double* scores = (double*)malloc(sizeof(double) * BENCH_WINDOW);
+    if (scores == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    static const int tree_counts[] = { 25, 100, 400 };
+    for (size_t t = 0; t < sizeof(tree_counts) / sizeof(tree_counts[0]); t++) {
+        ForestContext c = { make_forest(tree_counts[t], DEFAULT_SAMPLE_SIZE, &window), &window, NULL, 0, { { 0 } }, scores };
+        snprintf(name, sizeof(name), "calculate_score/T=%d", tree_counts[t]);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_score, &c), false);
+        snprintf(name, sizeof(name), "calculate_score_batch/T=%d/%s", tree_counts[t], score_kernel_name());
+        bench_report_add(report, name, "ns/point", time_per_op(bench_score_batch, &c) / window.size, false);
+        snprintf(name, sizeof(name), "classify_point/T=%d", tree_counts[t]);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_classify, &c), false);
+        snprintf(name, sizeof(name), "classify_point/T=%d/trees_evaluated", tree_counts[t]);
+        bench_report_add(report, name, "trees", mean_trees_evaluated(&c), false);
+        snprintf(name, sizeof(name), "classify_batch/T=%d/%s", tree_counts[t], score_kernel_name());
+        bench_report_add(report, name, "ns/point", time_per_op(bench_classify_batch, &c) / window.size, false);
+        free_forest(c.forest);
+    }
+    free(scores);
+
+    // 4. Sampling psi positions from windows of growing size
+    static const int sample_windows[] = { 256, 2048 };
+    for (size_t w = 0; w < sizeof(sample_windows) / sizeof(sample_windows[0]); w++) {
+        BenchWindow view = window;
+        view.size = sample_windows[w];
+        ForestContext c = { NULL, &view, indices, DEFAULT_SAMPLE_SIZE, { { 0 } }, NULL };
+        rng_seed(&c.rng, 13, 0);
+        snprintf(name, sizeof(name), "sample_data_stream/W=%d/psi=%d", sample_windows[w], DEFAULT_SAMPLE_SIZE);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_sample, &c), false);
+    }
+
+    free(indices);
+    free_window(&window);
+}
+
+static void run_rng_benchmarks(BenchReport* report) {
+    RngContext c;
+    rng_seed(&c.rng, 19, 0);
+    c.doubles = (double*)malloc(sizeof(double) * RNG_BLOCK);
+    c.ints = (int*)malloc(sizeof(int) * RNG_BLOCK);
+    if (c.doubles == NULL || c.ints == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    // rand() % W is the generator the detector used before RngState
+    srand(19);
+    bench_report_add(report, "rng/libc_rand_mod", "ns/value", time_per_op(bench_libc_rand, NULL), false);
+    bench_report_add(report, "rng/integer", "ns/value", time_per_op(bench_rng_integer, &c), false);
+    bench_report_add(report, "rng/uniform", "ns/value", time_per_op(bench_rng_uniform, &c), false);
+    bench_report_add(report, "rng/fill_integers", "ns/value", time_per_op(bench_rng_fill_integers, &c), false);
+    bench_report_add(report, "rng/fill_uniform", "ns/value", time_per_op(bench_rng_fill_uniform, &c), false);
+    free(c.doubles);
+    free(c.ints);
+}
+
+static void run_detector_benchmarks(BenchReport* report) {
+    char name[BENCH_NAME_LENGTH];
+
+    // Scores in [0.3, 0.7) with a level shift halfway, so both detectors see changes
+    enum { NUM_VALUES = 8192 };
+    double* values = (double*)malloc(sizeof(double) * NUM_VALUES);
+    if (values == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    RngState rng;
+    rng_seed(&rng, 17, 0);
+    for (int i = 0; i < NUM_VALUES; i++) {
+        values[i] = rng_uniform(&rng, 0.3, 0.6) + ((i >= NUM_VALUES / 2) ? 0.1 : 0.0);
+    }
+
+    static const int adwin_capacities[] = { 128, 512, 2048, 1 << 20 };
+    for (size_t k = 0; k < sizeof(adwin_capacities) / sizeof(adwin_capacities[0]); k++) {
+        DetectorContext c = { adwin_capacities[k], values, NUM_VALUES };
+        snprintf(name, sizeof(name), "adwin_add+detect/capacity=%d", adwin_capacities[k]);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_adwin, &c), false);
+    }
+    static const int kswin_capacities[] = { 100, 200, 800 };
+    for (size_t k = 0; k < sizeof(kswin_capacities) / sizeof(kswin_capacities[0]); k++) {
+        DetectorContext c = { kswin_capacities[k], values, NUM_VALUES };
+        snprintf(name, sizeof(name), "kswin_add+detect/capacity=%d", kswin_capacities[k]);
+        bench_report_add(report, name, "ns/op", time_per_op(bench_kswin, &c), false);
+    }
+
+    // Per-point output of the scores: stdio formatting vs the buffered sink (to /dev/null)
+    OutputContext output = { values, NUM_VALUES, SINK_FORMAT_TEXT };
+    bench_report_add(report, "output/fprintf", "ns/point", time_per_op(bench_printf, &output), false);
+    static const SinkFormat formats[] = { SINK_FORMAT_TEXT, SINK_FORMAT_CSV, SINK_FORMAT_BINARY };
+    static const char* format_names[] = { "text", "csv", "binary" };
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        output.format = formats[f];
+        snprintf(name, sizeof(name), "output/result_sink/%s", format_names[f]);
+        bench_report_add(report, name, "ns/point", time_per_op(bench_result_sink, &output), false);
+    }
+    free(values);
+}
+
+int main(int argc, char* argv[]) {
+    // Usage: micro_bench [--json FILE] [--baseline FILE] [--tolerance X] [--min-time S]
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    double tolerance = DEFAULT_BENCH_TOLERANCE;
+    for (int i = 1; i < argc; i++) {
+        if (bench_parse_common_option(argc, argv, &i, &json_path, &baseline_path, &tolerance)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_run_seconds = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--json FILE] [--baseline FILE] [--tolerance X] [--min-time S]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static BenchReport report;
+    report.suite = "micro";
+    printf("Microbenchmarks, D=%d, scoring kernel %s (median of %d runs)\n", BENCH_FEATURES, score_kernel_name(), TIMED_RUNS);
+    run_forest_benchmarks(&report);
+    run_rng_benchmarks(&report);
+    run_detector_benchmarks(&report);
+    return bench_report_finish(&report, json_path, baseline_path, tolerance);
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core_ds.h"
+#include "config.h"
+#include "utils.h"
+#include "thread_pool.h"
+#include "rng.h"
+#include "stream_engine.h"
+#include "bench_report.h"
+#include "synthetic_stream.h"
+
+// --- Multi-Stream Engine: memory per stream and aggregate throughput ---
+//
+// Generates one seeded synthetic stream per key and interleaves them round-robin,
+// as records of many entities arrive mixed on one feed. The interleaved feed is
+// pushed through a StreamEngine in batches, once per thread count, and the sustained
+// throughput over all streams is reported with the memory each stream holds.
+
+#define DEFAULT_STREAMS 1000
+#define DEFAULT_POINTS_PER_STREAM 1000
+#define BENCH_BATCH_SIZE 4096
+
+int main(int argc, char* argv[]) {
+    // Usage: multi_stream_bench [streams] [points_per_stream] [trees] [window] [sample]
+    IForestConfig config;
+    init_default_config(&config);
+    config.num_features = 16;
+    int streams = (argc > 1) ? atoi(argv[1]) : DEFAULT_STREAMS;
+    int per_stream = (argc > 2) ? atoi(argv[2]) : DEFAULT_POINTS_PER_STREAM;
+    config.num_trees = (argc > 3) ? atoi(argv[3]) : 25;
+    config.window_size = (argc > 4) ? atoi(argv[4]) : 128;
+    config.sample_size = (argc > 5) ? atoi(argv[5]) : 64;
+    if (streams < 1 || per_stream <= config.window_size || !validate_config(&config)) {
+        fprintf(stderr, "Usage: %s [streams] [points_per_stream > W] [trees] [window] [sample]\n", argv[0]);
+        return 1;
+    }
+
+    // Interleaved feed: record i belongs to key i % streams
+    long total = (long)streams * per_stream;
+    double* stream_data = (double*)malloc(sizeof(double) * (size_t)per_stream * config.num_features);
+    feature_t* feed = (feature_t*)malloc(sizeof(feature_t) * (size_t)total * config.num_features);
+    DataPoint* points = (DataPoint*)malloc(sizeof(DataPoint) * BENCH_BATCH_SIZE);
+    uint64_t* keys = (uint64_t*)malloc(sizeof(uint64_t) * BENCH_BATCH_SIZE);
+    StreamRecordResult* results = (StreamRecordResult*)malloc(sizeof(StreamRecordResult) * BENCH_BATCH_SIZE);
+    if (stream_data == NULL || feed == NULL || points == NULL || keys == NULL || results == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        return 1;
+    }
+    SyntheticStreamConfig shape;
+    synthetic_stream_defaults(&shape);
+    shape.num_features = config.num_features;
+    shape.points = per_stream;
+    for (int s = 0; s < streams; s++) {
+        shape.seed = 1000 + (uint64_t)s;
+        generate_synthetic_stream(&shape, stream_data, NULL);
+        for (int p = 0; p < per_stream; p++) {
+            feature_t* row = feed + ((size_t)p * streams + s) * config.num_features;
+            for (int j = 0; j < config.num_features; j++) {
+                row[j] = (feature_t)stream_data[(size_t)p * config.num_features + j];
+            }
+        }
+    }
+    free(stream_data);
+
+    printf("%d streams x %d points, D=%d, T=%d, W=%d, psi=%d\n", streams, per_stream,
+           config.num_features, config.num_trees, config.window_size, config.sample_size);
+    printf("%8s %14s %10s %14s %12s\n", "threads", "points/s", "retrains", "KiB/stream", "total MiB");
+
+    int max_threads = thread_pool_default_size();
+    for (int threads = 1; ; threads *= 2) {
+        // 1, 2, 4, ... threads, ending at the core count
+        if (threads > max_threads) threads = max_threads;
+        ThreadPool* pool = thread_pool_create(threads);
+        StreamEngine* engine = stream_engine_create(&config, pool);
+        if (pool == NULL || engine == NULL) {
+            fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+            return 1;
+        }
+        initialize_rng(12345u); // Same stream seeds for every thread count
+
+        double start = now_seconds();
+        for (long first = 0; first < total; first += BENCH_BATCH_SIZE) {
+            int count = (total - first < BENCH_BATCH_SIZE) ? (int)(total - first) : BENCH_BATCH_SIZE;
+            for (int i = 0; i < count; i++) {
+                keys[i] = (uint64_t)((first + i) % streams);
+                points[i].features = feed + (size_t)(first + i) * config.num_features;
+            }
+            if (stream_engine_process(engine, keys, points, count, results) < 0) {
+                return 1;
+            }
+        }
+        double seconds = now_seconds() - start;
+
+        StreamEngineStats stats = stream_engine_stats(engine);
+        printf("%8d %14.0f %10ld %14.1f %12.1f\n", threads, (double)total / seconds, stats.retrains,
+               (double)stats.stream_bytes / stats.streams / 1024.0,
+               (double)(stats.stream_bytes + stats.engine_bytes) / (1024.0 * 1024.0));
+        stream_engine_destroy(engine);
+        thread_pool_destroy(pool);
+        if (threads == max_threads) break;
+    }
+
+    free(feed);
+    free(points);
+    free(keys);
+    free(results);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "core_ds.h"
+#include "iforest.h"
+#include "config.h"
+#include "utils.h"
+#include "score_kernels.h"
+#include "bench_report.h"
+#include "synthetic_stream.h"
+
+// --- Storage Precision Benchmark ---
+//
+// Trains one seeded forest on the first W points of a stream (the sample data by
+// default) and scores every point, in whatever precision this binary was built with
+// (see feature_t). The double build saves its scores with --write-scores; the float32
+// build (precision_bench_f32, see make bench-precision) reads them with --reference and
+// reports how far its scores and anomaly decisions drift from the double path, next to
+// its scoring throughput and memory footprint.
+
+#define DEFAULT_MIN_RUN_SECONDS 0.2 // Minimum duration of a throughput measurement
+#define TRAIN_SEED 12345u           // Same trees in both builds (up to rounding of split values)
+
+/**
+ * Scores the points repeatedly for at least DEFAULT_MIN_RUN_SECONDS; returns points per second.
+ */
+static double batch_points_per_second(const IsolationForest* forest, const DataPoint* points, int n, double* scores) {
+    long scored = 0;
+    double start = now_seconds(), elapsed;
+    do {
+        calculate_score_batch(forest, points, n, forest->sample_size, scores);
+        scored += n;
+        elapsed = now_seconds() - start;
+    } while (elapsed < DEFAULT_MIN_RUN_SECONDS);
+    return (double)scored / elapsed;
+}
+
+static double single_points_per_second(const IsolationForest* forest, const DataPoint* points, int n) {
+    long scored = 0;
+    double total = 0.0;
+    double start = now_seconds(), elapsed;
+    do {
+        for (int i = 0; i < n; i++) {
+            total += calculate_score(forest, &points[i], forest->sample_size);
+        }
+        scored += n;
+        elapsed = now_seconds() - start;
+    } while (elapsed < DEFAULT_MIN_RUN_SECONDS);
+    if (total < 0.0) printf("%f\n", total); // Keeps the scores alive
+    return (double)scored / elapsed;
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --stream FILE        Stream to train on and score (default data/stream_data.csv)\n"
+            "  --write-scores FILE  Save the scores (raw doubles) as a reference\n"
+            "  --reference FILE     Compare the scores against a reference saved by another build\n"
+            "  --json FILE          Write the results as JSON\n"
+            "  --baseline FILE      Compare against a previous --json file\n"
+            "  --tolerance X        Relative worsening counted as a regression (default %.2f)\n",
+            program, DEFAULT_BENCH_TOLERANCE);
+}
+
+int main(int argc, char* argv[]) {
+    const char* stream_path = "data/stream_data.csv";
+    const char* scores_path = NULL;
+    const char* reference_path = NULL;
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    double tolerance = DEFAULT_BENCH_TOLERANCE;
+    bool args_ok = true;
+    for (int i = 1; i < argc && args_ok; i++) {
+        if (bench_parse_common_option(argc, argv, &i, &json_path, &baseline_path, &tolerance)) {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            args_ok = false;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream_path = argv[++i];
+        } else if (strcmp(argv[i], "--write-scores") == 0) {
+            scores_path = argv[++i];
+        } else if (strcmp(argv[i], "--reference") == 0) {
+            reference_path = argv[++i];
+        } else {
+            args_ok = false;
+        }
+    }
+    if (!args_ok) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 1. The stream, stored as this build stores window points
+    int num_features = 0, points = 0;
+    double* values = read_stream_file(stream_path, &num_features, &points);
+    IForestConfig config;
+    init_default_config(&config);
+    config.num_features = num_features;
+    if (values == NULL || !validate_config(&config) || points <= config.window_size) {
+        fprintf(stderr, "Error: '%s' must hold more than W=%d points.\n", stream_path, config.window_size);
+        return 1;
+    }
+    feature_t* data = copy_as_features(values, (size_t)points * num_features);
+    feature_t* column_data = copy_as_columns(values, points, num_features);
+    DataPoint* view = (DataPoint*)malloc(sizeof(DataPoint) * (size_t)points);
+    double* scores = (double*)malloc(sizeof(double) * (size_t)points);
+    IsolationForest* forest = create_forest(&config);
+    if (data == NULL || column_data == NULL || view == NULL || scores == NULL || forest == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        return 1;
+    }
+    for (int i = 0; i < points; i++) {
+        view[i].features = data + (size_t)i * num_features;
+    }
+
+    const char* precision = (sizeof(feature_t) == sizeof(float)) ? "float32" : "double";
+    printf("Storage precision %s: %d points, D=%d, T=%d, W=%d, psi=%d, scoring kernel %s\n", precision,
+           points, num_features, config.num_trees, config.window_size, config.sample_size, score_kernel_name());
+
+    // 2. One seeded model from the first window, serial so both builds draw the same trees
+    FeatureColumns columns = { column_data, (size_t)points }; // The first W points of each column
+    train_iforest_seeded(forest, &columns, config.window_size, TRAIN_SEED);
+
+    static BenchReport report;
+    report.suite = "precision";
+    char name[BENCH_NAME_LENGTH];
+    snprintf(name, sizeof(name), "score_batch/T=%d", config.num_trees);
+    bench_report_add(&report, name, "points/s", batch_points_per_second(forest, view, points, scores), true);
+    snprintf(name, sizeof(name), "score_single/T=%d", config.num_trees);
+    bench_report_add(&report, name, "points/s", single_points_per_second(forest, view, points), true);
+    bench_report_add(&report, "window_bytes", "bytes",
+                     (double)(sizeof(feature_t) * (size_t)config.window_size * (size_t)num_features), false);
+    bench_report_add(&report, "forest_bytes", "bytes",
+                     (double)(sizeof(Node) * (size_t)forest->nodes_per_tree * (size_t)forest->num_trees), false);
+
+    calculate_score_batch(forest, view, points, forest->sample_size, scores);
+    int flagged = 0;
+    for (int i = 0; i < points; i++) {
+        flagged += scores[i] >= config.anomaly_threshold;
+    }
+    bench_report_add(&report, "anomalies", "points", flagged, false);
+
+    // 3. Scores against the reference build
+    int status = 0;
+    if (scores_path != NULL) {
+        FILE* file = fopen(scores_path, "wb");
+        if (file == NULL || fwrite(scores, sizeof(double), (size_t)points, file) != (size_t)points) {
+            perror("Error writing scores");
+            status = 1;
+        }
+        if (file != NULL) fclose(file);
+    }
+    if (reference_path != NULL) {
+        double* reference = (double*)malloc(sizeof(double) * (size_t)points);
+        FILE* file = fopen(reference_path, "rb");
+        if (reference == NULL || file == NULL || fread(reference, sizeof(double), (size_t)points, file) != (size_t)points) {
+            fprintf(stderr, "Error: cannot read %d reference scores from '%s'.\n", points, reference_path);
+            if (file != NULL) fclose(file);
+            free(reference);
+            return 1;
+        }
+        fclose(file);
+        double total_delta = 0.0, max_delta = 0.0;
+        int flipped = 0;
+        for (int i = 0; i < points; i++) {
+            double delta = fabs(scores[i] - reference[i]);
+            total_delta += delta;
+            if (delta > max_delta) max_delta = delta;
+            flipped += (scores[i] >= config.anomaly_threshold) != (reference[i] >= config.anomaly_threshold);
+        }
+        bench_report_add(&report, "score_delta/mean", "x1e-9", 1e9 * total_delta / points, false);
+        bench_report_add(&report, "score_delta/max", "x1e-9", 1e9 * max_delta, false);
+        bench_report_add(&report, "decisions_flipped", "points", flipped, false);
+        free(reference);
+    }
+
+    free_forest(forest);
+    free(values);
+    free(data);
+    free(column_data);
+    free(view);
+    free(scores);
+    int finish = bench_report_finish(&report, json_path, baseline_path, tolerance);
+    return (status != 0) ? status : finish;
+}
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core_ds.h"
+#include "iforest.h"
+#include "stream_manager.h"
+#include "config.h"
+#include "utils.h"
+#include "thread_pool.h"
+#include "adwin.h"
+#include "kswin.h"
+#include "hstree.h"
+#include "bench_report.h"
+#include "synthetic_stream.h"
+
+// --- Rolling Update vs Full Retrain: per-event latency benchmark ---
+//
+// Replays one synthetic drifting stream through the process_stream event loop
+// (slide, score, drift detection, model update) twice: once retraining the whole
+// forest on every update, once replacing only the k oldest trees. The same stream then
+// goes through the Half-Space Trees loop (process_hst_stream), which never retrains.
+// Reports the latency distribution of a single event (one incoming point) for each.
+
+#define DEFAULT_BENCH_POINTS 20000
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+typedef struct {
+    int updates;
+    double p50, p99, p999, max;   // Event latency (microseconds)
+    double update_mean;           // Mean latency of events that updated the model
+} LatencySummary;
+
+static void summarize_latency(LatencySummary* result, double* latency, int events) {
+    qsort(latency, (size_t)events, sizeof(double), compare_doubles);
+    if (events > 0) {
+        result->p50 = latency[(size_t)(0.50 * (events - 1))];
+        result->p99 = latency[(size_t)(0.99 * (events - 1))];
+        result->p999 = latency[(size_t)(0.999 * (events - 1))];
+        result->max = latency[events - 1];
+    }
+}
+
+/**
+ * Runs the event loop over the stream with the given rolling_trees setting.
+ */
+static LatencySummary run_mode(const IForestConfig* config, ThreadPool* pool, const feature_t* data, int points) {
+    LatencySummary result;
+    memset(&result, 0, sizeof(result));
+    IsolationForest* forest = create_forest(config);
+    SlidingWindow* sw = create_sliding_window(config);
+    double* latency = (double*)malloc(sizeof(double) * (size_t)points);
+    if (forest == NULL || sw == NULL || latency == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+    forest->pool = pool;
+    initialize_rng(12345u); // Same tree seeds for both modes
+
+    ADWIN* adw = adwin_create(512, 0.02);
+    KSWIN* kswin = kswin_create(200, 50, 0.05);
+    int events = 0, since_update = 0;
+    double update_total = 0.0;
+
+    for (int i = 0; i < points; i++) {
+        DataPoint point = { (feature_t*)data + (size_t)i * config->num_features };
+        if (sw->current_size < sw->capacity) {
+            slide_window(sw, &point);
+            if (sw->current_size == sw->capacity) {
+                train_iforest(forest, &sw->columns, sw->capacity);
+                rescore_window(forest, sw);
+            }
+            continue;
+        }
+
+        double start = now_seconds();
+        int slot = slide_window(sw, &point);
+        double score = score_window_slot(forest, sw, slot);
+        adwin_add(adw, score);
+        kswin_add(kswin, score);
+        bool drift = adwin_detect_change(adw);
+        drift = kswin_detect_change(kswin) || drift;
+        drift = drift || evaluate_window_anomaly_rate(sw) > config->desired_anomaly_rate_u;
+        since_update++;
+        bool updated = drift || (config->rolling_interval > 0 && since_update >= config->rolling_interval);
+        if (updated) {
+            if (config->rolling_trees > 0) {
+                rolling_update_window(forest, sw, config->rolling_trees);
+            } else {
+                train_iforest(forest, &sw->columns, sw->capacity);
+                rescore_window(forest, sw);
+            }
+            adwin_destroy(adw);
+            kswin_destroy(kswin);
+            adw = adwin_create(512, 0.02);
+            kswin = kswin_create(200, 50, 0.05);
+            since_update = 0;
+        }
+        double elapsed = (now_seconds() - start) * 1e6;
+
+        latency[events++] = elapsed;
+        if (updated) {
+            result.updates++;
+            update_total += elapsed;
+        }
+    }
+
+    summarize_latency(&result, latency, events);
+    result.update_mean = (result.updates > 0) ? update_total / result.updates : 0.0;
+
+    adwin_destroy(adw);
+    kswin_destroy(kswin);
+    free(latency);
+    destroy_sliding_window(sw);
+    free_forest(forest);
+    return result;
+}
+
+/**
+ * Runs the Half-Space Trees loop over the stream: built once on the first window, then
+ * scored and updated point by point (no drift detection, no updates to report).
+ */
+static LatencySummary run_hst(const IForestConfig* config, const feature_t* data, int points) {
+    LatencySummary result;
+    memset(&result, 0, sizeof(result));
+    HalfSpaceForest* forest = hst_create(config);
+    SlidingWindow* sw = create_sliding_window(config);
+    double* latency = (double*)malloc(sizeof(double) * (size_t)points);
+    if (forest == NULL || sw == NULL || latency == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        exit(1);
+    }
+
+    int events = 0;
+    double total = 0.0;
+    for (int i = 0; i < points; i++) {
+        DataPoint point = { (feature_t*)data + (size_t)i * config->num_features };
+        if (!forest->built) {
+            slide_window(sw, &point);
+            if (sw->current_size == sw->capacity) {
+                hst_build(forest, sw->buffer, sw->capacity, 12345u);
+            }
+            continue;
+        }
+        double start = now_seconds();
+        total += hst_score_and_update(forest, &point);
+        latency[events++] = (now_seconds() - start) * 1e6;
+    }
+    if (total < 0.0) printf("%f\n", total); // Keeps the scores alive
+
+    summarize_latency(&result, latency, events);
+    free(latency);
+    destroy_sliding_window(sw);
+    hst_destroy(forest);
+    return result;
+}
+
+static void print_result(const char* name, const LatencySummary* r) {
+    printf("%-22s %8d %10.1f %10.1f %10.1f %10.1f %12.1f\n",
+           name, r->updates, r->p50, r->p99, r->p999, r->max, r->update_mean);
+}
+
+int main(int argc, char* argv[]) {
+    // Usage: rolling_bench [points] [rolling_trees] [rolling_interval]
+    IForestConfig config;
+    init_default_config(&config);
+    config.num_features = 16;
+    int points = (argc > 1) ? atoi(argv[1]) : DEFAULT_BENCH_POINTS;
+    int rolling_trees = (argc > 2) ? atoi(argv[2]) : 10;
+    config.rolling_interval = (argc > 3) ? atoi(argv[3]) : 0;
+    config.rolling_trees = rolling_trees;
+    if (points <= config.window_size || !validate_config(&config) || rolling_trees < 1) {
+        fprintf(stderr, "Usage: %s [points > W] [rolling_trees >= 1] [rolling_interval]\n", argv[0]);
+        return 1;
+    }
+
+    double* data = (double*)malloc(sizeof(double) * (size_t)points * config.num_features);
+    ThreadPool* pool = thread_pool_create(thread_pool_default_size());
+    if (data == NULL || pool == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        return 1;
+    }
+    // Gaussian noise around a mean that jumps every 2500 points, 1% of points far out
+    SyntheticStreamConfig shape;
+    synthetic_stream_defaults(&shape);
+    shape.num_features = config.num_features;
+    shape.points = points;
+    generate_synthetic_stream(&shape, data, NULL);
+    feature_t* features = copy_as_features(data, (size_t)points * config.num_features);
+    free(data);
+    if (features == NULL) {
+        fprintf(stderr, "Fatal error: benchmark allocation failed.\n");
+        return 1;
+    }
+
+    printf("Event latency, %d points, D=%d, T=%d, W=%d, psi=%d, %d threads (microseconds)\n",
+           points, config.num_features, config.num_trees, config.window_size, config.sample_size,
+           thread_pool_size(pool));
+    printf("%-22s %8s %10s %10s %10s %10s %12s\n", "mode", "updates", "p50", "p99", "p99.9", "max", "update mean");
+
+    config.rolling_trees = 0;
+    LatencySummary full = run_mode(&config, pool, features, points);
+    print_result("full retrain", &full);
+
+    char name[64];
+    snprintf(name, sizeof(name), "rolling k=%d", rolling_trees);
+    config.rolling_trees = rolling_trees;
+    LatencySummary rolling = run_mode(&config, pool, features, points);
+    print_result(name, &rolling);
+
+    LatencySummary hst = run_hst(&config, features, points);
+    snprintf(name, sizeof(name), "half-space depth=%d", config.hst_depth);
+    print_result(name, &hst);
+
+    thread_pool_destroy(pool);
+    free(features);
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "synthetic_stream.h"
+#include "utils.h" // For RngState, rng_seed, rng_uniform
+#include "stream_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TWO_PI 6.28318530717958647692
+
+void synthetic_stream_defaults(SyntheticStreamConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->num_features = 16;
+    config->points = 20000;
+    config->anomaly_rate = 0.01;
+    config->anomaly_spread = 6.0;
+    config->drift_magnitude = 4.0;
+    config->drift_period = 2500;
+    config->seed = 42;
+}
+
+bool synthetic_stream_parse_drifts(SyntheticStreamConfig* config, const char* list) {
+    config->num_drift_points = 0;
+    config->drift_period = 0;
+    const char* p = list;
+    while (*p != '\0') {
+        char* end;
+        long position = strtol(p, &end, 10);
+        int previous = (config->num_drift_points > 0) ? config->drift_points[config->num_drift_points - 1] : 0;
+        if (end == p || position <= previous || position > 1000000000L ||
+            config->num_drift_points == SYNTHETIC_MAX_DRIFTS || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Error: invalid drift list '%s' (ascending positions, at most %d)\n",
+                    list, SYNTHETIC_MAX_DRIFTS);
+            return false;
+        }
+        config->drift_points[config->num_drift_points++] = (int)position;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+}
+
+void generate_synthetic_stream(const SyntheticStreamConfig* config, double* data, unsigned char* labels) {
+    RngState rng;
+    rng_seed(&rng, config->seed, 0);
+    double shift = 0.0;
+    int next_drift = 0;
+    for (int i = 0; i < config->points; i++) {
+        // The initial mean is drawn like a drift at position 0
+        bool drift = (i == 0);
+        if (config->drift_period > 0) {
+            drift = (i % config->drift_period == 0);
+        } else if (next_drift < config->num_drift_points && i == config->drift_points[next_drift]) {
+            drift = true;
+            next_drift++;
+        }
+        if (drift) {
+            shift = rng_uniform(&rng, -config->drift_magnitude, config->drift_magnitude);
+        }
+        bool anomaly = rng_uniform(&rng, 0.0, 1.0) < config->anomaly_rate;
+        double spread = anomaly ? config->anomaly_spread : 1.0;
+        if (labels != NULL) {
+            labels[i] = anomaly ? 1 : 0;
+        }
+        for (int j = 0; j < config->num_features; j++) {
+            // Box-Muller
+            double u1 = rng_uniform(&rng, 1e-12, 1.0), u2 = rng_uniform(&rng, 0.0, 1.0);
+            double z = sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+            data[(size_t)i * config->num_features + j] = shift + spread * z;
+        }
+    }
+}
+
+bool write_synthetic_csv(const char* path, const double* data, int points, int num_features) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error opening synthetic stream file");
+        return false;
+    }
+    for (int j = 0; j < num_features; j++) {
+        fprintf(file, "%sV%d", (j > 0) ? "," : "", j + 1);
+    }
+    fprintf(file, "\n");
+    for (int i = 0; i < points; i++) {
+        const double* row = data + (size_t)i * num_features;
+        for (int j = 0; j < num_features; j++) {
+            fprintf(file, "%s%.17g", (j > 0) ? "," : "", row[j]);
+        }
+        fprintf(file, "\n");
+    }
+    if (fclose(file) != 0) {
+        perror("Error writing synthetic stream file");
+        return false;
+    }
+    return true;
+}
+
+feature_t* copy_as_features(const double* data, size_t count) {
+    feature_t* features = (feature_t*)malloc(sizeof(feature_t) * count);
+    if (features == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        features[i] = (feature_t)data[i];
+    }
+    return features;
+}
+
+feature_t* copy_as_columns(const double* data, int points, int num_features) {
+    feature_t* columns = (feature_t*)malloc(sizeof(feature_t) * (size_t)points * (size_t)num_features);
+    if (columns == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < points; i++) {
+        for (int d = 0; d < num_features; d++) {
+            columns[(size_t)d * points + i] = (feature_t)data[(size_t)i * num_features + d];
+        }
+    }
+    return columns;
+}
+
+double* read_stream_file(const char* path, int* num_features, int* points) {
+    StreamReader* reader = stream_reader_open(path);
+    if (reader == NULL) {
+        return NULL;
+    }
+    *num_features = reader->header_columns;
+    size_t capacity = 1024;
+    double* data = (double*)malloc(sizeof(double) * capacity * (size_t)*num_features);
+    int count = 0;
+    ReadStatus status;
+    while (data != NULL && (status = stream_reader_next(reader, data + (size_t)count * *num_features, *num_features)) != READ_EOF) {
+        if (status != READ_OK) {
+            continue;
+        }
+        if ((size_t)++count == capacity) {
+            capacity *= 2;
+            double* grown = (double*)realloc(data, sizeof(double) * capacity * (size_t)*num_features);
+            if (grown == NULL) {
+                free(data);
+            }
+            data = grown;
+        }
+    }
+    stream_reader_close(reader);
+    *points = count;
+    return data;
+}
@@ -0,0 +1,76 @@
+#ifndef SYNTHETIC_STREAM_H
+#define SYNTHETIC_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "core_ds.h" // For feature_t
+
+// --- Seeded Synthetic Stream Generator ---
+// Gaussian points around a mean that shifts abruptly at drift points, with a fraction
+// of points drawn with a much wider spread (the injected anomalies). The same
+// configuration and seed always produce the same stream.
+
+#define SYNTHETIC_MAX_DRIFTS 64
+
+/**
+ * @brief Shape of a synthetic stream.
+ */
+typedef struct {
+    int num_features;
+    int points;
+    double anomaly_rate;        // Fraction of points drawn with anomaly_spread
+    double anomaly_spread;      // Standard deviation of anomalies (normal points: 1)
+    double drift_magnitude;     // Each drift moves the mean of every dimension to one U(-m, m) value
+    int drift_period;           // A drift every drift_period points (0 = use drift_points)
+    int drift_points[SYNTHETIC_MAX_DRIFTS]; // Explicit drift positions, ascending
+    int num_drift_points;
+    uint64_t seed;
+} SyntheticStreamConfig;
+
+/**
+ * @brief Default shape: 16 features, 1% anomalies with spread 6, a drift every 2500 points.
+ */
+void synthetic_stream_defaults(SyntheticStreamConfig* config);
+
+/**
+ * @brief Parses a comma-separated list of ascending drift positions into the config.
+ * @return false (with a message) if the list is malformed or too long.
+ */
+bool synthetic_stream_parse_drifts(SyntheticStreamConfig* config, const char* list);
+
+/**
+ * @brief Generates the stream.
+ * @param config The stream shape.
+ * @param data Receives points x num_features values, row-major.
+ * @param labels If not NULL, receives 1 for each injected anomaly and 0 otherwise.
+ */
+void generate_synthetic_stream(const SyntheticStreamConfig* config, double* data, unsigned char* labels);
+
+/**
+ * @brief Writes a generated stream as CSV with a V1..VD header.
+ * @return false (with a message) on I/O failure.
+ */
+bool write_synthetic_csv(const char* path, const double* data, int points, int num_features);
+
+/**
+ * @brief Copies count generated values into new feature storage (float in FLOAT32 builds).
+ * @return The copy (release with free), or NULL if allocation fails.
+ */
+feature_t* copy_as_features(const double* data, size_t count);
+
+/**
+ * @brief Copies points x num_features row-major values into new column-major storage
+ * (column d holds feature d of every point), the layout training reads (FeatureColumns).
+ * @return The copy (release with free), or NULL if allocation fails.
+ */
+feature_t* copy_as_columns(const double* data, int points, int num_features);
+
+/**
+ * @brief Reads every record of a stream file (num_features from its header) as doubles,
+ * so benchmarks can replay recorded data such as data/stream_data.csv.
+ * @return The row-major values (release with free), or NULL if the file cannot be read.
+ */
+double* read_stream_file(const char* path, int* num_features, int* points);
+
+#endif // SYNTHETIC_STREAM_H
@@ -1,59 +1,144 @@
 // adwin.c
 #include "adwin.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 ADWIN *adwin_create(int capacity, double delta) {
-    ADWIN *a = (ADWIN*)malloc(sizeof(ADWIN));
+    ADWIN *a = (ADWIN*)calloc(1, sizeof(ADWIN));
     if (!a) return NULL;
-    a->buffer   = (double*)malloc(sizeof(double) * capacity);
-    if (!a->buffer) { free(a); return NULL; }
-    a->capacity = capacity;
-    a->size     = 0;
-    a->start    = 0;
+    a->capacity = (capacity > 0) ? capacity : 0;
     a->delta    = delta;
     return a;
 }
 
 void adwin_destroy(ADWIN *a) {
-    if (!a) return;
-    free(a->buffer);
     free(a);
 }
 
-static double adwin_get(const ADWIN *a, int idx) {
-    int pos = (a->start + idx) % a->capacity;
-    return a->buffer[pos];
+long adwin_width(const ADWIN *a) {
+    return a->width;
 }
 
-void adwin_add(ADWIN *a, double value) {
-    if (a->size < a->capacity) {
-        int pos = (a->start + a->size) % a->capacity;
-        a->buffer[pos] = value;
-        a->size++;
-    } else {
-        // overwrite oldest
-        a->buffer[a->start] = value;
-        a->start = (a->start + 1) % a->capacity;
+double adwin_mean(const ADWIN *a) {
+    return (a->width > 0) ? a->total / (double)a->width : 0.0;
+}
+
+// Drops the first n buckets of a row (its oldest).
+static void row_drop_oldest(AdwinRow *row, int n) {
+    row->count -= n;
+    memmove(row->total, row->total + n, sizeof(double) * (size_t)row->count);
+    memmove(row->variance, row->variance + n, sizeof(double) * (size_t)row->count);
+}
+
+static void row_append(AdwinRow *row, double total, double variance) {
+    row->total[row->count]    = total;
+    row->variance[row->count] = variance;
+    row->count++;
+}
+
+// Merges the two oldest buckets of every full row into one bucket of the next row.
+// Each merge halves the buckets it touches, so the cascade is amortized O(1) per add.
+static void compress_buckets(ADWIN *a) {
+    for (int i = 0; i < a->num_rows && a->rows[i].count > ADWIN_MAX_BUCKETS; i++) {
+        if (i + 1 == ADWIN_MAX_ROWS) break; // 2^47-value buckets: never reached in practice
+        AdwinRow *row = &a->rows[i];
+        double n  = (double)(1L << i);
+        double u1 = row->total[0] / n, u2 = row->total[1] / n;
+        double merged_variance = row->variance[0] + row->variance[1] + n * n * (u1 - u2) * (u1 - u2) / (2.0 * n);
+        if (i + 1 == a->num_rows) {
+            a->rows[a->num_rows++].count = 0;
+        }
+        row_append(&a->rows[i + 1], row->total[0] + row->total[1], merged_variance);
+        row_drop_oldest(row, 2);
     }
 }
 
-bool adwin_detect_change(ADWIN *a) {
-    if (a->size < 20) return false; // need some data
+// Removes the oldest bucket of the window.
+static void delete_oldest_bucket(ADWIN *a) {
+    int last = a->num_rows - 1;
+    AdwinRow *row = &a->rows[last];
+    double n1 = (double)(1L << last);
+    double bucket_total = row->total[0];
+    double bucket_variance = row->variance[0];
 
-    int mid = a->size / 2;
-    double sum1 = 0.0, sum2 = 0.0;
+    a->width -= 1L << last;
+    a->total -= bucket_total;
+    if (a->width > 0) {
+        double u1 = bucket_total / n1;
+        double diff = u1 - a->total / (double)a->width;
+        a->variance -= bucket_variance + n1 * (double)a->width * diff * diff / (n1 + (double)a->width);
+        if (a->variance < 0.0) a->variance = 0.0; // rounding
+    } else {
+        a->total = 0.0;
+        a->variance = 0.0;
+    }
 
-    for (int i = 0; i < mid; ++i) {
-        sum1 += adwin_get(a, i);
+    row_drop_oldest(row, 1);
+    if (row->count == 0) a->num_rows--;
+}
+
+void adwin_add(ADWIN *a, double value) {
+    // 1. New bucket of size 1, and the window's running total and variance
+    if (a->num_rows == 0) {
+        a->rows[0].count = 0;
+        a->num_rows = 1;
     }
-    for (int i = mid; i < a->size; ++i) {
-        sum2 += adwin_get(a, i);
+    row_append(&a->rows[0], value, 0.0);
+    a->width++;
+    if (a->width > 1) {
+        double diff = value - a->total / (double)(a->width - 1);
+        a->variance += (double)(a->width - 1) * diff * diff / (double)a->width;
     }
+    a->total += value;
+
+    // 2. Keep at most M buckets per row
+    compress_buckets(a);
 
-    double mean1 = sum1 / mid;
-    double mean2 = sum2 / (a->size - mid);
-    double diff  = fabs(mean1 - mean2);
+    // 3. Bounded window: forget the oldest buckets
+    while (a->capacity > 0 && a->width > a->capacity) {
+        delete_oldest_bucket(a);
+    }
+}
 
-    return diff > a->delta;
+// Hoeffding-style bound of ADWIN2 for sub-windows of n0 (older) and n1 (newer) values.
+static bool cut_expression(const ADWIN *a, double n0, double n1, double u0, double u1) {
+    double w  = (double)a->width;
+    double v  = a->variance / w;
+    double dd = log(2.0 * log(w) / a->delta);
+    double m  = 1.0 / (n0 - ADWIN_MIN_SUBWINDOW + 1) + 1.0 / (n1 - ADWIN_MIN_SUBWINDOW + 1);
+    double epsilon = sqrt(2.0 * m * v * dd) + 2.0 / 3.0 * dd * m;
+    return fabs(u0 - u1) > epsilon;
+}
+
+bool adwin_detect_change(ADWIN *a) {
+    bool changed = false;
+    bool reduced = true;
+    while (reduced && a->width > 2 * ADWIN_MIN_SUBWINDOW) {
+        reduced = false;
+
+        // Every bucket boundary, oldest first: older part n0/sum0 vs newer part n1/sum1
+        double n0 = 0.0, sum0 = 0.0;
+        for (int i = a->num_rows - 1; i >= 0 && !reduced; i--) {
+            const AdwinRow *row = &a->rows[i];
+            double size = (double)(1L << i);
+            for (int j = 0; j < row->count; j++) {
+                n0   += size;
+                sum0 += row->total[j];
+                double n1 = (double)a->width - n0;
+                if (n0 < ADWIN_MIN_SUBWINDOW || n1 < ADWIN_MIN_SUBWINDOW) continue;
+                if (cut_expression(a, n0, n1, sum0 / n0, (a->total - sum0) / n1)) {
+                    reduced = true;
+                    break;
+                }
+            }
+        }
+
+        // Drop the oldest bucket and test the shorter window again
+        if (reduced) {
+            delete_oldest_bucket(a);
+            changed = true;
+        }
+    }
+    return changed;
 }
@@ -4,22 +4,44 @@
 
 #include <stdbool.h>
 
-// Simple ADWIN-like detector: fixed-capacity window, mean-difference test.
+// ADWIN2 (Bifet & Gavalda, 2007): adaptive window over an exponential histogram.
+// Row i holds up to ADWIN_MAX_BUCKETS buckets that each summarize 2^i consecutive
+// values by their total and variance, so W values cost O(log W) memory. A change is
+// reported when some split of the window into an older and a newer part has means
+// that differ by more than the Hoeffding-style bound for confidence delta; the older
+// part is then dropped.
+#define ADWIN_MAX_BUCKETS 5   // Buckets per row before the two oldest are merged (M)
+#define ADWIN_MAX_ROWS 48     // Rows of bucket sizes 1 .. 2^47
+#define ADWIN_MIN_SUBWINDOW 5 // Minimum length of either side of a cut
+
+typedef struct {
+    double total[ADWIN_MAX_BUCKETS + 1];    // Oldest bucket first
+    double variance[ADWIN_MAX_BUCKETS + 1]; // Sum of squared deviations within the bucket
+    int count;
+} AdwinRow;
+
 typedef struct {
-    double *buffer;
-    int capacity;      // max window size (e.g., 512 or 1024)
-    int size;          // current number of elements
-    int start;         // circular buffer start index
-    double delta;      // sensitivity parameter (e.g., 0.002)
+    AdwinRow rows[ADWIN_MAX_ROWS];
+    int num_rows;      // Rows in use (the last one holds the oldest data)
+    long capacity;     // max window width; 0 = unbounded
+    long width;        // values currently in the window
+    double total;      // sum of the window
+    double variance;   // sum of squared deviations from the window mean
+    double delta;      // confidence parameter (e.g., 0.002)
 } ADWIN;
 
 ADWIN *adwin_create(int capacity, double delta);
 void   adwin_destroy(ADWIN *adw);
 
-// Add one numeric value (score or 0/1 prediction).
+// Add one numeric value (score or 0/1 prediction). Amortized O(1).
 void   adwin_add(ADWIN *adw, double value);
 
-// Return true if drift is detected between older and newer halves.
+// Return true if some older part of the window differs from the newer part;
+// the older part is dropped. O(log W) per call.
 bool   adwin_detect_change(ADWIN *adw);
 
+// Current window width and mean.
+long   adwin_width(const ADWIN *adw);
+double adwin_mean(const ADWIN *adw);
+
 #endif
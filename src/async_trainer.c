@@ -0,0 +1,284 @@
+#define _POSIX_C_SOURCE 200809L // For nanosleep
+
+#include "async_trainer.h"
+#include "iforest.h"
+#include "score_kernels.h"
+#include "utils.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#define SNAPSHOT_SCORE_BLOCK 64 // Snapshot rows walked through each tree together
+
+struct AsyncTrainer {
+    IsolationForest* owner;               // Forest handed to async_trainer_create
+    _Atomic(IsolationForest*) active;     // Model readers score with
+    IsolationForest* standby;             // Rebuilt in the background, then swapped in
+
+    // Snapshot of the window the next model is built from (slot order): rows for
+    // rescoring it, columns for training
+    feature_t* snapshot_data;
+    DataPoint* snapshot;
+    feature_t* snapshot_column_data;
+    FeatureColumns snapshot_columns;
+    double* snapshot_path_sums;           // Under the newly built model
+    int window_size;
+    int num_features;
+    long snapshot_inserted;               // sw->total_inserted when the snapshot was taken
+    uint64_t seed;                        // Drawn on the requesting thread
+    double trigger_time;                  // Monotonic seconds at the request
+
+    // Epoch-based reclamation: a reader's slot holds the epoch it entered in (0 = quiescent)
+    atomic_uint_fast64_t epoch;
+    atomic_uint_fast64_t reader_epochs[ASYNC_MAX_READERS];
+
+    // Background thread
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;                  // Signalled when a build has been published and retired
+    bool build_requested;                 // Under lock
+    bool stop;                            // Under lock
+    atomic_bool in_flight;                // From request until the old model is retired
+
+    AsyncTrainerStats stats;              // Under lock
+    int pending_coalesced;                // Under lock: triggers merged into the in-flight build
+};
+
+// --- Reader Side ---
+
+const IsolationForest* async_trainer_read_begin(AsyncTrainer* trainer, int reader) {
+    // Publish the epoch before loading the model, so a writer that swapped before this
+    // load waits for us only if we may still hold the old model
+    atomic_store(&trainer->reader_epochs[reader], atomic_load(&trainer->epoch));
+    return atomic_load(&trainer->active);
+}
+
+void async_trainer_read_end(AsyncTrainer* trainer, int reader) {
+    atomic_store_explicit(&trainer->reader_epochs[reader], 0, memory_order_release);
+}
+
+// --- Writer Side ---
+
+/**
+ * Waits until no reader can still hold a model published before the epoch advance.
+ */
+static void wait_for_readers(AsyncTrainer* trainer) {
+    uint_fast64_t retire_epoch = atomic_fetch_add(&trainer->epoch, 1) + 1;
+    struct timespec pause = { 0, 50000 }; // 50 us: readers hold a model for one point
+    for (int i = 0; i < ASYNC_MAX_READERS; i++) {
+        for (;;) {
+            uint_fast64_t seen = atomic_load(&trainer->reader_epochs[i]);
+            if (seen == 0 || seen >= retire_epoch) break;
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+/**
+ * Scores the snapshot under the new model, so the reader can refresh its window
+ * cache without walking the whole forest on the scoring path.
+ */
+static void score_snapshot(AsyncTrainer* trainer, const IsolationForest* model) {
+    for (int start = 0; start < trainer->window_size; start += SNAPSHOT_SCORE_BLOCK) {
+        int block = (trainer->window_size - start < SNAPSHOT_SCORE_BLOCK) ? trainer->window_size - start : SNAPSHOT_SCORE_BLOCK;
+        double* sums = trainer->snapshot_path_sums + start;
+        for (int j = 0; j < block; j++) {
+            sums[j] = 0.0;
+        }
+        for (int t = 0; t < model->num_trees; t++) {
+            accumulate_path_lengths(&model->trees[t], &trainer->snapshot[start], block, sums);
+        }
+    }
+}
+
+static void* trainer_main(void* arg) {
+    AsyncTrainer* trainer = (AsyncTrainer*)arg;
+
+    pthread_mutex_lock(&trainer->lock);
+    for (;;) {
+        while (!trainer->stop && !trainer->build_requested) {
+            pthread_cond_wait(&trainer->wake, &trainer->lock);
+        }
+        if (!trainer->build_requested) {
+            break; // Stopped with nothing in flight
+        }
+        trainer->build_requested = false;
+        pthread_mutex_unlock(&trainer->lock);
+
+        // 1. Build the standby from the snapshot while readers use the active model
+        IsolationForest* next = trainer->standby;
+        IsolationForest* previous = atomic_load(&trainer->active);
+        next->generation = previous->generation;
+        METRICS_TIMER(train_timer);
+        train_iforest_seeded(next, &trainer->snapshot_columns, trainer->window_size, trainer->seed);
+        METRICS_STOP(STAGE_TRAIN, train_timer);
+        METRICS_COUNT(COUNTER_RETRAINS);
+        score_snapshot(trainer, next);
+
+        // 2. Publish, then retire the old model once no reader can still hold it
+        atomic_store(&trainer->active, next);
+        double trigger_to_swap_ms = (now_seconds() - trainer->trigger_time) * 1e3;
+        pthread_mutex_lock(&trainer->lock);
+        trainer->stats.swaps++;
+        trainer->stats.last_coalesced = trainer->pending_coalesced;
+        trainer->stats.last_trigger_to_swap_ms = trigger_to_swap_ms;
+        trainer->stats.total_trigger_to_swap_ms += trigger_to_swap_ms;
+        if (trigger_to_swap_ms > trainer->stats.max_trigger_to_swap_ms) {
+            trainer->stats.max_trigger_to_swap_ms = trigger_to_swap_ms;
+        }
+        trainer->pending_coalesced = 0;
+        pthread_mutex_unlock(&trainer->lock);
+
+        wait_for_readers(trainer);
+        trainer->standby = previous;
+
+        pthread_mutex_lock(&trainer->lock);
+        atomic_store(&trainer->in_flight, false);
+        pthread_cond_broadcast(&trainer->idle);
+    }
+    pthread_mutex_unlock(&trainer->lock);
+    return NULL;
+}
+
+bool async_trainer_request(AsyncTrainer* trainer, const SlidingWindow* sw) {
+    if (atomic_load(&trainer->in_flight)) {
+        pthread_mutex_lock(&trainer->lock);
+        trainer->stats.coalesced++;
+        trainer->pending_coalesced++;
+        pthread_mutex_unlock(&trainer->lock);
+        return false;
+    }
+
+    // The thread is idle: the snapshot buffers are ours until the request is published
+    for (int i = 0; i < trainer->window_size; i++) {
+        memcpy(trainer->snapshot[i].features, sw->buffer[i].features, sizeof(feature_t) * (size_t)trainer->num_features);
+    }
+    memcpy(trainer->snapshot_column_data, sw->column_data,
+           sizeof(feature_t) * (size_t)trainer->window_size * (size_t)trainer->num_features);
+    trainer->snapshot_inserted = sw->total_inserted;
+    trainer->seed = get_random_seed();
+    trainer->trigger_time = now_seconds();
+    atomic_store(&trainer->in_flight, true);
+
+    pthread_mutex_lock(&trainer->lock);
+    trainer->build_requested = true;
+    pthread_cond_signal(&trainer->wake);
+    pthread_mutex_unlock(&trainer->lock);
+    return true;
+}
+
+const double* async_trainer_snapshot_path_sums(const AsyncTrainer* trainer, long* snapshot_inserted) {
+    *snapshot_inserted = trainer->snapshot_inserted;
+    return trainer->snapshot_path_sums;
+}
+
+void async_trainer_wait(AsyncTrainer* trainer) {
+    pthread_mutex_lock(&trainer->lock);
+    while (atomic_load(&trainer->in_flight)) {
+        pthread_cond_wait(&trainer->idle, &trainer->lock);
+    }
+    pthread_mutex_unlock(&trainer->lock);
+}
+
+AsyncTrainerStats async_trainer_stats(AsyncTrainer* trainer) {
+    pthread_mutex_lock(&trainer->lock);
+    AsyncTrainerStats stats = trainer->stats;
+    pthread_mutex_unlock(&trainer->lock);
+    return stats;
+}
+
+// --- Lifecycle ---
+
+AsyncTrainer* async_trainer_create(IsolationForest* forest, const IForestConfig* config) {
+    AsyncTrainer* trainer = (AsyncTrainer*)calloc(1, sizeof(AsyncTrainer));
+    if (trainer == NULL) {
+        perror("Error: Memory allocation failed for AsyncTrainer");
+        return NULL;
+    }
+    trainer->owner = forest;
+    trainer->window_size = config->window_size;
+    trainer->num_features = config->num_features;
+    atomic_init(&trainer->active, forest);
+    atomic_init(&trainer->epoch, 1);
+    for (int i = 0; i < ASYNC_MAX_READERS; i++) {
+        atomic_init(&trainer->reader_epochs[i], 0);
+    }
+    atomic_init(&trainer->in_flight, false);
+
+    trainer->standby = create_forest(config);
+    trainer->snapshot_data = (feature_t*)malloc(sizeof(feature_t) * (size_t)trainer->window_size * (size_t)trainer->num_features);
+    trainer->snapshot = (DataPoint*)malloc(sizeof(DataPoint) * (size_t)trainer->window_size);
+    trainer->snapshot_column_data = (feature_t*)malloc(sizeof(feature_t) * (size_t)trainer->window_size * (size_t)trainer->num_features);
+    trainer->snapshot_path_sums = (double*)calloc((size_t)trainer->window_size, sizeof(double));
+    if (trainer->standby == NULL || trainer->snapshot_data == NULL || trainer->snapshot == NULL ||
+        trainer->snapshot_column_data == NULL || trainer->snapshot_path_sums == NULL) {
+        perror("Error: Memory allocation failed for AsyncTrainer buffers");
+        free_forest(trainer->standby);
+        free(trainer->snapshot_data);
+        free(trainer->snapshot);
+        free(trainer->snapshot_column_data);
+        free(trainer->snapshot_path_sums);
+        free(trainer);
+        return NULL;
+    }
+    trainer->standby->pool = forest->pool; // Background builds use the training pool
+    for (int i = 0; i < trainer->window_size; i++) {
+        trainer->snapshot[i].features = trainer->snapshot_data + (size_t)i * trainer->num_features;
+    }
+    trainer->snapshot_columns.values = trainer->snapshot_column_data;
+    trainer->snapshot_columns.stride = (size_t)trainer->window_size;
+
+    pthread_mutex_init(&trainer->lock, NULL);
+    pthread_cond_init(&trainer->wake, NULL);
+    pthread_cond_init(&trainer->idle, NULL);
+    if (pthread_create(&trainer->thread, NULL, trainer_main, trainer) != 0) {
+        perror("Error: Failed to start background trainer");
+        pthread_mutex_destroy(&trainer->lock);
+        pthread_cond_destroy(&trainer->wake);
+        pthread_cond_destroy(&trainer->idle);
+        free_forest(trainer->standby);
+        free(trainer->snapshot_data);
+        free(trainer->snapshot);
+        free(trainer->snapshot_column_data);
+        free(trainer->snapshot_path_sums);
+        free(trainer);
+        return NULL;
+    }
+    return trainer;
+}
+
+void async_trainer_destroy(AsyncTrainer* trainer) {
+    if (trainer == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&trainer->lock);
+    trainer->stop = true;
+    pthread_cond_signal(&trainer->wake);
+    pthread_mutex_unlock(&trainer->lock);
+    pthread_join(trainer->thread, NULL);
+
+    // Leave the latest model in the caller's forest: swap the two structs' contents
+    // (trees and arenas move together, so each forest stays self-consistent)
+    IsolationForest* latest = atomic_load(&trainer->active);
+    if (latest != trainer->owner) {
+        IsolationForest held = *trainer->owner;
+        *trainer->owner = *latest;
+        *latest = held;
+    }
+    free_forest(trainer->standby == trainer->owner ? latest : trainer->standby);
+
+    pthread_mutex_destroy(&trainer->lock);
+    pthread_cond_destroy(&trainer->wake);
+    pthread_cond_destroy(&trainer->idle);
+    free(trainer->snapshot_data);
+    free(trainer->snapshot);
+    free(trainer->snapshot_column_data);
+    free(trainer->snapshot_path_sums);
+    free(trainer);
+}
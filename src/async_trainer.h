@@ -0,0 +1,87 @@
+#ifndef ASYNC_TRAINER_H
+#define ASYNC_TRAINER_H
+
+#include "core_ds.h" // For IsolationForest, SlidingWindow, IForestConfig
+#include <stdbool.h>
+
+#define ASYNC_MAX_READERS 8 // Reader slots available for epoch-protected model access
+
+/**
+ * @brief Retrains the forest on a background thread and publishes it with an atomic swap.
+ * Two forests are double-buffered: readers keep scoring with the active one while the
+ * standby is rebuilt from a snapshot of the window. After the swap the old forest is
+ * retired once every reader has left its read section (epoch-based reclamation), and
+ * becomes the standby for the next build. Triggers that arrive while a build is in
+ * flight are coalesced into it.
+ */
+typedef struct AsyncTrainer AsyncTrainer;
+
+/**
+ * @brief Creates the trainer, its standby forest and its background thread.
+ * @param forest The trained forest to start from; it becomes the first active model.
+ * @param config The detector dimensions (for the standby forest and the snapshot).
+ * @return The trainer, or NULL on failure.
+ */
+AsyncTrainer* async_trainer_create(IsolationForest* forest, const IForestConfig* config);
+
+/**
+ * @brief Waits for an in-flight build, stops the thread and frees the trainer.
+ * The forest passed to async_trainer_create is left holding the latest published model.
+ */
+void async_trainer_destroy(AsyncTrainer* trainer);
+
+/**
+ * @brief Enters a read section and returns the active model.
+ * The model stays valid until async_trainer_read_end on the same reader slot.
+ * @param trainer The trainer.
+ * @param reader The caller's reader slot in [0, ASYNC_MAX_READERS).
+ */
+const IsolationForest* async_trainer_read_begin(AsyncTrainer* trainer, int reader);
+
+/**
+ * @brief Leaves the read section entered by async_trainer_read_begin.
+ */
+void async_trainer_read_end(AsyncTrainer* trainer, int reader);
+
+/**
+ * @brief Requests a retrain from a snapshot of the (full) window.
+ * The snapshot and the build's random seed are taken on the calling thread.
+ * @param trainer The trainer.
+ * @param sw The window to snapshot.
+ * @return true if a build was started, false if one is already in flight
+ * (the trigger is coalesced into it).
+ */
+bool async_trainer_request(AsyncTrainer* trainer, const SlidingWindow* sw);
+
+/**
+ * @brief Path-length sums of the snapshot's slots under the most recently published model.
+ * Valid until the next async_trainer_request.
+ * @param trainer The trainer.
+ * @param snapshot_inserted Receives sw->total_inserted at the time of the snapshot.
+ */
+const double* async_trainer_snapshot_path_sums(const AsyncTrainer* trainer, long* snapshot_inserted);
+
+/**
+ * @brief Blocks until no build is in flight (the last one is published and its
+ * predecessor retired). Must not be called from inside a read section.
+ */
+void async_trainer_wait(AsyncTrainer* trainer);
+
+/**
+ * @brief Statistics of the published builds.
+ */
+typedef struct {
+    int swaps;                      // Models published
+    int coalesced;                  // Triggers merged into an in-flight build
+    int last_coalesced;             // Triggers merged into the most recent published build
+    double last_trigger_to_swap_ms; // Trigger (snapshot) to publication of the most recent build
+    double total_trigger_to_swap_ms;
+    double max_trigger_to_swap_ms;
+} AsyncTrainerStats;
+
+/**
+ * @brief Returns a consistent copy of the trainer's statistics.
+ */
+AsyncTrainerStats async_trainer_stats(AsyncTrainer* trainer);
+
+#endif // ASYNC_TRAINER_H
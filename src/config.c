@@ -0,0 +1,185 @@
+#include "config.h"
+#include "hstree.h" // For HSNode
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+
+void init_default_config(IForestConfig* config) {
+    config->num_features = 0; // Inferred from the stream header unless set explicitly
+    config->num_trees = DEFAULT_NUM_TREES;
+    config->window_size = DEFAULT_WINDOW_SIZE;
+    config->sample_size = DEFAULT_SAMPLE_SIZE;
+    config->anomaly_threshold = DEFAULT_ANOMALY_THRESHOLD;
+    config->desired_anomaly_rate_u = DEFAULT_DESIRED_ANOMALY_RATE_U;
+    config->rolling_trees = DEFAULT_ROLLING_TREES;
+    config->rolling_interval = DEFAULT_ROLLING_INTERVAL;
+    config->async_retrain = DEFAULT_ASYNC_RETRAIN;
+    config->pipeline = DEFAULT_PIPELINE;
+    config->hst_depth = DEFAULT_HST_DEPTH;
+}
+
+// --- Parsing Helpers ---
+
+static bool parse_int(const char* text, int* out) {
+    char* end = NULL;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    *out = (int)value;
+    return true;
+}
+
+static bool parse_double(const char* text, double* out) {
+    char* end = NULL;
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0') {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+/**
+ * Removes leading and trailing whitespace in place and returns the trimmed start.
+ */
+static char* trim(char* text) {
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+    char* end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return text;
+}
+
+// --- Configuration Implementation ---
+
+bool set_config_value(IForestConfig* config, const char* key, const char* value) {
+    if (strcmp(key, "features") == 0) return parse_int(value, &config->num_features);
+    if (strcmp(key, "trees") == 0) return parse_int(value, &config->num_trees);
+    if (strcmp(key, "window") == 0) return parse_int(value, &config->window_size);
+    if (strcmp(key, "sample") == 0) return parse_int(value, &config->sample_size);
+    if (strcmp(key, "threshold") == 0) return parse_double(value, &config->anomaly_threshold);
+    if (strcmp(key, "u") == 0) return parse_double(value, &config->desired_anomaly_rate_u);
+    if (strcmp(key, "rolling_trees") == 0) return parse_int(value, &config->rolling_trees);
+    if (strcmp(key, "rolling_interval") == 0) return parse_int(value, &config->rolling_interval);
+    if (strcmp(key, "async") == 0) return parse_int(value, &config->async_retrain);
+    if (strcmp(key, "pipeline") == 0) return parse_int(value, &config->pipeline);
+    if (strcmp(key, "hst_depth") == 0) return parse_int(value, &config->hst_depth);
+    return false;
+}
+
+bool load_config_file(IForestConfig* config, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Error opening config file");
+        return false;
+    }
+
+    char line[512];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char* text = trim(line);
+        if (*text == '\0') {
+            continue;
+        }
+        char* equals = strchr(text, '=');
+        if (equals == NULL) {
+            fprintf(stderr, "Config Error (%s:%d): expected 'key = value'\n", path, line_number);
+            ok = false;
+            break;
+        }
+        *equals = '\0';
+        char* key = trim(text);
+        char* value = trim(equals + 1);
+        if (!set_config_value(config, key, value)) {
+            fprintf(stderr, "Config Error (%s:%d): invalid entry '%s = %s'\n", path, line_number, key, value);
+            ok = false;
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+bool validate_config(const IForestConfig* config) {
+    if (config->num_features < 1) {
+        fprintf(stderr, "Config Error: features must be >= 1 (got %d)\n", config->num_features);
+        return false;
+    }
+    if (config->num_trees < 1) {
+        fprintf(stderr, "Config Error: trees must be >= 1 (got %d)\n", config->num_trees);
+        return false;
+    }
+    if (config->window_size < 2) {
+        fprintf(stderr, "Config Error: window must be >= 2 (got %d)\n", config->window_size);
+        return false;
+    }
+    if (config->sample_size < 2 || config->sample_size > MAX_SAMPLE_SIZE) {
+        fprintf(stderr, "Config Error: sample must be in [2, %d] (got %d)\n", MAX_SAMPLE_SIZE, config->sample_size);
+        return false;
+    }
+    if (config->sample_size > config->window_size) {
+        // Trees could only be built from W points, yet scores would be normalized by c(ψ)
+        fprintf(stderr, "Config Error: sample must not exceed window (got sample %d, window %d)\n",
+                config->sample_size, config->window_size);
+        return false;
+    }
+    if (!(config->anomaly_threshold > 0.0 && config->anomaly_threshold <= 1.0)) { // Also rejects NaN
+        fprintf(stderr, "Config Error: threshold must be in (0, 1] (got %g)\n", config->anomaly_threshold);
+        return false;
+    }
+    if (!(config->desired_anomaly_rate_u >= 0.0 && config->desired_anomaly_rate_u <= 1.0)) {
+        fprintf(stderr, "Config Error: u must be in [0, 1] (got %g)\n", config->desired_anomaly_rate_u);
+        return false;
+    }
+    if (config->rolling_trees < 0 || config->rolling_trees > config->num_trees) {
+        fprintf(stderr, "Config Error: rolling_trees must be in [0, trees] (got %d)\n", config->rolling_trees);
+        return false;
+    }
+    if (config->rolling_interval < 0) {
+        fprintf(stderr, "Config Error: rolling_interval must be >= 0 (got %d)\n", config->rolling_interval);
+        return false;
+    }
+    if (config->async_retrain != 0 && config->async_retrain != 1) {
+        fprintf(stderr, "Config Error: async must be 0 or 1 (got %d)\n", config->async_retrain);
+        return false;
+    }
+    if (config->pipeline != 0 && config->pipeline != 1) {
+        fprintf(stderr, "Config Error: pipeline must be 0 or 1 (got %d)\n", config->pipeline);
+        return false;
+    }
+    if (config->hst_depth < 1 || config->hst_depth > MAX_HST_DEPTH) {
+        fprintf(stderr, "Config Error: hst_depth must be in [1, %d] (got %d)\n", MAX_HST_DEPTH, config->hst_depth);
+        return false;
+    }
+    // Both models store every tree as a complete binary tree of 2^(depth+1) - 1 nodes
+    double forest_mib = (double)config->num_trees * max_tree_nodes(compute_max_depth(config->sample_size)) * sizeof(Node) / (1024.0 * 1024.0);
+    if (forest_mib > (double)(MAX_FOREST_BYTES >> 20)) {
+        fprintf(stderr, "Config Error: trees x sample needs %.0f MiB of tree nodes, above the %zu MiB limit\n",
+                forest_mib, MAX_FOREST_BYTES >> 20);
+        return false;
+    }
+    double hst_mib = (double)config->num_trees * max_tree_nodes(config->hst_depth) * sizeof(HSNode) / (1024.0 * 1024.0);
+    if (hst_mib > (double)(MAX_FOREST_BYTES >> 20)) {
+        fprintf(stderr, "Config Error: trees x hst_depth needs %.0f MiB of tree nodes, above the %zu MiB limit\n",
+                hst_mib, MAX_FOREST_BYTES >> 20);
+        return false;
+    }
+    if (config->async_retrain && config->rolling_trees > 0) {
+        fprintf(stderr, "Config Error: async retraining rebuilds the whole forest; it cannot be combined with rolling_trees\n");
+        return false;
+    }
+    return true;
+}
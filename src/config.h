@@ -0,0 +1,51 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "core_ds.h" // For IForestConfig
+#include <stdbool.h>
+
+// --- Runtime Configuration ---
+
+// Largest supported ψ: trees are stored as complete binary trees of depth ceil(log2(ψ))
+#define MAX_SAMPLE_SIZE (1 << 20)
+
+// Deepest supported Half-Space Tree (2^(depth+1) - 1 nodes per tree)
+#define MAX_HST_DEPTH 20
+
+// Largest node arena a forest (iForest or Half-Space Trees) may allocate: 1 GiB
+#define MAX_FOREST_BYTES ((size_t)1 << 30)
+
+/**
+ * @brief Fills a configuration with the compile-time defaults.
+ * num_features starts at 0, meaning "infer from the stream header".
+ * @param config The configuration to initialize.
+ */
+void init_default_config(IForestConfig* config);
+
+/**
+ * @brief Sets one configuration parameter from its textual key and value.
+ * Keys: features, trees, window, sample, threshold, u, rolling_trees, rolling_interval, async,
+ * pipeline, hst_depth.
+ * @param config The configuration to update.
+ * @param key The parameter name.
+ * @param value The parameter value.
+ * @return true if the key is known and the value parsed, false otherwise.
+ */
+bool set_config_value(IForestConfig* config, const char* key, const char* value);
+
+/**
+ * @brief Loads "key = value" lines from a configuration file ('#' starts a comment).
+ * @param config The configuration to update.
+ * @param path Path of the configuration file.
+ * @return true on success, false if the file cannot be read or contains an invalid entry.
+ */
+bool load_config_file(IForestConfig* config, const char* path);
+
+/**
+ * @brief Checks that every parameter is in range, printing the first problem found.
+ * @param config The configuration to check.
+ * @return true if the configuration is usable.
+ */
+bool validate_config(const IForestConfig* config);
+
+#endif // CONFIG_H
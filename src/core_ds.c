@@ -1,107 +1,173 @@
+#define _POSIX_C_SOURCE 200809L // For munmap
+
 #include "core_ds.h"
 #include <stdio.h>
+#include <math.h>
+#include <sys/mman.h>
 
-// --- Node Management ---
+// --- Tree Management ---
 
 /**
- * @brief Allocates memory for a new Node and initializes its basic properties.
- * * @param is_external 1 for leaf node, 0 for internal node.
- * @param size The number of points contained in the node.
- * @param height The depth of the node (path length from the root).
- * @return A pointer to the newly created Node, or NULL on failure.
+ * @brief Computes the maximum iTree depth for a given sample size: ceil(log2(ψ)).
+ * * @param sample_size The number of points used to build each tree (ψ).
+ * @return The maximum depth (at least 1).
  */
-Node* create_node(int is_external, int size, int height) {
-    // Allocate memory for the Node structure
-    Node* new_node = (Node*)malloc(sizeof(Node));
-    if (new_node == NULL) {
-        perror("Error: Memory allocation failed for new Node");
-        return NULL;
-    }
-
-    // Initialize common properties
-    new_node->is_external = is_external;
-    new_node->size = size;
-    new_node->height = height;
-    new_node->left = NULL;
-    new_node->right = NULL;
-
-    // Initialize split properties (important even for external nodes, though unused)
-    new_node->split_feature_index = -1;
-    new_node->split_value = DBL_MIN;
+int compute_max_depth(int sample_size) {
+    int max_depth = (int)ceil(log2((double)sample_size));
+    return (max_depth < 1) ? 1 : max_depth;
+}
 
-    return new_node;
+/**
+ * @brief Computes the number of nodes of an implicit-layout iTree: 2^(d+1)-1.
+ * * Every tree is stored as a complete binary tree of depth d, whatever its shape.
+ * @param max_depth The depth of the tree.
+ * @return The node count of one tree.
+ */
+int max_tree_nodes(int max_depth) {
+    return (1 << (max_depth + 1)) - 1;
 }
 
 /**
- * @brief Recursively frees all memory allocated for an Isolation Tree.
- * * @param root The root node of the tree to be freed.
+ * @brief Empties a tree so it can be rebuilt in place; its arena slice is kept.
+ * * @param tree The tree to reset.
  */
-void free_tree(Node* root) {
-    if (root == NULL) {
+void reset_tree(ITree* tree) {
+    if (tree == NULL) {
         return;
     }
-    // Post-order traversal to ensure children are freed before parent
-    free_tree(root->left);
-    free_tree(root->right);
-    free(root);
+    tree->node_count = 0;
+    tree->min_path_length = 0.0;
+    tree->max_path_length = 0.0;
 }
 
 // --- Forest Management ---
 
 /**
- * @brief Allocates memory for the IsolationForest structure.
- * * @return A pointer to the newly created IsolationForest, or NULL on failure.
+ * @brief Allocates memory for the IsolationForest structure and its node arena.
+ * * The arena holds num_trees slices of max_tree_nodes(max_depth) nodes,
+ * so training never allocates nodes: every retrain resets the trees and refills the arena.
+ * Its index workspace is allocated by the first training run and reused after that.
+ * @param config The detector dimensions (D, T, ψ).
+ * @return A pointer to the newly created IsolationForest, or NULL on failure.
  */
-IsolationForest* create_forest() {
-    IsolationForest* forest = (IsolationForest*)malloc(sizeof(IsolationForest));
+IsolationForest* create_forest(const IForestConfig* config) {
+    IsolationForest* forest = (IsolationForest*)calloc(1, sizeof(IsolationForest));
     if (forest == NULL) {
         perror("Error: Memory allocation failed for IsolationForest");
         return NULL;
     }
-    // Initialize all tree pointers to NULL
-    for (int i = 0; i < NUM_TREES; i++) {
-        forest->trees[i] = NULL;
+
+    forest->pool = NULL; // Train serially unless a pool is attached
+    forest->num_trees = config->num_trees;
+    forest->num_features = config->num_features;
+    forest->sample_size = config->sample_size;
+    forest->max_depth = compute_max_depth(config->sample_size);
+    forest->nodes_per_tree = max_tree_nodes(forest->max_depth);
+    forest->trees = (ITree*)malloc(sizeof(ITree) * (size_t)forest->num_trees);
+    forest->node_arena = (Node*)malloc(sizeof(Node) * (size_t)forest->nodes_per_tree * (size_t)forest->num_trees);
+    forest->tree_ages = (long*)malloc(sizeof(long) * 2 * (size_t)forest->num_trees);
+    forest->update_trees = (int*)malloc(sizeof(int) * (size_t)forest->num_trees);
+    if (forest->trees == NULL || forest->node_arena == NULL || forest->tree_ages == NULL || forest->update_trees == NULL) {
+        perror("Error: Memory allocation failed for IsolationForest node arena");
+        free_forest(forest);
+        return NULL;
+    }
+
+    // Carve one fixed slice of the arena per tree; all trees start empty
+    for (int i = 0; i < forest->num_trees; i++) {
+        forest->trees[i].nodes = forest->node_arena + (size_t)i * forest->nodes_per_tree;
+        forest->trees[i].node_count = 0;
+        forest->trees[i].depth = forest->max_depth;
+        forest->trees[i].built_at = 0;
+        forest->trees[i].min_path_length = 0.0;
+        forest->trees[i].max_path_length = 0.0;
     }
     return forest;
 }
 
 /**
- * @brief Frees all memory allocated for the IsolationForest, including all its trees.
+ * @brief Frees all memory allocated for the IsolationForest, including its node arena.
  * * @param forest The IsolationForest structure to be freed.
  */
 void free_forest(IsolationForest* forest) {
     if (forest == NULL) {
         return;
     }
-    // Free each tree in the forest
-    for (int i = 0; i < NUM_TREES; i++) {
-        if (forest->trees[i] != NULL) {
-            free_tree(forest->trees[i]);
-            forest->trees[i] = NULL; // Prevent double freeing
-        }
+    // All trees live in the arena, so a single free (or unmap, for a loaded model) releases every node
+    if (forest->mapping != NULL) {
+        munmap(forest->mapping, forest->mapping_size);
+    } else {
+        free(forest->node_arena);
     }
+    free(forest->trees);
+    free(forest->train_scratch);
+    free(forest->tree_ages);
+    free(forest->update_trees);
     free(forest);
 }
 
+/**
+ * @brief Reports whether every tree of the forest has been built (or loaded).
+ * * @param forest The IsolationForest to check.
+ * @return true if the forest can score points.
+ */
+bool forest_is_trained(const IsolationForest* forest) {
+    if (forest == NULL || forest->num_trees == 0) {
+        return false;
+    }
+    for (int i = 0; i < forest->num_trees; i++) {
+        if (forest->trees[i].node_count == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // --- Sliding Window Management ---
 
 /**
- * @brief Allocates memory for the SlidingWindow structure and initializes pointers.
- * * @return A pointer to the newly created SlidingWindow.
+ * @brief Allocates memory for the SlidingWindow structure and its W x D point storage.
+ * * @param config The detector dimensions (W, D) and anomaly threshold.
+ * @return A pointer to the newly created SlidingWindow, or NULL on failure.
  */
-SlidingWindow* create_sliding_window() {
-    SlidingWindow* sw = (SlidingWindow*)malloc(sizeof(SlidingWindow));
+SlidingWindow* create_sliding_window(const IForestConfig* config) {
+    SlidingWindow* sw = (SlidingWindow*)calloc(1, sizeof(SlidingWindow));
     if (sw == NULL) {
         perror("Error: Memory allocation failed for SlidingWindow");
         return NULL;
     }
-    // Initialize the window as empty
+    sw->capacity = config->window_size;
+    sw->num_features = config->num_features;
+    sw->anomaly_threshold = config->anomaly_threshold;
+
+    // One row-major block holds every slot's features plus a spare staging row;
+    // buffer[i] views one row, and inserting a staged point swaps views instead of copying
+    sw->data = (feature_t*)malloc(sizeof(feature_t) * ((size_t)sw->capacity + 1) * (size_t)sw->num_features);
+    sw->buffer = (DataPoint*)malloc(sizeof(DataPoint) * (size_t)sw->capacity);
+    // The same points by feature: column d holds every slot's value of feature d
+    sw->column_data = (feature_t*)malloc(sizeof(feature_t) * (size_t)sw->capacity * (size_t)sw->num_features);
+    sw->scores = (double*)calloc((size_t)sw->capacity, sizeof(double));
+    sw->path_sums = (double*)calloc((size_t)sw->capacity, sizeof(double));
+    sw->update_sums = (double*)malloc(sizeof(double) * 2 * (size_t)sw->capacity);
+    if (sw->data == NULL || sw->buffer == NULL || sw->column_data == NULL || sw->scores == NULL ||
+        sw->path_sums == NULL || sw->update_sums == NULL) {
+        perror("Error: Memory allocation failed for SlidingWindow buffers");
+        destroy_sliding_window(sw);
+        return NULL;
+    }
+    for (int i = 0; i < sw->capacity; i++) {
+        sw->buffer[i].features = sw->data + (size_t)i * sw->num_features;
+    }
+    sw->staging.features = sw->data + (size_t)sw->capacity * sw->num_features;
+    sw->columns.values = sw->column_data;
+    sw->columns.stride = (size_t)sw->capacity;
+
+    // Initialize the window as empty, with no cached anomalies
+    sw->anomaly_count = 0;
     sw->current_size = 0;
     sw->head = 0;
     sw->tail = 0;
-    
-    // Note: The buffer (DataPoint buffer[WINDOW_SIZE]) is statically allocated 
-    // within the struct, so no separate malloc is needed for the buffer itself.
+    sw->total_inserted = 0;
     
     return sw;
 }
@@ -112,6 +178,12 @@ SlidingWindow* create_sliding_window() {
  */
 void destroy_sliding_window(SlidingWindow* sw) {
     if (sw != NULL) {
+        free(sw->data);
+        free(sw->buffer);
+        free(sw->column_data);
+        free(sw->scores);
+        free(sw->path_sums);
+        free(sw->update_sums);
         free(sw);
     }
-}
\ No newline at end of file
+}
@@ -2,75 +2,181 @@
 #define CORE_DS_H
 
 #include <stdlib.h> // For size_t and NULL
+#include <stdbool.h> // For bool type
 #include <float.h>  // For DBL_MAX, DBL_MIN
 
-// --- Configuration Parameters ---
-#define NUM_FEATURES 29 // D: The dimensionality of your data 
-#define NUM_TREES 100    // T: The number of Isolation Trees in the Forest
-#define WINDOW_SIZE 256  // W: The size of the Sliding Window
-#define SAMPLE_SIZE 256  // psi (ψ): The number of points sampled for each tree (often W)
+// --- Default Configuration Parameters ---
+// All of these can be overridden at runtime (command line or config file, see config.h)
+#define DEFAULT_NUM_FEATURES 29 // D: The dimensionality of your data 
+#define DEFAULT_NUM_TREES 100    // T: The number of Isolation Trees in the Forest
+#define DEFAULT_WINDOW_SIZE 256  // W: The size of the Sliding Window
+#define DEFAULT_SAMPLE_SIZE 256  // psi (ψ): The number of points sampled for each tree (often W)
 
 // The anomaly score threshold for the basic IForestASD heuristic
-// Points with score > ANOMALY_THRESHOLD are considered anomalies (e.g., 0.6)
-#define ANOMALY_THRESHOLD 0.6 
+// Points with score > anomaly_threshold are considered anomalies (e.g., 0.6)
+#define DEFAULT_ANOMALY_THRESHOLD 0.6 
 // The desired anomaly rate (u) for the basic drift detection heuristic (e.g., 5%)
-#define DESIRED_ANOMALY_RATE_U 0.05 
+#define DEFAULT_DESIRED_ANOMALY_RATE_U 0.05 
+// Rolling updates: trees replaced per model update (0 = retrain the whole forest)
+#define DEFAULT_ROLLING_TREES 0
+// Points between scheduled model updates (0 = update only when drift is detected)
+#define DEFAULT_ROLLING_INTERVAL 0
+// Retrain on a background thread and swap the new model in (0 = retrain inline)
+#define DEFAULT_ASYNC_RETRAIN 0
+// Run reading, scoring and output on separate threads joined by rings (0 = one thread)
+#define DEFAULT_PIPELINE 0
+// Depth of every Half-Space Tree (the streaming alternative model, see hstree.h)
+#define DEFAULT_HST_DEPTH 8
+
+/**
+ * @brief Runtime dimensions and thresholds of a detector instance.
+ */
+typedef struct {
+    int num_features;               // D
+    int num_trees;                  // T
+    int window_size;                // W
+    int sample_size;                // ψ
+    double anomaly_threshold;       // Score at or above which a point is an anomaly
+    double desired_anomaly_rate_u;  // u: window anomaly rate that triggers retraining
+    int rolling_trees;              // k: oldest trees replaced per update (0 = full retrain)
+    int rolling_interval;           // N: points between scheduled updates (0 = on drift only)
+    int async_retrain;              // 1: full retrains run in the background (see async_trainer.h)
+    int pipeline;                   // 1: reader, scorer and output run as pipeline stages (see process_stream)
+    int hst_depth;                  // Depth of each Half-Space Tree (only used by the HS-Trees model)
+} IForestConfig;
 
 // --- Core Data Structure Definitions ---
 
+/**
+ * @brief Storage type of window points, split values and leaf path lengths.
+ * Building with IFOREST_FLOAT32 (make FLOAT32=1) stores them as float, halving the
+ * footprint of the window and of every tree; path lengths are still summed and scores
+ * computed in double. Training partitions with the stored (rounded) split value, so
+ * training and scoring make the same decisions.
+ */
+#ifdef IFOREST_FLOAT32
+typedef float feature_t;
+#else
+typedef double feature_t;
+#endif
+
 /**
  * @brief Represents a single data point in the stream.
+ * A DataPoint is a view onto num_features contiguous values owned elsewhere
+ * (typically a SlidingWindow slot or a batch buffer).
  */
 typedef struct {
-    double features[NUM_FEATURES];
+    feature_t* features;
 } DataPoint;
 
 /**
- * @brief Represents a node in an Isolation Tree (iTree).
+ * @brief Column-major (structure-of-arrays) view of a set of points, used for training.
+ * Feature d of point i is values[d * stride + i], so a split that looks at one feature
+ * sweeps a single contiguous column instead of striding across rows.
  */
-typedef struct Node {
-    int is_external;          // 1 if leaf node, 0 if internal node
-    int size;                 // Number of data points that reached this node (for leaves)
-    int height;               // Depth of the node (0 for root)
-
-    // Split information (used only for internal nodes)
-    int split_feature_index;  // The feature dimension used for the split (d)
-    double split_value;       // The random value used for the split (v)
+typedef struct {
+    const feature_t* values;  // num_features columns, stride values apart
+    size_t stride;            // Distance between consecutive columns (at least the number of points)
+} FeatureColumns;
 
-    struct Node* left;        // Pointer to the left child
-    struct Node* right;       // Pointer to the right child
+/**
+ * @brief Represents a node in a flattened Isolation Tree (iTree).
+ * Trees use an implicit complete-binary-tree layout: the children of node i are
+ * 2i+1 (left, x <= v) and 2i+2 (right), and every root-to-leaf walk is exactly
+ * max_depth steps long. A leaf reached before max_depth is expanded into
+ * pass-through nodes (split value +inf) whose bottom-level leaves all carry its
+ * path length, so scoring needs no leaf test and no child pointers.
+ * A node is two words of sizeof(feature_t) bytes: the feature index, then the value.
+ */
+typedef struct {
+    int split_feature_index;  // The feature dimension used for the split (d); 0 for pass-through/leaf nodes
+#ifndef IFOREST_FLOAT32
+    int reserved;             // Always 0 (keeps the node 16 bytes, with the index readable as 64-bit)
+#endif
+    feature_t value;          // Split value (v) for internal nodes, path length h(x) for bottom-level leaves
 } Node;
 
+/**
+ * @brief Represents a single Isolation Tree as one contiguous array of 2^(depth+1)-1 nodes
+ * (root at index 0, leaves in the last 2^depth slots).
+ * The node array is a slice of the owning forest's node arena.
+ */
+typedef struct {
+    Node* nodes;     // Implicit-layout node array (points into the forest's arena)
+    int node_count;  // Number of nodes in use (0 while the tree is untrained)
+    int depth;       // Number of splits on every root-to-leaf walk (the forest's max_depth)
+    long built_at;   // Training generation (forest->generation) that last built this tree
+    double min_path_length; // Smallest leaf path length (bounds h(x) for early-terminating decisions)
+    double max_path_length; // Largest leaf path length
+} ITree;
+
+struct ThreadPool; // Defined in thread_pool.h
+
 /**
  * @brief Represents the entire Isolation Forest (collection of iTrees).
+ * All trees share one node arena that is allocated once and refilled in place on retrain.
  */
 typedef struct {
-    Node* trees[NUM_TREES];
+    ITree* trees;         // num_trees trees
+    int num_trees;        // T
+    int num_features;     // D: features considered for splits
+    int sample_size;      // ψ: points sampled per tree
+    Node* node_arena;     // Single allocation backing the node arrays of all trees
+    int nodes_per_tree;   // Node capacity reserved for each tree in the arena
+    int max_depth;        // Maximum iTree depth: ceil(log2(sample_size))
+    long generation;      // Number of training runs (full or partial) so far
+    double min_path_length_total; // Sum of the trees' min_path_length (kept by update_path_length_totals)
+    double max_path_length_total; // Sum of the trees' max_path_length
+    struct ThreadPool* pool; // Optional worker pool used for training (not owned, may be NULL)
+    int* train_scratch;   // Training index workspace (W slots per worker), kept between retrains
+    size_t train_scratch_size; // Slots in train_scratch
+    long* tree_ages;      // 2 x num_trees (age, index) pairs sorted by select_oldest_trees
+    int* update_trees;    // num_trees slots for the trees a rolling update rebuilds
+    void* mapping;        // Model file mapping backing node_arena when loaded by load_forest (else NULL)
+    size_t mapping_size;  // Length of mapping in bytes
 } IsolationForest;
 
 /**
  * @brief Represents the Sliding Window, storing the most recent W data points.
+ * Points are kept twice: as rows (buffer[i], for scoring and output) and in one column
+ * per feature (columns, for training), both indexed by slot and updated by slide_window.
+ * Each slot also caches the point's anomaly score under the current model, so the
+ * window anomaly rate is maintained incrementally instead of rescoring every point.
  */
 typedef struct {
-    DataPoint buffer[WINDOW_SIZE];
-    int current_size;  // Current number of points in the window (<= WINDOW_SIZE)
+    feature_t* data;             // (capacity + 1) x num_features feature values, row-major
+    DataPoint* buffer;           // Per-slot views into data
+    DataPoint staging;           // Spare row that incoming points are parsed into before insertion
+    feature_t* column_data;      // num_features x capacity feature values, column-major
+    FeatureColumns columns;      // Training view of column_data (point i is slot i)
+    double* scores;              // Cached score s(x) of each slot under the current model
+    double* path_sums;           // Cached sum of h(x) over all trees for each slot (behind scores)
+    double* update_sums;         // 2 x capacity: replaced and rebuilt trees' sums during a rolling update
+    int capacity;                // W
+    int num_features;            // D
+    double anomaly_threshold;    // Score at or above which a cached score counts as an anomaly
+    int anomaly_count;           // Number of cached scores >= anomaly_threshold
+    int current_size;  // Current number of points in the window (<= capacity)
     int head;          // Index of the oldest element (where the next one will be evicted from)
     int tail;          // Index of the newest element (where the next one will be inserted)
+    long total_inserted; // Points inserted since creation (identifies slots changed since a snapshot)
 } SlidingWindow;
 
 
 // --- Function Prototypes for Memory Management (core_ds.c) ---
 
-// Node Management
-Node* create_node(int is_external, int size, int height);
-void free_tree(Node* root);
+// Tree Management
+int compute_max_depth(int sample_size);
+int max_tree_nodes(int max_depth);
+void reset_tree(ITree* tree);
 
 // Forest Management
-IsolationForest* create_forest();
+IsolationForest* create_forest(const IForestConfig* config);
 void free_forest(IsolationForest* forest);
+bool forest_is_trained(const IsolationForest* forest);
 
 // Window Management
-SlidingWindow* create_sliding_window();
+SlidingWindow* create_sliding_window(const IForestConfig* config);
 void destroy_sliding_window(SlidingWindow* sw);
 
 
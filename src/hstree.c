@@ -0,0 +1,197 @@
+#include "hstree.h"
+#include "rng.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+// --- Half-Space Tree Construction ---
+
+HalfSpaceForest* hst_create(const IForestConfig* config) {
+    HalfSpaceForest* forest = (HalfSpaceForest*)calloc(1, sizeof(HalfSpaceForest));
+    if (forest == NULL) {
+        perror("Error: Memory allocation failed for HalfSpaceForest");
+        return NULL;
+    }
+    forest->num_trees = config->num_trees;
+    forest->num_features = config->num_features;
+    forest->depth = config->hst_depth;
+    forest->nodes_per_tree = (1 << (forest->depth + 1)) - 1;
+    forest->window_size = config->window_size;
+    forest->size_limit = (int)ceil(HST_SIZE_LIMIT_FRACTION * config->window_size);
+    forest->nodes = (HSNode*)calloc((size_t)forest->num_trees * (size_t)forest->nodes_per_tree, sizeof(HSNode));
+    if (forest->nodes == NULL) {
+        perror("Error: Memory allocation failed for Half-Space Tree nodes");
+        free(forest);
+        return NULL;
+    }
+    return forest;
+}
+
+void hst_destroy(HalfSpaceForest* forest) {
+    if (forest != NULL) {
+        free(forest->nodes);
+        free(forest);
+    }
+}
+
+size_t hst_bytes(const HalfSpaceForest* forest) {
+    return sizeof(HalfSpaceForest) + sizeof(HSNode) * (size_t)forest->num_trees * (size_t)forest->nodes_per_tree;
+}
+
+/**
+ * Splits node_index's range [low, high) at its midpoint in a random feature and recurses;
+ * low and high are restored before returning.
+ */
+static void build_node(HSNode* nodes, RngState* rng, int num_features, double* low, double* high,
+                       int node_index, int height, int depth) {
+    HSNode* node = &nodes[node_index];
+    node->reference_mass = 0;
+    node->latest_mass = 0;
+    node->window = 0;
+    if (height == depth) {
+        node->split_feature_index = 0;
+        node->split = (feature_t)INFINITY; // Leaves are never split
+        return;
+    }
+    int q = rng_integer(rng, 0, num_features - 1);
+    double mid = 0.5 * (low[q] + high[q]);
+    node->split_feature_index = q;
+    node->split = (feature_t)mid;
+
+    double saved = high[q];
+    high[q] = mid;
+    build_node(nodes, rng, num_features, low, high, 2 * node_index + 1, height + 1, depth);
+    high[q] = saved;
+    saved = low[q];
+    low[q] = mid;
+    build_node(nodes, rng, num_features, low, high, 2 * node_index + 2, height + 1, depth);
+    low[q] = saved;
+}
+
+/**
+ * Brings a node's masses up to the given window: the latest mass of the window just
+ * before it becomes the reference, anything older is forgotten.
+ */
+static inline void roll_node(HSNode* node, int window) {
+    if (node->window != window) {
+        node->reference_mass = (node->window == window - 1) ? node->latest_mass : 0;
+        node->latest_mass = 0;
+        node->window = window;
+    }
+}
+
+/**
+ * The reference mass a node would have after roll_node, without modifying it.
+ */
+static inline int reference_mass(const HSNode* node, int window) {
+    if (node->window == window) return node->reference_mass;
+    return (node->window == window - 1) ? node->latest_mass : 0;
+}
+
+/**
+ * A tree's contribution mass * 2^k on a log scale: 0 for an empty region, log2(W) where
+ * the window is spread evenly over the work space, up to log2(W * 2^depth).
+ */
+static inline double log_mass(int mass, int k) {
+    return log2(1.0 + ldexp((double)mass, k));
+}
+
+static inline double score_from_mass(const HalfSpaceForest* forest, double total_log_mass) {
+    double full = log2(1.0 + ldexp((double)forest->window_size, forest->depth));
+    return 1.0 - total_log_mass / ((double)forest->num_trees * full);
+}
+
+void hst_build(HalfSpaceForest* forest, const DataPoint* points, int count, uint64_t seed) {
+    int D = forest->num_features;
+    double* data_min = (double*)malloc(sizeof(double) * 4 * (size_t)D);
+    if (data_min == NULL) {
+        perror("Error: Memory allocation failed for Half-Space Tree work space");
+        return;
+    }
+    double* data_max = data_min + D;
+    double* low = data_min + 2 * D;
+    double* high = data_min + 3 * D;
+
+    // 1. The range of each feature over the reference points
+    for (int q = 0; q < D; q++) {
+        data_min[q] = data_max[q] = points[0].features[q];
+    }
+    for (int i = 1; i < count; i++) {
+        for (int q = 0; q < D; q++) {
+            double v = points[i].features[q];
+            if (v < data_min[q]) data_min[q] = v;
+            if (v > data_max[q]) data_max[q] = v;
+        }
+    }
+
+    // 2. Per tree: a perturbed work space, then the midpoint splits
+    for (int t = 0; t < forest->num_trees; t++) {
+        RngState rng;
+        rng_seed(&rng, seed, (uint64_t)t);
+        for (int q = 0; q < D; q++) {
+            double span = (data_max[q] > data_min[q]) ? data_max[q] - data_min[q] : 1.0;
+            double pivot = rng_uniform(&rng, 0.0, 1.0);
+            double reach = 2.0 * fmax(pivot, 1.0 - pivot);
+            low[q] = data_min[q] + (pivot - reach) * span;
+            high[q] = data_min[q] + (pivot + reach) * span;
+        }
+        build_node(forest->nodes + (size_t)t * forest->nodes_per_tree, &rng, D, low, high, 0, 0, forest->depth);
+    }
+    free(data_min);
+    forest->points = 0;
+    forest->built = true;
+
+    // 3. The reference points form the first mass window
+    for (int i = 0; i < count; i++) {
+        hst_score_and_update(forest, &points[i]);
+    }
+}
+
+
+// --- Scoring and Updating ---
+
+double hst_score(const HalfSpaceForest* forest, const DataPoint* x) {
+    int window = (int)(forest->points / forest->window_size);
+    double total = 0.0;
+    for (int t = 0; t < forest->num_trees; t++) {
+        const HSNode* nodes = forest->nodes + (size_t)t * forest->nodes_per_tree;
+        int i = 0;
+        for (int k = 0; ; k++) {
+            int mass = reference_mass(&nodes[i], window);
+            if (k == forest->depth || mass < forest->size_limit) {
+                total += log_mass(mass, k);
+                break;
+            }
+            // !(x <= v) sends NaN right, as in the iTree walk
+            i = 2 * i + 1 + !(x->features[nodes[i].split_feature_index] <= nodes[i].split);
+        }
+    }
+    return score_from_mass(forest, total);
+}
+
+double hst_score_and_update(HalfSpaceForest* forest, const DataPoint* x) {
+    int window = (int)(forest->points / forest->window_size);
+    double total = 0.0;
+    for (int t = 0; t < forest->num_trees; t++) {
+        HSNode* nodes = forest->nodes + (size_t)t * forest->nodes_per_tree;
+        bool scored = false;
+        int i = 0;
+        for (int k = 0; ; k++) {
+            HSNode* node = &nodes[i];
+            roll_node(node, window);
+            // The score is read on the way down; the walk always continues to the leaf
+            if (!scored && (k == forest->depth || node->reference_mass < forest->size_limit)) {
+                total += log_mass(node->reference_mass, k);
+                scored = true;
+            }
+            node->latest_mass++;
+            if (k == forest->depth) {
+                break;
+            }
+            i = 2 * i + 1 + !(x->features[node->split_feature_index] <= node->split);
+        }
+    }
+    forest->points++;
+    return score_from_mass(forest, total);
+}
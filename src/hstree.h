@@ -0,0 +1,103 @@
+#ifndef HSTREE_H
+#define HSTREE_H
+
+#include "core_ds.h" // For DataPoint, IForestConfig, feature_t
+#include <stdint.h>  // For uint64_t
+#include <stdbool.h>
+
+// --- Streaming Half-Space Trees (HS-Trees) ---
+// An alternative to IForestASD whose model is never retrained: every tree splits a
+// randomly perturbed copy of the feature space in half at each level, and each node
+// counts the points that reach it. The counts of the last complete mass window
+// (W points) are the reference profile a point is scored against; the counts of the
+// current window become the next reference when it completes. Scoring and updating
+// take one root-to-leaf walk per tree, O(T * depth) per point, with no batch work.
+
+// Scoring stops at the first node whose reference mass is below this fraction of W
+#define HST_SIZE_LIMIT_FRACTION 0.1
+
+/**
+ * @brief A node of a Half-Space Tree (implicit complete-binary-tree layout, as in ITree:
+ * the children of node i are 2i+1 (x <= split) and 2i+2).
+ * Masses belong to the mass window in `window`; a node holding an older window is
+ * rolled over when it is next touched, so completing a window costs nothing.
+ */
+typedef struct {
+    feature_t split;            // Midpoint of the node's range in its split feature (internal nodes)
+    int split_feature_index;    // The feature halved at this node
+    int reference_mass;         // Points that reached the node in the window before `window`
+    int latest_mass;            // Points that reached it during `window`
+    int window;                 // Mass window the two counts refer to
+} HSNode;
+
+/**
+ * @brief A forest of Half-Space Trees sharing one node arena.
+ */
+typedef struct {
+    HSNode* nodes;          // num_trees x nodes_per_tree nodes
+    int num_trees;          // T
+    int num_features;       // D
+    int depth;              // Splits on every root-to-leaf walk
+    int nodes_per_tree;     // 2^(depth+1) - 1
+    int window_size;        // W: points per mass window
+    int size_limit;         // Reference mass below which a walk is scored (HST_SIZE_LIMIT_FRACTION * W)
+    long points;            // Points added so far (the current window is points / W)
+    bool built;             // The work space and splits are set (hst_build)
+} HalfSpaceForest;
+
+/**
+ * @brief Allocates a forest of config->num_trees trees of depth config->hst_depth,
+ * with mass windows of config->window_size points. Call hst_build before scoring.
+ * @param config The detector dimensions.
+ * @return The forest, or NULL on failure.
+ */
+HalfSpaceForest* hst_create(const IForestConfig* config);
+
+/**
+ * @brief Frees the forest and its node arena (NULL is ignored).
+ */
+void hst_destroy(HalfSpaceForest* forest);
+
+/**
+ * @brief Draws the trees' work spaces and splits, then adds the given points as the
+ * first mass window.
+ * * Each feature's work space is the range of the points, stretched around a random
+ * pivot (Tan et al.): for a pivot s in [0, 1) of the range, [s - 2m, s + 2m] with
+ * m = max(s, 1 - s). Only this one pass needs a batch of points; from then on the
+ * model is updated point by point.
+ * @param forest The forest to build.
+ * @param points The reference points (typically the first full window).
+ * @param count The number of points (>= 1).
+ * @param seed Base seed; tree i uses random stream i.
+ */
+void hst_build(HalfSpaceForest* forest, const DataPoint* points, int count, uint64_t seed);
+
+/**
+ * @brief Computes the anomaly score of x against the reference masses, without
+ * changing the model.
+ * * Each tree contributes mass * 2^k at the first node (depth k) whose reference mass is
+ * below the size limit, or at its leaf. The score is 1 - m / log2(1 + W * 2^depth), where
+ * m is the mean of log2(1 + contribution) over trees: in [0, 1] like the IForest score
+ * s(x), 1 for a point in a region that held no points in the last window, about 0.5
+ * where W points are spread evenly over the work space, and lower in denser regions.
+ * @param forest The built HalfSpaceForest.
+ * @param x The DataPoint to score.
+ * @return The anomaly score.
+ */
+double hst_score(const HalfSpaceForest* forest, const DataPoint* x);
+
+/**
+ * @brief Scores x (as hst_score) and adds it to the current mass window, in one walk
+ * per tree. Completing a window makes its masses the new reference.
+ * @param forest The built HalfSpaceForest.
+ * @param x The incoming DataPoint.
+ * @return The anomaly score of x before it was added.
+ */
+double hst_score_and_update(HalfSpaceForest* forest, const DataPoint* x);
+
+/**
+ * @brief Bytes used by the forest (nodes included).
+ */
+size_t hst_bytes(const HalfSpaceForest* forest);
+
+#endif // HSTREE_H
@@ -1,14 +1,28 @@
 #include "iforest.h"
 #include "core_ds.h"
-#include "utils.h" // Assumed to contain get_random_integer, get_random_uniform, etc.
+#include "utils.h" // For RngState, rng_integer, rng_uniform, sample_data_stream
+#include "thread_pool.h"
+#include "score_kernels.h"
 
 #include <stdio.h>
 #include <math.h>
 #include <limits.h>
 
+// Number of points kept in flight per tree during batch scoring
+#define SCORE_BLOCK_SIZE 64
+#define CLASSIFY_TREE_CHUNK 8 // Trees walked by classify_batch between pruning passes
+
+// Largest storable value below x
+#ifdef IFOREST_FLOAT32
+#define FEATURE_NEXT_DOWN(x) nextafterf((x), -INFINITY)
+#else
+#define FEATURE_NEXT_DOWN(x) nextafter((x), -INFINITY)
+#endif
+
 // Helper function prototype (used internally for recursion)
-static void find_min_max(DataPoint* data, int count, int feature_index, double* min_val, double* max_val);
-static void partition_data(DataPoint* data, int count, int feature_index, double split_value, DataPoint* left_set, int* left_count, DataPoint* right_set, int* right_count);
+static void fill_leaf_subtree(ITree* tree, int node_index, int height, double path_length);
+static void find_min_max(const feature_t* column, const int* indices, int count, double* min_val, double* max_val);
+static int partition_data(const feature_t* column, int* indices, int count, feature_t split_value);
 
 // --- IForest Core Implementation ---
 
@@ -16,112 +30,236 @@ static void partition_data(DataPoint* data, int count, int feature_index, double
  * @brief Recursively builds a single Isolation Tree (iTree).
  * * This is the heart of the training process.
  */
-Node* build_iTree(DataPoint* data, int count, int height, int max_depth) {
+void build_iTree(ITree* tree, RngState* rng, const FeatureColumns* columns, int num_features, int* indices, int count, int node_index, int height, int max_depth) {
     // 1. Check Base Cases (Stop Conditions)
     if (count <= 1 || height >= max_depth) {
-        // Stop if isolated (count=1) or max depth reached
-        return create_node(1, count, height); // External (Leaf) Node
-    }
-
-    // 2. Prepare Internal Node
-    Node* node = create_node(0, count, height); // Internal Node
-    if (node == NULL) {
-        return NULL; // Allocation error
+        // Stop if isolated (count=1) or max depth reached: External (Leaf) Node
+        fill_leaf_subtree(tree, node_index, height, height + average_path_length_constant(count));
+        return;
     }
 
-    // 3. Choose Random Split
+    // 2. Choose Random Split
     
     // a) Choose a random feature (dimension) d
-    int feature_index = get_random_integer(0, NUM_FEATURES - 1);
-    node->split_feature_index = feature_index;
+    int feature_index = rng_integer(rng, 0, num_features - 1);
+    const feature_t* column = columns->values + (size_t)feature_index * columns->stride;
 
     // b) Find min/max values in the current subset for that feature
     double min_val, max_val;
-    find_min_max(data, count, feature_index, &min_val, &max_val);
+    find_min_max(column, indices, count, &min_val, &max_val);
 
     if (min_val == max_val) {
         // If all values are the same, isolation is complete (treat as a leaf)
-        free(node);
-        return create_node(1, count, height);
+        fill_leaf_subtree(tree, node_index, height, height + average_path_length_constant(count));
+        return;
     }
     
-    // c) Choose a random split value v between min_val and max_val
-    double split_value = get_random_uniform(min_val, max_val);
-    node->split_value = split_value;
+    // c) Choose a random split value v between min_val and max_val, as stored: the
+    //    partition below uses the same value that scoring compares against. Rounding to
+    //    the storage type may reach max_val, which must still go right.
+    feature_t split_value = (feature_t)rng_uniform(rng, min_val, max_val);
+    if (!(split_value < max_val)) {
+        split_value = FEATURE_NEXT_DOWN((feature_t)max_val);
+    }
+    tree->nodes[node_index].split_feature_index = feature_index;
+#ifndef IFOREST_FLOAT32
+    tree->nodes[node_index].reserved = 0;
+#endif
+    tree->nodes[node_index].value = split_value;
 
-    // 4. Partition Data and Recurse
+    // 3. Partition Indices In Place and Recurse
+    
+    // After partitioning, indices[0, left_count) go left and the rest go right
+    int left_count = partition_data(column, indices, count, split_value);
+    int right_count = count - left_count;
     
-    // Temporary storage for partitioned subsets (must be large enough)
-    DataPoint left_set[count], right_set[count];
-    int left_count = 0, right_count = 0;
+    // Recursively build children at their implicit positions 2i+1 and 2i+2
+    build_iTree(tree, rng, columns, num_features, indices, left_count, 2 * node_index + 1, height + 1, max_depth);
+    build_iTree(tree, rng, columns, num_features, indices + left_count, right_count, 2 * node_index + 2, height + 1, max_depth);
+}
 
-    // Partition the data based on the split condition
-    partition_data(data, count, feature_index, split_value, left_set, &left_count, right_set, &right_count);
+/**
+ * Shared, read-only state of one training run.
+ */
+typedef struct {
+    IsolationForest* forest;
+    const FeatureColumns* columns;
+    int window_size;
+    uint64_t seed;       // Base seed of this retrain; tree i uses stream i
+    int* scratch;        // window_size index slots per worker
+    const int* trees;    // Trees to build, one per task (NULL: task i builds tree i)
+} TrainJob;
+
+/**
+ * Thread pool task: samples and builds the task's tree.
+ */
+static void train_tree_task(void* ctx, int task_index, int worker_index) {
+    TrainJob* job = (TrainJob*)ctx;
+    const IsolationForest* forest = job->forest;
+    int tree_index = (job->trees != NULL) ? job->trees[task_index] : task_index;
+    ITree* tree = &forest->trees[tree_index];
+
+    // Each tree owns its random stream, so the result does not depend on the worker
+    RngState rng;
+    rng_seed(&rng, job->seed, (uint64_t)tree_index);
+
+    // 1. Sample Data (ψ points)
+    // The worker's scratch array holds a permutation of window positions whose
+    // first sample_count entries are the sample for the current tree
+    int* sample_indices = job->scratch + (size_t)worker_index * job->window_size;
     
-    // Recursively build children
-    node->left = build_iTree(left_set, left_count, height + 1, max_depth);
-    node->right = build_iTree(right_set, right_count, height + 1, max_depth);
+    // This utility function is crucial: it randomly selects sample_size positions 
+    // from the window (size W) without copying the points themselves.
+    int sample_count = sample_data_stream(&rng, job->window_size, sample_indices, forest->sample_size);
+
+    // 2. Build the iTree
+    // Retraining (concept drift) rebuilds the tree in place within its arena slice
+    reset_tree(tree);
+
+    build_iTree(tree, &rng, job->columns, forest->num_features, sample_indices, sample_count, 0, 0, tree->depth);
+    tree->node_count = forest->nodes_per_tree;
+    compute_path_length_bounds(tree);
+    tree->built_at = forest->generation;
+}
+
+/**
+ * @brief Builds count trees (all of them if trees is NULL) as one training generation.
+ */
+static void train_trees(IsolationForest* forest, const FeatureColumns* columns, int window_size,
+                        const int* trees, int count, uint64_t seed) {
+    // One index workspace per worker, kept with the forest: only the first retrain
+    // (or one on a larger pool or window) allocates it
+    int workers = thread_pool_size(forest->pool);
+    size_t scratch_size = (size_t)workers * (size_t)window_size;
+    if (forest->train_scratch_size < scratch_size) {
+        int* scratch = (int*)realloc(forest->train_scratch, sizeof(int) * scratch_size);
+        if (scratch == NULL) {
+            perror("Error: Memory allocation failed for training workspace");
+            return;
+        }
+        forest->train_scratch = scratch;
+        forest->train_scratch_size = scratch_size;
+    }
 
-    return node;
+    // Maximum depth for the iTrees (ceil(log2(sample_size))) was fixed when the
+    // forest's node arena was sized; the trees are independent and built in parallel
+    forest->generation++;
+    TrainJob job = { forest, columns, window_size, seed, forest->train_scratch, trees };
+    thread_pool_run(forest->pool, count, train_tree_task, &job);
+    update_path_length_totals(forest);
 }
 
 /**
  * @brief Trains the entire Isolation Forest (T trees).
  */
-void train_iforest(IsolationForest* forest, DataPoint* window_data, int window_size) {
+void train_iforest(IsolationForest* forest, const FeatureColumns* columns, int window_size) {
     if (forest == NULL || window_size == 0) return;
+    train_trees(forest, columns, window_size, NULL, forest->num_trees, get_random_seed());
+}
 
-    // Calculate maximum depth for the iTrees: ceil(log2(SAMPLE_SIZE))
-    // We use log2((double)SAMPLE_SIZE) for accurate calculation
-    int max_depth = (int)ceil(log2((double)SAMPLE_SIZE)); 
-    if (max_depth == 0) max_depth = 1;
-
-    for (int i = 0; i < NUM_TREES; i++) {
-        // 1. Sample Data (ψ points)
-        // This array will hold the sampled data for the current tree
-        DataPoint sample_data[SAMPLE_SIZE]; 
-        
-        // This utility function is crucial: it randomly selects SAMPLE_SIZE points 
-        // from window_data (size W) and stores them in sample_data.
-        sample_data_stream(window_data, window_size, sample_data, SAMPLE_SIZE); 
-
-        // 2. Build the iTree
-        // Free old tree if retraining (important for concept drift)
-        if (forest->trees[i] != NULL) {
-            free_tree(forest->trees[i]);
-            forest->trees[i] = NULL;
-        }
+/**
+ * @brief Trains the entire Isolation Forest from an explicit base seed.
+ */
+void train_iforest_seeded(IsolationForest* forest, const FeatureColumns* columns, int window_size, uint64_t seed) {
+    if (forest == NULL || window_size == 0) return;
+    train_trees(forest, columns, window_size, NULL, forest->num_trees, seed);
+}
+
+/**
+ * @brief Rebuilds only the listed trees from the current window (one training generation).
+ */
+void train_selected_trees(IsolationForest* forest, const FeatureColumns* columns, int window_size,
+                          const int* trees, int count) {
+    if (forest == NULL || window_size == 0 || count <= 0) return;
+    train_trees(forest, columns, window_size, trees, count, get_random_seed());
+}
 
-        forest->trees[i] = build_iTree(sample_data, SAMPLE_SIZE, 0, max_depth);
+/**
+ * @brief Scans the bottom-level leaves (the last 2^depth nodes) for the range of h(x).
+ */
+void compute_path_length_bounds(ITree* tree) {
+    if (tree->node_count == 0) {
+        tree->min_path_length = 0.0;
+        tree->max_path_length = 0.0;
+        return;
     }
+    int first_leaf = (1 << tree->depth) - 1;
+    double min_val = tree->nodes[first_leaf].value;
+    double max_val = min_val;
+    for (int i = first_leaf + 1; i < 2 * first_leaf + 1; i++) {
+        double value = tree->nodes[i].value;
+        if (value < min_val) min_val = value;
+        if (value > max_val) max_val = value;
+    }
+    tree->min_path_length = min_val;
+    tree->max_path_length = max_val;
 }
 
+/**
+ * @brief Sums the trees' path length bounds in tree order.
+ */
+void update_path_length_totals(IsolationForest* forest) {
+    double min_total = 0.0, max_total = 0.0;
+    for (int t = 0; t < forest->num_trees; t++) {
+        min_total += forest->trees[t].min_path_length;
+        max_total += forest->trees[t].max_path_length;
+    }
+    forest->min_path_length_total = min_total;
+    forest->max_path_length_total = max_total;
+}
 
-// --- Scoring Implementation ---
+/**
+ * Orders (age key, tree index) pairs oldest first.
+ */
+static int compare_tree_age(const void* a, const void* b) {
+    const long* x = (const long*)a;
+    const long* y = (const long*)b;
+    if (x[0] != y[0]) return (x[0] < y[0]) ? -1 : 1;
+    return (x[1] < y[1]) ? -1 : (x[1] > y[1]);
+}
 
 /**
- * @brief Traverses a single iTree to find the path length (depth) for a given point.
+ * @brief Lists the k oldest trees of the forest.
  */
-double get_path_length(Node* root, DataPoint x, double current_path_len) {
-    if (root == NULL) {
-        // Should not happen if data is processed correctly, but safety check.
-        return current_path_len; 
+int select_oldest_trees(IsolationForest* forest, int k, int* trees) {
+    if (forest == NULL || k <= 0) return 0;
+    if (k > forest->num_trees) k = forest->num_trees;
+
+    // An untrained tree always counts as the oldest; ties go to the lower index
+    long* ages = forest->tree_ages;
+    for (int i = 0; i < forest->num_trees; i++) {
+        ages[2 * i] = (forest->trees[i].node_count == 0) ? LONG_MIN : forest->trees[i].built_at;
+        ages[2 * i + 1] = i;
     }
-
-    if (root->is_external) {
-        // If external (leaf) node, adjust for the case where the leaf contains >1 point.
-        // We add the correction factor C(size) to the path length.
-        return current_path_len + average_path_length_constant(root->size);
+    qsort(ages, (size_t)forest->num_trees, 2 * sizeof(long), compare_tree_age);
+    for (int i = 0; i < k; i++) {
+        trees[i] = (int)ages[2 * i + 1];
     }
+    return k;
+}
 
-    // Internal node: check split condition
-    int feature_index = root->split_feature_index;
 
-    if (x.features[feature_index] <= root->split_value) {
-        return get_path_length(root->left, x, current_path_len + 1);
-    } else {
-        return get_path_length(root->right, x, current_path_len + 1);
+// --- Scoring Implementation ---
+
+/**
+ * @brief Walks a single iTree to find the path length (depth) for a given point.
+ * * Every walk takes exactly tree->depth steps (early leaves are padded with
+ * pass-through nodes), ending at a bottom-level leaf holding height + c(size).
+ */
+double get_path_length(const ITree* tree, const DataPoint* x) {
+    const Node* nodes = tree->nodes;
+    if (nodes == NULL || tree->node_count == 0) {
+        // Should not happen if data is processed correctly, but safety check.
+        return 0.0;
     }
+
+    int index = 0;
+    for (int d = 0; d < tree->depth; d++) {
+        // Internal node: go left (2i+1) if x <= v, else right (2i+2)
+        int go_right = !(x->features[nodes[index].split_feature_index] <= nodes[index].value);
+        index = 2 * index + 1 + go_right;
+    }
+    return nodes[index].value;
 }
 
 /**
@@ -150,20 +288,22 @@ double average_path_length_constant(int n) {
 }
 
 /**
- * @brief Computes the final anomaly score s(x) for a point x across the entire Forest.
+ * @brief Sums the path lengths of x over all trees of the forest.
  */
-double calculate_score(IsolationForest* forest, DataPoint x, int sample_size) {
-    if (forest == NULL || sample_size <= 0) return 0.0;
-    
+double forest_path_length_sum(const IsolationForest* forest, const DataPoint* x) {
     double total_path_length = 0.0;
+    for (int i = 0; i < forest->num_trees; i++) {
+        total_path_length += get_path_length(&forest->trees[i], x);
+    }
+    return total_path_length;
+}
 
+/**
+ * @brief Converts a path-length sum over the forest into the anomaly score s(x).
+ */
+double score_from_path_length_sum(const IsolationForest* forest, double total_path_length, int sample_size) {
     // 1. Calculate E[h(x)] - Average Path Length
-    for (int i = 0; i < NUM_TREES; i++) {
-        if (forest->trees[i] != NULL) {
-            total_path_length += get_path_length(forest->trees[i], x, 0.0);
-        }
-    }
-    double avg_path_length = total_path_length / (double)NUM_TREES;
+    double avg_path_length = total_path_length / (double)forest->num_trees;
 
     // 2. Calculate Normalization Constant c(n)
     double c_n = average_path_length_constant(sample_size);
@@ -175,41 +315,209 @@ double calculate_score(IsolationForest* forest, DataPoint x, int sample_size) {
     // 3. Compute Final Score s(x) = 2 ^ (-E[h(x)] / c(n))
     // We use the pow() function from <math.h>
     double exponent = -(avg_path_length / c_n);
-    double score = pow(2.0, exponent); // 
+    return pow(2.0, exponent);
+}
+
+/**
+ * @brief Computes the final anomaly score s(x) for a point x across the entire Forest.
+ */
+double calculate_score(const IsolationForest* forest, const DataPoint* x, int sample_size) {
+    if (forest == NULL || sample_size <= 0) return 0.0;
+    return score_from_path_length_sum(forest, forest_path_length_sum(forest, x), sample_size);
+}
+
+/**
+ * @brief Computes the anomaly scores of n points at once (tree-major traversal).
+ */
+void calculate_score_batch(const IsolationForest* forest, const DataPoint* pts, int n, int sample_size, double* out) {
+    if (forest == NULL || sample_size <= 0) {
+        for (int i = 0; i < n; i++) out[i] = 0.0;
+        return;
+    }
+
+    double c_n = average_path_length_constant(sample_size);
+
+    for (int start = 0; start < n; start += SCORE_BLOCK_SIZE) {
+        int block = (n - start < SCORE_BLOCK_SIZE) ? n - start : SCORE_BLOCK_SIZE;
+        double total_path_length[SCORE_BLOCK_SIZE] = { 0.0 };
+
+        // 1. Accumulate path lengths tree by tree (same summation order as calculate_score);
+        // the kernel walks several points through the tree at once where the CPU allows
+        for (int t = 0; t < forest->num_trees; t++) {
+            accumulate_path_lengths(&forest->trees[t], &pts[start], block, total_path_length);
+        }
 
-    return score;
+        // 2. Convert to scores s(x) = 2 ^ (-E[h(x)] / c(n))
+        for (int j = 0; j < block; j++) {
+            if (c_n == 0.0) {
+                out[start + j] = 0.5;
+                continue;
+            }
+            double avg_path_length = total_path_length[j] / (double)forest->num_trees;
+            out[start + j] = pow(2.0, -(avg_path_length / c_n));
+        }
+    }
+}
+
+/**
+ * @brief Decides s(x) >= threshold, stopping once the remaining trees cannot change the outcome.
+ */
+bool classify_point(const IsolationForest* forest, const DataPoint* x, int sample_size, double threshold, int* trees_evaluated) {
+    if (trees_evaluated != NULL) *trees_evaluated = 0;
+    if (forest == NULL || sample_size <= 0) return 0.0 >= threshold;
+
+    double c_n = average_path_length_constant(sample_size);
+    if (c_n == 0.0) return 0.5 >= threshold;
+
+    // s(x) >= threshold  <=>  sum of h(x) <= limit
+    double limit = -log2(threshold) * c_n * (double)forest->num_trees;
+    // Decisions closer to the limit than rounding could blur are left to the exact score
+    double margin = 1e-9 * (fabs(limit) + 1.0);
+
+    double remaining_min = forest->min_path_length_total;
+    double remaining_max = forest->max_path_length_total;
+
+    double total_path_length = 0.0;
+    int t = 0;
+    while (t < forest->num_trees) {
+        const ITree* tree = &forest->trees[t];
+        total_path_length += get_path_length(tree, x);
+        remaining_min -= tree->min_path_length;
+        remaining_max -= tree->max_path_length;
+        t++;
+        if (t == forest->num_trees) break;
+        if (total_path_length + remaining_min > limit + margin) {
+            if (trees_evaluated != NULL) *trees_evaluated = t;
+            return false; // Too deep to be an anomaly even if every remaining tree isolates x at once
+        }
+        if (total_path_length + remaining_max < limit - margin) {
+            if (trees_evaluated != NULL) *trees_evaluated = t;
+            return true;  // Too shallow to be normal even if every remaining tree takes its longest path
+        }
+    }
+    if (trees_evaluated != NULL) *trees_evaluated = t;
+    return score_from_path_length_sum(forest, total_path_length, sample_size) >= threshold;
+}
+
+/**
+ * @brief Decides s(x) >= threshold for n points, walking the trees in chunks through the
+ * batch kernels and dropping the points each chunk decides.
+ */
+void classify_batch(const IsolationForest* forest, const DataPoint* pts, int n, int sample_size, double threshold, bool* out) {
+    double c_n = (forest != NULL && sample_size > 0) ? average_path_length_constant(sample_size) : 0.0;
+    if (forest == NULL || sample_size <= 0 || c_n == 0.0) {
+        bool constant = ((forest == NULL || sample_size <= 0) ? 0.0 : 0.5) >= threshold;
+        for (int j = 0; j < n; j++) {
+            out[j] = constant;
+        }
+        return;
+    }
+
+    // Same limit and margin as classify_point
+    double limit = -log2(threshold) * c_n * (double)forest->num_trees;
+    double margin = 1e-9 * (fabs(limit) + 1.0);
+
+    for (int start = 0; start < n; start += SCORE_BLOCK_SIZE) {
+        int block = (n - start < SCORE_BLOCK_SIZE) ? n - start : SCORE_BLOCK_SIZE;
+        DataPoint active[SCORE_BLOCK_SIZE]; // Undecided points, compacted after every chunk
+        int position[SCORE_BLOCK_SIZE];     // Their index in the block
+        double total_path_length[SCORE_BLOCK_SIZE];
+        for (int j = 0; j < block; j++) {
+            active[j] = pts[start + j];
+            position[j] = j;
+            total_path_length[j] = 0.0;
+        }
+        int live = block;
+
+        // Each point still sums its trees in order, so undecided points end on the exact score
+        double remaining_min = forest->min_path_length_total;
+        double remaining_max = forest->max_path_length_total;
+        int t = 0;
+        while (live > 0 && t < forest->num_trees) {
+            int end = (forest->num_trees - t < CLASSIFY_TREE_CHUNK) ? forest->num_trees : t + CLASSIFY_TREE_CHUNK;
+            for (; t < end; t++) {
+                accumulate_path_lengths(&forest->trees[t], active, live, total_path_length);
+                remaining_min -= forest->trees[t].min_path_length;
+                remaining_max -= forest->trees[t].max_path_length;
+            }
+            if (t == forest->num_trees) break;
+            int kept = 0;
+            for (int j = 0; j < live; j++) {
+                if (total_path_length[j] + remaining_min > limit + margin) {
+                    out[start + position[j]] = false;
+                } else if (total_path_length[j] + remaining_max < limit - margin) {
+                    out[start + position[j]] = true;
+                } else {
+                    active[kept] = active[j];
+                    position[kept] = position[j];
+                    total_path_length[kept] = total_path_length[j];
+                    kept++;
+                }
+            }
+            live = kept;
+        }
+        for (int j = 0; j < live; j++) {
+            out[start + position[j]] = score_from_path_length_sum(forest, total_path_length[j], sample_size) >= threshold;
+        }
+    }
 }
 
 // --- Internal Helper Functions (Static) ---
 
 /**
- * Finds the minimum and maximum values for a specified feature in the data subset.
+ * Turns node_index into a leaf with the given path length. If the leaf sits above the
+ * tree's bottom level, its subtree is filled with pass-through nodes (x <= +inf always
+ * goes left) and every bottom-level leaf below it receives the path length, so fixed-depth
+ * walks land on the same value.
  */
-static void find_min_max(DataPoint* data, int count, int feature_index, double* min_val, double* max_val) {
-    *min_val = DBL_MAX;
-    *max_val = DBL_MIN;
+static void fill_leaf_subtree(ITree* tree, int node_index, int height, double path_length) {
+    int first = node_index;
+    int width = 1;
+    for (int level = height; level <= tree->depth; level++) {
+        for (int i = first; i < first + width; i++) {
+            tree->nodes[i].split_feature_index = 0;
+#ifndef IFOREST_FLOAT32
+            tree->nodes[i].reserved = 0;
+#endif
+            tree->nodes[i].value = (feature_t)((level == tree->depth) ? path_length : INFINITY);
+        }
+        first = 2 * first + 1;
+        width *= 2;
+    }
+}
 
-    for (int i = 0; i < count; i++) {
-        double val = data[i].features[feature_index];
-        if (val < *min_val) *min_val = val;
-        if (val > *max_val) *max_val = val;
+/**
+ * Finds the minimum and maximum of the indexed entries (count >= 1) of one feature column.
+ * The loop is a branch-free reduction over a single contiguous column.
+ */
+static void find_min_max(const feature_t* column, const int* indices, int count, double* min_val, double* max_val) {
+    feature_t lo = column[indices[0]];
+    feature_t hi = lo;
+
+    for (int i = 1; i < count; i++) {
+        feature_t val = column[indices[i]];
+        lo = (val < lo) ? val : lo;
+        hi = (val > hi) ? val : hi;
     }
+    *min_val = lo;
+    *max_val = hi;
 }
 
 /**
- * Partitions the data into left (<= split_value) and right (> split_value) subsets.
+ * Partitions the indices in place so that points with feature <= split_value come
+ * first, followed by points with feature > split_value (the order within each part
+ * is not preserved). Returns the number of indices in the left (<= split_value) part.
  */
-static void partition_data(DataPoint* data, int count, int feature_index, double split_value, 
-                           DataPoint* left_set, int* left_count, 
-                           DataPoint* right_set, int* right_count) {
-    *left_count = 0;
-    *right_count = 0;
+static int partition_data(const feature_t* column, int* indices, int count, feature_t split_value) {
+    int left = 0;
 
     for (int i = 0; i < count; i++) {
-        if (data[i].features[feature_index] <= split_value) {
-            left_set[(*left_count)++] = data[i];
-        } else {
-            right_set[(*right_count)++] = data[i];
-        }
+        // Unconditional swap: [0, left) go left, [left, i] go right; left advances on a
+        // left-going point, so the loop has no data-dependent branch
+        int index = indices[i];
+        indices[i] = indices[left];
+        indices[left] = index;
+        left += (column[index] <= split_value);
     }
-}
\ No newline at end of file
+    return left;
+}
@@ -1,41 +1,96 @@
 #ifndef IFOREST_H
 #define IFOREST_H
 
-#include "core_ds.h" // Includes DataPoint, Node, IsolationForest structs
+#include "core_ds.h" // Includes DataPoint, Node, ITree, IsolationForest structs
+#include "utils.h"   // For RngState
 
 // --- IForest Core Functions ---
 
 /**
- * @brief Recursively builds a single Isolation Tree (iTree).
- * * @param data Array of DataPoints used for training this node.
- * @param count Number of DataPoints in the data array.
+ * @brief Recursively builds a single Isolation Tree (iTree) into the tree's node array.
+ * * Nodes are written at their implicit positions (children of i at 2i+1 and 2i+2);
+ * leaves store their final path length (height + c(size)) so scoring never needs
+ * to recompute it.
+ * Training works on an index array into the window that is partitioned in place,
+ * so no point data is copied while the tree is built.
+ * @param tree The tree whose node array receives the new nodes.
+ * @param rng The tree's random stream.
+ * @param columns The points of the Sliding Window, one column per feature.
+ * @param num_features Number of features (D) a split may choose from.
+ * @param indices Window positions of the points reaching this node (reordered in place).
+ * @param count Number of entries in the indices array.
+ * @param node_index The implicit-layout position of this node (0 for root).
  * @param height The current depth of the node (0 for root).
  * @param max_depth The maximum path length for this tree (ceil(log2(sample_size))).
- * @return The root Node of the built iTree.
  */
-Node* build_iTree(DataPoint* data, int count, int height, int max_depth);
+void build_iTree(ITree* tree, RngState* rng, const FeatureColumns* columns, int num_features, int* indices, int count, int node_index, int height, int max_depth);
 
 /**
- * @brief Trains the entire Isolation Forest by building NUM_TREES iTrees.
- * * Note: This function will typically handle the random sampling (ψ) of the window data 
- * before calling build_iTree for each tree.
+ * @brief Trains the entire Isolation Forest by building forest->num_trees iTrees.
+ * * Note: This function handles the random sampling (ψ) of window indices 
+ * before calling build_iTree for each tree. Trees are built in parallel on
+ * forest->pool when one is attached; each tree draws from its own random stream
+ * (seeded from one global draw plus the tree index), so for a fixed global seed
+ * the resulting forest does not depend on the number of threads.
  * * @param forest Pointer to the IsolationForest structure to populate.
- * @param window_data All data points currently in the Sliding Window.
+ * @param columns The points of the Sliding Window, one column per feature (e.g. &sw->columns).
  * @param window_size The total number of points in the window (W).
  */
-void train_iforest(IsolationForest* forest, DataPoint* window_data, int window_size);
+void train_iforest(IsolationForest* forest, const FeatureColumns* columns, int window_size);
+
+/**
+ * @brief Like train_iforest, but with the base seed supplied by the caller instead of
+ * drawn from the global generator (so a background build can use a seed drawn on the
+ * thread that requested it).
+ * * @param forest Pointer to the IsolationForest structure to populate.
+ * @param columns The points to train on, one column per feature.
+ * @param window_size The number of points (W).
+ * @param seed Base seed; tree i uses random stream i.
+ */
+void train_iforest_seeded(IsolationForest* forest, const FeatureColumns* columns, int window_size, uint64_t seed);
+
+/**
+ * @brief Lists the k oldest trees, for a rolling update that replaces only those.
+ * * Trees are ordered by the training generation that last built them (untrained
+ * trees first, ties broken by tree index), so successive rolling updates cycle
+ * through the whole forest. Sorts in the forest's tree_ages workspace (no allocation).
+ * * @param forest The IsolationForest.
+ * @param k Number of trees wanted (clamped to T).
+ * @param trees Receives the indices of the k oldest trees, oldest first.
+ * @return The number of indices written.
+ */
+int select_oldest_trees(IsolationForest* forest, int k, int* trees);
+
+/**
+ * @brief Rebuilds only the listed trees from the current window.
+ * * This is one training generation: forest->generation is advanced and the rebuilt
+ * trees are stamped with it. The work is bounded by count tree builds.
+ * * @param forest Pointer to the IsolationForest.
+ * @param columns The points of the Sliding Window, one column per feature.
+ * @param window_size The total number of points in the window (W).
+ * @param trees Indices of the trees to rebuild.
+ * @param count Number of entries in trees.
+ */
+void train_selected_trees(IsolationForest* forest, const FeatureColumns* columns, int window_size,
+                          const int* trees, int count);
+
+/**
+ * @brief Records the smallest and largest leaf path length of a built tree.
+ * * Training calls this for every tree it builds; a loaded model calls it once per tree.
+ * @param tree The trained iTree.
+ */
+void compute_path_length_bounds(ITree* tree);
 
 
 // --- Scoring Functions ---
 
 /**
- * @brief Traverses a single iTree to find the path length (depth) for a given point.
- * * @param root The root node of the iTree.
+ * @brief Walks a single iTree to find the path length (depth) for a given point.
+ * * @param tree The iTree to traverse.
  * @param x The DataPoint to score.
- * @param current_path_len Initial path length (usually 0).
  * @return The path length h(x) for point x in this tree.
  */
-double get_path_length(Node* root, DataPoint x, double current_path_len);
+double get_path_length(const ITree* tree, const DataPoint* x);
 
 /**
  * @brief Calculates the normalization constant c(n) for a given sample size n.
@@ -45,6 +100,24 @@ double get_path_length(Node* root, DataPoint x, double current_path_len);
  */
 double average_path_length_constant(int n);
 
+/**
+ * @brief Sums h(x) over all trees of the forest (in tree order).
+ * * @param forest The trained IsolationForest.
+ * @param x The DataPoint to score.
+ * @return The total path length; divided by T this is E[h(x)].
+ */
+double forest_path_length_sum(const IsolationForest* forest, const DataPoint* x);
+
+/**
+ * @brief Converts a forest-wide path-length sum into the anomaly score s(x).
+ * * score_from_path_length_sum(f, forest_path_length_sum(f, x), ψ) == calculate_score(f, x, ψ).
+ * * @param forest The trained IsolationForest (for T).
+ * @param total_path_length The sum of h(x) over all trees.
+ * @param sample_size The sample size (ψ) used to train the trees.
+ * @return The anomaly score s(x).
+ */
+double score_from_path_length_sum(const IsolationForest* forest, double total_path_length, int sample_size);
+
 /**
  * @brief Computes the final anomaly score s(x) for a point x across the entire Forest.
  * * s(x) = 2 ^ (-E[h(x)] / c(n))
@@ -53,6 +126,59 @@ double average_path_length_constant(int n);
  * @param sample_size The sample size (ψ) used to train the trees.
  * @return The final anomaly score s(x), ranging from 0 to 1.
  */
-double calculate_score(IsolationForest* forest, DataPoint x, int sample_size);
+double calculate_score(const IsolationForest* forest, const DataPoint* x, int sample_size);
+
+/**
+ * @brief Computes the anomaly scores of n points at once.
+ * * Traversal is tree-major: within each block of points, the outer loop runs over
+ * the trees and the inner loop over the points, so each tree stays hot in L1/L2
+ * while the whole block passes through it. Scores are identical to calculate_score.
+ * @param forest The trained IsolationForest.
+ * @param pts The DataPoints to score.
+ * @param n The number of points.
+ * @param sample_size The sample size (ψ) used to train the trees.
+ * @param out Receives the n anomaly scores.
+ */
+void calculate_score_batch(const IsolationForest* forest, const DataPoint* pts, int n, int sample_size, double* out);
+
+/**
+ * @brief Decides whether s(x) >= threshold without always walking every tree.
+ * * s(x) >= threshold exactly when the path-length sum is at most
+ * -log2(threshold) * c(ψ) * T. Trees are walked in order, and the walk stops as soon
+ * as the remaining trees' leaf bounds (ITree::min_path_length/max_path_length) can
+ * no longer move the sum across that limit. A decision that stays open until the last
+ * tree is made on the exact score, so the result always equals
+ * calculate_score(forest, x, sample_size) >= threshold.
+ * @param forest The trained IsolationForest.
+ * @param x The DataPoint to classify.
+ * @param sample_size The sample size (ψ) used to train the trees.
+ * @param threshold The anomaly score threshold, in (0, 1].
+ * @param trees_evaluated Optional; receives the number of trees walked.
+ * @return true if x is an anomaly (s(x) >= threshold).
+ */
+bool classify_point(const IsolationForest* forest, const DataPoint* x, int sample_size, double threshold, int* trees_evaluated);
+
+/**
+ * @brief classify_point for n points at once, on the batch kernels.
+ * * Blocks of points go through the trees a small chunk at a time, tree-major as in
+ * calculate_score_batch; after each chunk the points whose outcome the remaining
+ * trees' bounds can no longer change are decided and dropped from the block. Each
+ * result equals calculate_score(forest, pts[j], sample_size) >= threshold.
+ * @param forest The trained IsolationForest.
+ * @param pts The DataPoints to classify.
+ * @param n The number of points.
+ * @param sample_size The sample size (ψ) used to train the trees.
+ * @param threshold The anomaly score threshold, in (0, 1].
+ * @param out Receives the n decisions (true: anomaly).
+ */
+void classify_batch(const IsolationForest* forest, const DataPoint* pts, int n, int sample_size, double threshold, bool* out);
+
+/**
+ * @brief Recomputes the forest's min/max path length totals from its trees' bounds.
+ * * Training calls it after every (full or partial) build and load_forest after loading,
+ * so the early-terminating decisions start from the totals without an O(T) pass.
+ * @param forest The IsolationForest.
+ */
+void update_path_length_totals(IsolationForest* forest);
 
 #endif // IFOREST_H
\ No newline at end of file
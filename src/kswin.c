@@ -3,84 +3,138 @@
 #include <stdlib.h>
 #include <math.h>
 
-static int cmp_double(const void *a, const void *b) {
-    double da = *(const double*)a;
-    double db = *(const double*)b;
-    if (da < db) return -1;
-    if (da > db) return 1;
-    return 0;
-}
-
 KSWIN *kswin_create(int capacity, int r, double alpha) {
+    if (r < 1) r = 1;
     KSWIN *k = (KSWIN*)malloc(sizeof(KSWIN));
     if (!k) return NULL;
-    k->buffer = (double*)malloc(sizeof(double) * capacity);
-    if (!k->buffer) { free(k); return NULL; }
+    k->buffer = (double*)malloc(sizeof(double) * 2 * (size_t)r);
+    k->nodes  = (KswinNode*)malloc(sizeof(KswinNode) * (2 * (size_t)r + 1));
+    if (!k->buffer || !k->nodes) { free(k->buffer); free(k->nodes); free(k); return NULL; }
+    k->added = 0;
     k->capacity = capacity;
     k->size = 0;
     k->r = r;
     k->alpha = alpha;
+    // Two-sample KS critical value for samples of r and r: c(alpha) * sqrt((r + r) / (r * r))
+    k->threshold = sqrt(-0.5 * log(alpha / 2.0)) * sqrt(2.0 / (double)r);
+    k->root = -1;
+    for (int i = 0; i < 2 * r + 1; i++) {
+        k->nodes[i].right = (i + 1 < 2 * r + 1) ? i + 1 : -1;
+    }
+    k->free_list = 0;
+    k->seed = 2463534242u;
     return k;
 }
 
 void kswin_destroy(KSWIN *k) {
     if (!k) return;
     free(k->buffer);
+    free(k->nodes);
     free(k);
 }
 
-void kswin_add(KSWIN *k, double value) {
-    if (k->size < k->capacity) {
-        k->buffer[k->size++] = value;
-    } else {
-        // shift left (simple, O(n), fine for demo)
-        for (int i = 1; i < k->capacity; ++i) {
-            k->buffer[i - 1] = k->buffer[i];
-        }
-        k->buffer[k->capacity - 1] = value;
+// --- Treap over the distinct values of the last 2r ---
+
+static void update(KSWIN *k, int t) {
+    KswinNode *n = &k->nodes[t];
+    int left_sum = 0, left_max = 0, left_min = 0;
+    if (n->left >= 0) {
+        const KswinNode *l = &k->nodes[n->left];
+        left_sum = l->sum; left_max = l->max_prefix; left_min = l->min_prefix;
     }
+    int right_sum = 0, right_max = 0, right_min = 0;
+    if (n->right >= 0) {
+        const KswinNode *r = &k->nodes[n->right];
+        right_sum = r->sum; right_max = r->max_prefix; right_min = r->min_prefix;
+    }
+    // A prefix ends inside the left subtree, or after this node and inside the right one
+    int through = left_sum + n->old_count - n->recent_count;
+    n->sum = through + right_sum;
+    n->max_prefix = (left_max > through + right_max) ? left_max : through + right_max;
+    n->min_prefix = (left_min < through + right_min) ? left_min : through + right_min;
 }
 
-bool kswin_detect_change(KSWIN *k) {
-    if (k->size < k->r * 2) return false;
-
-    int n = k->size;
-    int r = k->r;
-
-    // Split: newest r values vs previous r values (simple version)
-    double *old_vals   = (double*)malloc(sizeof(double) * r);
-    double *recent_vals = (double*)malloc(sizeof(double) * r);
-    if (!old_vals || !recent_vals) { free(old_vals); free(recent_vals); return false; }
-
-    for (int i = 0; i < r; ++i) {
-        old_vals[i]    = k->buffer[n - 2*r + i];
-        recent_vals[i] = k->buffer[n - r + i];
+// Splits t into keys < key (or <= key when inclusive) and the rest.
+static void split(KSWIN *k, int t, double key, bool inclusive, int *lo, int *hi) {
+    if (t < 0) { *lo = *hi = -1; return; }
+    KswinNode *n = &k->nodes[t];
+    if (n->key < key || (inclusive && n->key == key)) {
+        split(k, n->right, key, inclusive, &n->right, hi);
+        *lo = t;
+    } else {
+        split(k, n->left, key, inclusive, lo, &n->left);
+        *hi = t;
     }
+    update(k, t);
+}
 
-    qsort(old_vals, r, sizeof(double), cmp_double);
-    qsort(recent_vals, r, sizeof(double), cmp_double);
-
-    // Compute KS statistic: max |F_old(x) - F_recent(x)|
-    int i = 0, j = 0;
-    double d_max = 0.0;
-    while (i < r && j < r) {
-        double x = (old_vals[i] < recent_vals[j]) ? old_vals[i] : recent_vals[j];
+static int merge(KSWIN *k, int a, int b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (k->nodes[a].priority > k->nodes[b].priority) {
+        k->nodes[a].right = merge(k, k->nodes[a].right, b);
+        update(k, a);
+        return a;
+    }
+    k->nodes[b].left = merge(k, a, k->nodes[b].left);
+    update(k, b);
+    return b;
+}
 
-        while (i < r && old_vals[i] <= x) i++;
-        while (j < r && recent_vals[j] <= x) j++;
+// Adds d_old old and d_recent recent copies of value (negative counts remove them).
+static void add_counts(KSWIN *k, double value, int d_old, int d_recent) {
+    int lo, mid, hi;
+    split(k, k->root, value, false, &lo, &mid);
+    split(k, mid, value, true, &mid, &hi);
+    if (mid < 0) {
+        // New distinct value: at most 2r are live, so the pool never runs out
+        mid = k->free_list;
+        k->free_list = k->nodes[mid].right;
+        KswinNode *n = &k->nodes[mid];
+        k->seed ^= k->seed << 13; k->seed ^= k->seed >> 17; k->seed ^= k->seed << 5;
+        n->key = value;
+        n->left = n->right = -1;
+        n->priority = k->seed;
+        n->old_count = n->recent_count = 0;
+    }
+    KswinNode *n = &k->nodes[mid];
+    n->old_count += d_old;
+    n->recent_count += d_recent;
+    if (n->old_count == 0 && n->recent_count == 0) {
+        n->right = k->free_list;
+        k->free_list = mid;
+        mid = -1;
+    } else {
+        update(k, mid);
+    }
+    k->root = merge(k, merge(k, lo, mid), hi);
+}
 
-        double f_old    = (double)i / r;
-        double f_recent = (double)j / r;
-        double d = fabs(f_old - f_recent);
-        if (d > d_max) d_max = d;
+void kswin_add(KSWIN *k, double value) {
+    if (isnan(value)) return; // NaN has no place in the order
+    int r = k->r;
+    long in_window = (k->added < 2L * r) ? k->added : 2L * r;
+    // The oldest of the last 2r leaves, and the oldest recent value becomes old
+    if (in_window == 2L * r) {
+        add_counts(k, k->buffer[k->added % (2 * r)], -1, 0);
     }
+    if (in_window >= r) {
+        add_counts(k, k->buffer[(k->added - r) % (2 * r)], 1, -1);
+    }
+    add_counts(k, value, 0, 1);
+    k->buffer[k->added % (2 * r)] = value;
+    k->added++;
+    if (k->size < k->capacity) k->size++;
+}
 
-    free(old_vals);
-    free(recent_vals);
+double kswin_statistic(const KSWIN *k) {
+    if (k->added < 2L * k->r || k->root < 0) return 0.0;
+    const KswinNode *root = &k->nodes[k->root];
+    int d = (root->max_prefix > -root->min_prefix) ? root->max_prefix : -root->min_prefix;
+    return (double)d / (double)k->r;
+}
 
-    // Critical value for two-sample KS: ~ c(alpha) * sqrt((2r)/(r^2))
-    // Here: d_max > c * sqrt(1.0 / r) ⇒ drift. Choose c from alpha.
-    double c = 1.36; // approx for alpha ~ 0.05 (demo)
-    double threshold = c * sqrt(1.0 / (double)r);
-    return d_max > threshold;
+bool kswin_detect_change(KSWIN *k) {
+    if (k->size < k->r * 2) return false;
+    return kswin_statistic(k) > k->threshold;
 }
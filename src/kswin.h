@@ -3,20 +3,50 @@
 #define KSWIN_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
+// KSWIN: two-sample Kolmogorov-Smirnov test between the newest r values ("recent")
+// and the r values before them ("old"). The last 2r values live in a ring buffer,
+// and their distinct values are kept in a treap ordered by value, each node counting
+// its old and recent copies. Every subtree knows the largest and smallest prefix sum
+// of (old - recent) counts, so the KS statistic max |F_old - F_recent| is read off
+// the root: an add is O(log r) and nothing is sorted or allocated per event.
 typedef struct {
-    double *buffer;
-    int size;       // current size
-    int capacity;   // total window length n
-    int r;          // size of "recent" segment
-    double alpha;   // significance level (e.g., 0.001)
+    double key;         // The distinct value
+    int left, right;    // Children in the node pool (-1 = none); right links the free list
+    uint32_t priority;  // Heap priority (random)
+    int old_count;      // Copies of key in the old segment
+    int recent_count;   // Copies of key in the recent segment
+    int sum;            // Subtree sum of (old_count - recent_count)
+    int max_prefix;     // Largest prefix sum within the subtree, empty prefix included
+    int min_prefix;     // Smallest prefix sum within the subtree, empty prefix included
+} KswinNode;
+
+typedef struct {
+    double *buffer;     // Ring of the last 2r values
+    long added;         // Values added so far
+    int size;           // current size (values added, at most capacity)
+    int capacity;       // total window length n
+    int r;              // size of "recent" segment
+    double alpha;       // significance level (e.g., 0.001)
+    double threshold;   // Critical value of the KS statistic for alpha and r
+    KswinNode *nodes;   // Pool of 2r + 1 treap nodes
+    int root;           // Treap root (-1 = empty)
+    int free_list;      // First unused node
+    uint32_t seed;      // Priority generator state (xorshift32)
 } KSWIN;
 
 KSWIN *kswin_create(int capacity, int r, double alpha);
 void   kswin_destroy(KSWIN *k);
+
+// Add one value. O(log r), no allocation.
 void   kswin_add(KSWIN *k, double value);
 
-// Returns true if KS-distance between old and recent segments is large.
+// Returns true if KS-distance between old and recent segments exceeds the
+// critical value c(alpha) * sqrt(2 / r). O(1).
 bool   kswin_detect_change(KSWIN *k);
 
+// Current KS statistic max |F_old(x) - F_recent(x)| (0 until 2r values were added).
+double kswin_statistic(const KSWIN *k);
+
 #endif
@@ -3,10 +3,50 @@
 #include "iforest.h"
 #include "stream_manager.h"
 #include "utils.h"
+#include "thread_pool.h"
+#include "score_kernels.h"
+#include "config.h"
+#include "model_io.h"
+#include "metrics.h"
+#include "hstree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <math.h>
 
-// External declarations for stream file handling (defined in stream_manager.c)
-extern bool open_stream(const char* filename);
-extern void close_stream();
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s <stream file (CSV/TSV or .ifs binary) or - for stdin> [options]\n"
+            "  --config FILE      Load 'key = value' settings (features, trees, window, sample, threshold, u)\n"
+            "  --features N       Dimensionality D (default: column count of the header)\n"
+            "  --trees N          Number of trees T (default %d)\n"
+            "  --window N         Sliding window size W (default %d)\n"
+            "  --sample N         Sample size per tree, at most W (default %d)\n"
+            "  --threshold X      Anomaly score threshold (default %.2f)\n"
+            "  --u X              Drift anomaly-rate threshold u (default %.2f)\n"
+            "  --rolling_trees K  Replace only the K oldest trees per model update (default 0 = full retrain)\n"
+            "  --rolling_interval N  Also update the model every N points (default 0 = on drift only)\n"
+            "  --threads N        Training threads, N >= 1 (default: online cores)\n"
+            "  --model NAME       Detector: iforest (IForestASD, default) or hst (streaming Half-Space Trees)\n"
+            "  --hst_depth N      Depth of each Half-Space Tree (default %d)\n"
+            "  --offline          Train once, then batch-score the rest of the stream\n"
+            "  --keyed            First column is an integer stream key (0 to 2^64-1); each key gets its own window, forest and detectors\n"
+            "                     (about 0.9 MiB per key at the defaults; --trees 25 --sample 64 --window 128: 0.12 MiB)\n"
+            "  --async            Retrain on a background thread and swap the new model in\n"
+            "  --pipeline         Read and score on separate threads joined by a lock-free ring (streaming modes only)\n"
+            "  --output FILE      Write scores and status lines to FILE instead of stdout\n"
+            "  --output-format F  Output encoding: text (default), csv or binary (binary needs --output)\n"
+            "  --verbosity V      Points written: all (default), anomalies or none\n"
+            "  --kernel NAME      Scoring kernel: auto, scalar, avx2, avx512\n"
+            "  --seed N           Seed every random choice, so runs repeat exactly (default: current time)\n"
+            "  --load-model FILE  Start from a saved model instead of training on the first window\n"
+            "  --save-model FILE  Save the final model when the stream ends\n"
+            "  --stats-interval S Print stage latency/throughput metrics to stderr every S seconds\n"
+            "  --stats-file FILE  Also write the metrics to FILE as JSON (needs make METRICS=1)\n",
+            program, DEFAULT_NUM_TREES, DEFAULT_WINDOW_SIZE, DEFAULT_SAMPLE_SIZE,
+            DEFAULT_ANOMALY_THRESHOLD, DEFAULT_DESIRED_ANOMALY_RATE_U, DEFAULT_HST_DEPTH);
+}
 
 /**
  * @brief The entry point of the IForestASD streaming anomaly detection project.
@@ -15,66 +55,297 @@ int main(int argc, char *argv[]) {
     
     // --- 1. Initialization and Setup ---
     
-    // Initialize the Random Number Generator (Crucial for IForest randomness)
-    initialize_rng();
-    
-    // Check command line arguments for data file
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <path_to_stream_data_file>\n", argv[0]);
+    // Check command line arguments for data file and options
+    IForestConfig config;
+    init_default_config(&config);
+
+    // A saved model supplies the configuration it was trained with; later options may
+    // still change the window and thresholds, but not the trees' dimensions
+    IsolationForest* loaded_forest = NULL;
+    IForestConfig model_config;
+    init_default_config(&model_config); // Settings not stored in the model keep their defaults
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--load-model") == 0) {
+            loaded_forest = load_forest(argv[i + 1], &model_config);
+            if (loaded_forest == NULL) {
+                return 1;
+            }
+            config = model_config;
+            break;
+        }
+    }
+
+    const char* data_filename = NULL;
+    const char* save_model_filename = NULL;
+    int num_threads = thread_pool_default_size();
+    bool offline = false;
+    bool keyed = false;
+    bool half_space_trees = false;
+    double stats_interval = 0.0;
+    const char* stats_filename = NULL;
+    const char* output_filename = NULL;
+    SinkFormat output_format = SINK_FORMAT_TEXT;
+    SinkVerbosity verbosity = SINK_VERBOSITY_ALL;
+    uint64_t seed = (uint64_t)time(NULL);
+    bool args_ok = true;
+    for (int i = 1; i < argc && args_ok; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            args_ok = load_config_file(&config, argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            char* end;
+            long threads = strtol(argv[++i], &end, 10);
+            args_ok = (*end == '\0' && threads >= 1 && threads <= INT_MAX);
+            num_threads = (int)threads;
+        } else if (strcmp(argv[i], "--load-model") == 0 && i + 1 < argc) {
+            i++; // Loaded before option parsing
+        } else if (strcmp(argv[i], "--save-model") == 0 && i + 1 < argc) {
+            save_model_filename = argv[++i];
+        } else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {
+            char* end;
+            stats_interval = strtod(argv[++i], &end);
+            args_ok = (*end == '\0' && end != argv[i] && isfinite(stats_interval) && stats_interval >= 0.0);
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            stats_filename = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_filename = argv[++i];
+        } else if (strcmp(argv[i], "--output-format") == 0 && i + 1 < argc) {
+            args_ok = parse_sink_format(argv[++i], &output_format);
+        } else if (strcmp(argv[i], "--verbosity") == 0 && i + 1 < argc) {
+            args_ok = parse_sink_verbosity(argv[++i], &verbosity);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            char* end;
+            seed = strtoull(argv[++i], &end, 10);
+            args_ok = (*end == '\0');
+        } else if (strcmp(argv[i], "--async") == 0) {
+            config.async_retrain = 1;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            config.pipeline = 1;
+        } else if (strcmp(argv[i], "--offline") == 0) {
+            offline = true;
+        } else if (strcmp(argv[i], "--keyed") == 0) {
+            keyed = true;
+        } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            half_space_trees = (strcmp(name, "hst") == 0);
+            args_ok = half_space_trees || strcmp(name, "iforest") == 0;
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            // Override runtime CPU detection for the batch scoring kernel
+            const char* name = argv[++i];
+            ScoreKernelType type = SCORE_KERNEL_AUTO;
+            if (strcmp(name, "scalar") == 0) type = SCORE_KERNEL_SCALAR;
+            else if (strcmp(name, "avx2") == 0) type = SCORE_KERNEL_AVX2;
+            else if (strcmp(name, "avx512") == 0) type = SCORE_KERNEL_AVX512;
+            else args_ok = (strcmp(name, "auto") == 0);
+            if (args_ok && !select_score_kernel(type)) {
+                fprintf(stderr, "Warning: scoring kernel '%s' not supported, using %s\n", name, score_kernel_name());
+            }
+        } else if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc) {
+            // Dimension and threshold overrides: --features, --trees, --window, ...
+            if (!set_config_value(&config, argv[i] + 2, argv[i + 1])) {
+                fprintf(stderr, "Error: invalid option '%s %s'\n", argv[i], argv[i + 1]);
+                args_ok = false;
+            }
+            i++;
+        } else if (data_filename == NULL && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0)) {
+            data_filename = argv[i];
+        } else {
+            args_ok = false;
+        }
+    }
+    if (!args_ok || data_filename == NULL) {
+        print_usage(argv[0]);
+        free_forest(loaded_forest);
         // Note: The data file must be formatted to match the reading logic in get_next_point_from_stream()
         return 1;
     }
-    const char* data_filename = argv[1];
+
+    if (keyed && (offline || config.async_retrain || config.pipeline || loaded_forest != NULL || save_model_filename != NULL)) {
+        fprintf(stderr, "Error: --keyed cannot be combined with --offline, --async, --pipeline, --load-model or --save-model.\n");
+        free_forest(loaded_forest);
+        return 1;
+    }
+
+    if (offline && config.pipeline) {
+        fprintf(stderr, "Error: --offline reads and scores the stream in batches; it cannot be combined with --pipeline.\n");
+        free_forest(loaded_forest);
+        return 1;
+    }
+
+    if (half_space_trees && (keyed || offline || config.async_retrain || config.rolling_trees > 0 ||
+                             config.rolling_interval > 0 || loaded_forest != NULL || save_model_filename != NULL)) {
+        fprintf(stderr, "Error: --model hst updates itself point by point; it cannot be combined with --keyed, --offline, "
+                        "--async, rolling updates, --load-model or --save-model.\n");
+        free_forest(loaded_forest);
+        return 1;
+    }
+
+    if (output_format == SINK_FORMAT_BINARY && output_filename == NULL) {
+        fprintf(stderr, "Error: --output-format binary needs --output FILE.\n");
+        free_forest(loaded_forest);
+        return 1;
+    }
+
+    if (loaded_forest != NULL &&
+        (config.num_features != model_config.num_features || config.num_trees != model_config.num_trees ||
+         config.sample_size != model_config.sample_size)) {
+        fprintf(stderr, "Error: the loaded model was trained with D=%d, T=%d, sample=%d; "
+                        "features, trees and sample cannot be overridden.\n",
+                model_config.num_features, model_config.num_trees, model_config.sample_size);
+        free_forest(loaded_forest);
+        return 1;
+    }
+
+    // Initialize the Random Number Generator (Crucial for IForest randomness): every
+    // tree, window sample and keyed stream draws its seed from it, so a fixed seed
+    // repeats the run exactly (except --async, whose model swaps depend on timing)
+    initialize_rng(seed);
 
     // Open the simulated data stream file
     if (!open_stream(data_filename)) {
+        free_forest(loaded_forest);
         return 1; // Error already printed inside open_stream
     }
+
+    // The feature count defaults to the number of header columns
+    // (keyed streams spend the first column on the key)
+    if (config.num_features == 0) {
+        int columns = stream_header_columns() - (keyed ? 1 : 0);
+        config.num_features = (columns > 0) ? columns : DEFAULT_NUM_FEATURES;
+    }
+    if (!validate_config(&config)) {
+        free_forest(loaded_forest);
+        close_stream();
+        return 1;
+    }
+    set_stream_num_features(config.num_features + (keyed ? 1 : 0));
     
     // --- 2. Data Structure Allocation ---
 
-    IsolationForest* forest = create_forest();
-    SlidingWindow* sw = create_sliding_window();
+    // Keyed streams allocate a window and forest per key instead (see stream_engine.h);
+    // Half-Space Trees replace the IsolationForest and only use the window to start
+    IsolationForest* forest = NULL;
+    HalfSpaceForest* hs_forest = NULL;
+    SlidingWindow* sw = NULL;
+    if (!keyed) {
+        if (half_space_trees) {
+            hs_forest = hst_create(&config);
+        } else {
+            forest = (loaded_forest != NULL) ? loaded_forest : create_forest(&config);
+        }
+        sw = create_sliding_window(&config);
+    }
+    ThreadPool* pool = thread_pool_create(num_threads);
 
-    if (forest == NULL || sw == NULL) {
+    if ((!keyed && ((forest == NULL && hs_forest == NULL) || sw == NULL)) || pool == NULL) {
         fprintf(stderr, "Fatal error: Failed to allocate core data structures.\n");
         // Clean up any successfully allocated structures before exiting
         if (forest) free_forest(forest);
+        hst_destroy(hs_forest);
         if (sw) destroy_sliding_window(sw);
+        thread_pool_destroy(pool);
         close_stream();
         return 1;
     }
+    if (forest != NULL) {
+        forest->pool = pool; // Trees are trained in parallel on the worker pool
+    }
 
     // --- 3. Configuration Display ---
     printf("==================================================\n");
     printf("   Isolation Forest Anomaly Detection (IForestASD)\n");
     printf("==================================================\n");
     printf("Configuration:\n");
-    printf("  Features (D): %d\n", NUM_FEATURES);
-    printf("  Trees (T): %d\n", NUM_TREES);
-    printf("  Window Size (W): %d\n", WINDOW_SIZE);
-    printf("  Sample Size (ψ): %d\n", SAMPLE_SIZE);
-    printf("  Anomaly Score Threshold: %.2f\n", ANOMALY_THRESHOLD);
-    printf("  Drift Threshold (u): %.2f\n", DESIRED_ANOMALY_RATE_U);
+    printf("  Features (D): %d\n", config.num_features);
+    printf("  Trees (T): %d\n", config.num_trees);
+    printf("  Window Size (W): %d\n", config.window_size);
+    printf("  Sample Size (ψ): %d\n", config.sample_size);
+    printf("  Anomaly Score Threshold: %.2f\n", config.anomaly_threshold);
+    printf("  Drift Threshold (u): %.2f\n", config.desired_anomaly_rate_u);
+    if (config.rolling_trees > 0) {
+        printf("  Rolling Updates: %d oldest trees per update", config.rolling_trees);
+        if (config.rolling_interval > 0) printf(", every %d points", config.rolling_interval);
+        printf("\n");
+    } else if (config.rolling_interval > 0) {
+        printf("  Scheduled Retrain: every %d points\n", config.rolling_interval);
+    }
+    if (config.async_retrain) {
+        printf("  Retraining: background (double-buffered swap)\n");
+    }
+    if (config.pipeline) {
+        printf("  Pipeline: reader -> scorer -> output threads\n");
+    }
+    if (half_space_trees) {
+        printf("  Detector: Half-Space Trees (depth %d, reference masses of the last %d points)\n",
+               config.hst_depth, config.window_size);
+    } else if (keyed) {
+        printf("  Streams: keyed by the first column, scored on %d threads\n", thread_pool_size(pool));
+    } else {
+        printf("  Training Threads: %d\n", thread_pool_size(pool));
+    }
+    printf("  Scoring Kernel: %s\n", score_kernel_name());
+    printf("  Seed: %llu\n", (unsigned long long)seed);
+    if (loaded_forest != NULL) {
+        printf("  Model: loaded (%d trees of depth %d)\n", forest->num_trees, forest->max_depth);
+    }
     printf("  Processing Stream: %s\n", data_filename);
+    if (output_filename != NULL) {
+        printf("  Output: %s\n", output_filename);
+    }
     printf("--------------------------------------------------\n");
 
+    // Scores are written by the sink's own thread (opened after the banner, which it flushes)
+    if (!open_output(output_filename, output_format, verbosity, keyed)) {
+        free_forest(forest);
+        hst_destroy(hs_forest);
+        destroy_sliding_window(sw);
+        thread_pool_destroy(pool);
+        close_stream();
+        return 1;
+    }
+
     // --- 4. Main Processing Loop ---
     
-    // Start the continuous stream processing loop
-    // Set a high iteration limit (INT_MAX is good for C, but we use a large number 
-    // here to allow the stream logic to handle EOF naturally).
-    const int MAX_POINTS_TO_PROCESS = 100000; 
+#ifdef IFOREST_METRICS
+    metrics_init(stats_interval, stats_filename);
+#else
+    if (stats_interval > 0.0 || stats_filename != NULL) {
+        fprintf(stderr, "Warning: metrics are not compiled in (rebuild with make METRICS=1)\n");
+    }
+#endif
 
-    process_stream(forest, sw, DESIRED_ANOMALY_RATE_U, MAX_POINTS_TO_PROCESS);
+    // Every mode reads the stream to its end (a record limit of 0)
+    if (keyed) {
+        // Independent window, forest and detectors per key, streams run on the pool
+        process_keyed_stream(&config, pool, 0);
+    } else if (half_space_trees) {
+        // Incrementally updated model: no drift detection or retraining
+        process_hst_stream(hs_forest, sw, &config, 0);
+    } else if (offline) {
+        // Static model: train on the first window, then batch-score the rest
+        score_stream_offline(forest, sw, 0);
+    } else {
+        process_stream(forest, sw, &config, 0);
+    }
+#ifdef IFOREST_METRICS
+    metrics_report_final();
+#endif
+
+    if (save_model_filename != NULL) {
+        if (save_forest(forest, &config, save_model_filename)) {
+            printf("Model saved to %s\n", save_model_filename);
+        }
+    }
 
     // --- 5. Cleanup ---
 
     printf("\nStream processing finished. Performing cleanup...\n");
     
     // Free all dynamically allocated memory
+    close_output();
     free_forest(forest);
+    hst_destroy(hs_forest);
     destroy_sliding_window(sw);
+    thread_pool_destroy(pool);
     
     // close_stream() is called inside process_stream() upon EOF, but can be called here 
     // again to ensure closure if the loop terminates early.
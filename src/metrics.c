@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime, getrusage
+
+#include "metrics.h"
+
+#ifdef IFOREST_METRICS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// --- Log-Bucketed Histogram ---
+// HDR-style layout: values below 2^SUB_BUCKET_BITS get one bucket each; above that,
+// every power-of-two range is split into 2^SUB_BUCKET_BITS linear sub-buckets, so any
+// recorded value is known to within 1/2^SUB_BUCKET_BITS (~3%) of itself.
+
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS ((64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+
+typedef struct {
+    atomic_uint_fast64_t buckets[HISTOGRAM_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+} Histogram;
+
+static const char* const stage_names[STAGE_COUNT] = {
+    "parse", "slide", "score", "adwin", "kswin", "rate", "train", "rescore", "event"
+};
+
+static const char* const counter_names[COUNTER_COUNT] = {
+    "points", "parse_failures", "retrains", "rolling_updates",
+    "drift_adwin", "drift_kswin", "drift_u_rule"
+};
+
+static Histogram histograms[STAGE_COUNT];
+static atomic_uint_fast64_t counters[COUNTER_COUNT];
+
+// Reporting state (touched only by the thread that calls metrics_tick)
+static double report_interval_ns = 0.0;
+static const char* report_json_path = NULL;
+static uint64_t start_ns = 0;
+static uint64_t last_report_ns = 0;
+static uint64_t last_report_points = 0;
+
+static int bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value); // >= SUB_BUCKET_BITS
+    int shift = exponent - SUB_BUCKET_BITS;
+    int sub = (int)((value >> shift) & (SUB_BUCKETS - 1));
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+/**
+ * Upper bound of the values that land in a bucket (the reported quantile value).
+ */
+static uint64_t bucket_upper_bound(int index) {
+    if (index < SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(index % SUB_BUCKETS) | SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+static uint64_t histogram_quantile(const Histogram* h, double q) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t bound = bucket_upper_bound(i);
+            uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+            return (bound < max) ? bound : max;
+        }
+    }
+    return atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+}
+
+// --- Recording ---
+
+uint64_t metrics_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_record(MetricsStage stage, uint64_t nanoseconds) {
+    Histogram* h = &histograms[stage];
+    atomic_fetch_add_explicit(&h->buckets[bucket_index(nanoseconds)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total_ns, nanoseconds, memory_order_relaxed);
+    uint_fast64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    while (nanoseconds > max &&
+           !atomic_compare_exchange_weak_explicit(&h->max_ns, &max, nanoseconds,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void metrics_add(MetricsCounter counter, uint64_t amount) {
+    atomic_fetch_add_explicit(&counters[counter], amount, memory_order_relaxed);
+}
+
+// --- Memory ---
+
+/**
+ * Resident set size in bytes (from /proc), or 0 where unavailable.
+ */
+static uint64_t resident_bytes() {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned long pages = 0, resident = 0;
+    int fields = fscanf(file, "%lu %lu", &pages, &resident);
+    fclose(file);
+    return (fields == 2) ? (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+static uint64_t peak_resident_bytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (uint64_t)usage.ru_maxrss * 1024; // Kilobytes on Linux
+}
+
+// --- Reporting ---
+
+static void print_summary(FILE* out, uint64_t now, bool final) {
+    double elapsed = (double)(now - start_ns) * 1e-9;
+    uint64_t points = atomic_load(&counters[COUNTER_POINTS]);
+    double interval = (double)(now - last_report_ns) * 1e-9;
+    double recent_rate = (interval > 0.0) ? (double)(points - last_report_points) / interval : 0.0;
+
+    fprintf(out, "--- Metrics %s(%.1f s): %llu points, %.0f points/s overall, %.0f points/s recent, RSS %.1f MB (peak %.1f MB) ---\n",
+            final ? "final " : "", elapsed, (unsigned long long)points,
+            (elapsed > 0.0) ? (double)points / elapsed : 0.0, recent_rate,
+            (double)resident_bytes() / (1024.0 * 1024.0), (double)peak_resident_bytes() / (1024.0 * 1024.0));
+    fprintf(out, "  %-8s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "mean us", "p50 us", "p99 us", "p99.9 us", "max us");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const Histogram* h = &histograms[s];
+        uint64_t count = atomic_load(&h->count);
+        if (count == 0) {
+            continue;
+        }
+        fprintf(out, "  %-8s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", stage_names[s],
+                (unsigned long long)count, (double)atomic_load(&h->total_ns) / (double)count * 1e-3,
+                (double)histogram_quantile(h, 0.50) * 1e-3, (double)histogram_quantile(h, 0.99) * 1e-3,
+                (double)histogram_quantile(h, 0.999) * 1e-3, (double)atomic_load(&h->max_ns) * 1e-3);
+    }
+    fprintf(out, " ");
+    for (int c = 1; c < COUNTER_COUNT; c++) {
+        fprintf(out, " %s=%llu", counter_names[c], (unsigned long long)atomic_load(&counters[c]));
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * Writes the current statistics as one JSON object, replacing the file atomically.
+ */
+static void write_json(const char* path, uint64_t now) {
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* out = fopen(temp_path, "w");
+    if (out == NULL) {
+        perror("Error opening metrics file");
+        return;
+    }
+    double elapsed = (double)(now - start_ns) * 1e-9;
+    uint64_t points = atomic_load(&counters[COUNTER_POINTS]);
+    fprintf(out, "{\n  \"elapsed_seconds\": %.6f,\n  \"points_per_second\": %.1f,\n",
+            elapsed, (elapsed > 0.0) ? (double)points / elapsed : 0.0);
+    fprintf(out, "  \"memory\": { \"resident_bytes\": %llu, \"peak_resident_bytes\": %llu },\n",
+            (unsigned long long)resident_bytes(), (unsigned long long)peak_resident_bytes());
+    fprintf(out, "  \"counters\": {");
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        fprintf(out, "%s \"%s\": %llu", (c > 0) ? "," : "", counter_names[c],
+                (unsigned long long)atomic_load(&counters[c]));
+    }
+    fprintf(out, " },\n  \"stages_ns\": {\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const Histogram* h = &histograms[s];
+        uint64_t count = atomic_load(&h->count);
+        fprintf(out, "    \"%s\": { \"count\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu }%s\n",
+                stage_names[s], (unsigned long long)count,
+                (count > 0) ? (double)atomic_load(&h->total_ns) / (double)count : 0.0,
+                (unsigned long long)histogram_quantile(h, 0.50), (unsigned long long)histogram_quantile(h, 0.99),
+                (unsigned long long)histogram_quantile(h, 0.999), (unsigned long long)atomic_load(&h->max_ns),
+                (s + 1 < STAGE_COUNT) ? "," : "");
+    }
+    fprintf(out, "  }\n}\n");
+    if (fclose(out) != 0 || rename(temp_path, path) != 0) {
+        perror("Error writing metrics file");
+        remove(temp_path);
+    }
+}
+
+static void report(bool final) {
+    uint64_t now = metrics_now_ns();
+    print_summary(stderr, now, final);
+    if (report_json_path != NULL) {
+        write_json(report_json_path, now);
+    }
+    last_report_ns = now;
+    last_report_points = atomic_load(&counters[COUNTER_POINTS]);
+}
+
+void metrics_init(double interval_seconds, const char* json_path) {
+    memset(histograms, 0, sizeof(histograms));
+    memset(counters, 0, sizeof(counters));
+    report_interval_ns = interval_seconds * 1e9;
+    report_json_path = json_path;
+    start_ns = metrics_now_ns();
+    last_report_ns = start_ns;
+    last_report_points = 0;
+}
+
+void metrics_tick() {
+    if (report_interval_ns <= 0.0) {
+        return;
+    }
+    if ((double)(metrics_now_ns() - last_report_ns) >= report_interval_ns) {
+        report(false);
+    }
+}
+
+void metrics_report_final() {
+    report(true);
+}
+
+#endif // IFOREST_METRICS
@@ -0,0 +1,94 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// --- Pipeline Instrumentation ---
+// Per-stage latency histograms and event counters for the stream pipeline.
+// Everything here is compiled in only when IFOREST_METRICS is defined
+// (make METRICS=1); otherwise the macros below expand to nothing.
+
+/**
+ * @brief Timed pipeline stages.
+ */
+typedef enum {
+    STAGE_PARSE = 0,    // Reading and parsing one point
+    STAGE_SLIDE,        // slide_window
+    STAGE_SCORE,        // Scoring one point (or one offline batch)
+    STAGE_ADWIN,        // ADWIN update and change test
+    STAGE_KSWIN,        // KSWIN update and change test
+    STAGE_RATE,         // evaluate_window_anomaly_rate
+    STAGE_TRAIN,        // Model update: full retrain, rolling update or background build
+    STAGE_RESCORE,      // Rebuilding the window score cache after a model change
+    STAGE_EVENT,        // One whole point, from parse to model update
+    STAGE_COUNT
+} MetricsStage;
+
+/**
+ * @brief Event counters.
+ */
+typedef enum {
+    COUNTER_POINTS = 0,     // Points scored
+    COUNTER_PARSE_FAILURES, // Lines rejected by the parser
+    COUNTER_RETRAINS,       // Full retrains (inline or background builds)
+    COUNTER_ROLLING_UPDATES,// Rolling partial updates
+    COUNTER_DRIFT_ADWIN,    // Drift triggers by detector
+    COUNTER_DRIFT_KSWIN,
+    COUNTER_DRIFT_U_RULE,
+    COUNTER_COUNT
+} MetricsCounter;
+
+#ifdef IFOREST_METRICS
+
+#include <stdint.h>
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+uint64_t metrics_now_ns();
+
+/**
+ * @brief Adds one duration to a stage's histogram (thread-safe).
+ */
+void metrics_record(MetricsStage stage, uint64_t nanoseconds);
+
+/**
+ * @brief Increments a counter (thread-safe).
+ */
+void metrics_add(MetricsCounter counter, uint64_t amount);
+
+/**
+ * @brief Configures periodic reporting and resets all statistics.
+ * @param interval_seconds Seconds between summaries (0 = only the final summary).
+ * @param json_path If not NULL, each summary is also written to this file as JSON
+ * (overwritten every time).
+ */
+void metrics_init(double interval_seconds, const char* json_path);
+
+/**
+ * @brief Emits a summary if the reporting interval has elapsed; call once per point.
+ */
+void metrics_tick();
+
+/**
+ * @brief Emits the final summary (stderr and, if configured, the JSON file).
+ */
+void metrics_report_final();
+
+#define METRICS_TIMER(t) uint64_t t = metrics_now_ns()
+#define METRICS_RESTART(t) ((t) = metrics_now_ns())
+#define METRICS_STOP(stage, t) metrics_record((stage), metrics_now_ns() - (t))
+#define METRICS_COUNT(counter) metrics_add((counter), 1)
+#define METRICS_ADD(counter, amount) metrics_add((counter), (uint64_t)(amount))
+#define METRICS_TICK() metrics_tick()
+
+#else
+
+#define METRICS_TIMER(t)
+#define METRICS_RESTART(t) ((void)0)
+#define METRICS_STOP(stage, t) ((void)0)
+#define METRICS_COUNT(counter) ((void)0)
+#define METRICS_ADD(counter, amount) ((void)0)
+#define METRICS_TICK() ((void)0)
+
+#endif // IFOREST_METRICS
+
+#endif // METRICS_H
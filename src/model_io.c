@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200809L // For fstat, mmap
+
+#include "model_io.h"
+#include "iforest.h" // For average_path_length_constant, compute_path_length_bounds, update_path_length_totals
+#include "config.h"  // For MAX_SAMPLE_SIZE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MODEL_BYTE_ORDER 0x01020304u
+#define CHECKSUM_SEED 0xcbf29ce484222325ULL   // FNV-1a offset basis
+#define CHECKSUM_PRIME 0x100000001b3ULL       // FNV-1a prime
+
+// --- Checksum ---
+
+/**
+ * @brief Extends a 64-bit FNV-1a style checksum over size bytes, one 8-byte word at a time.
+ * * Word-wise mixing keeps verification of a large model well under a millisecond per MB.
+ */
+static uint64_t update_checksum(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t words = size / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+        hash = (hash ^ word) * CHECKSUM_PRIME;
+    }
+    for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+        hash = (hash ^ bytes[i]) * CHECKSUM_PRIME;
+    }
+    return hash;
+}
+
+// --- Save ---
+
+bool save_forest(const IsolationForest* forest, const IForestConfig* config, const char* path) {
+    if (!forest_is_trained(forest)) {
+        fprintf(stderr, "Error: Cannot save model to '%s': the forest has not been trained.\n", path);
+        return false;
+    }
+
+    // 1. Header, per-tree node counts and padding up to the aligned node arena
+    size_t table_size = sizeof(uint32_t) * (size_t)forest->num_trees;
+    size_t nodes_offset = (sizeof(ModelFileHeader) + table_size + MODEL_NODE_ALIGNMENT - 1) &
+                          ~(size_t)(MODEL_NODE_ALIGNMENT - 1);
+    size_t arena_size = sizeof(Node) * (size_t)forest->nodes_per_tree * (size_t)forest->num_trees;
+    unsigned char* prefix = (unsigned char*)calloc(1, nodes_offset);
+    if (prefix == NULL) {
+        perror("Error: Memory allocation failed for model header");
+        return false;
+    }
+
+    ModelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODEL_FILE_MAGIC, sizeof(MODEL_FILE_MAGIC));
+    header.version = MODEL_FILE_VERSION;
+    header.header_size = sizeof(ModelFileHeader);
+    header.node_size = sizeof(Node);
+    header.byte_order = MODEL_BYTE_ORDER;
+    header.num_features = forest->num_features;
+    header.num_trees = forest->num_trees;
+    header.window_size = config->window_size;
+    header.sample_size = forest->sample_size;
+    header.anomaly_threshold = config->anomaly_threshold;
+    header.desired_anomaly_rate_u = config->desired_anomaly_rate_u;
+    header.path_length_constant = average_path_length_constant(forest->sample_size);
+    header.max_depth = forest->max_depth;
+    header.nodes_per_tree = forest->nodes_per_tree;
+    header.nodes_offset = nodes_offset;
+    header.file_size = nodes_offset + arena_size;
+
+    uint32_t* node_counts = (uint32_t*)(prefix + sizeof(ModelFileHeader));
+    for (int i = 0; i < forest->num_trees; i++) {
+        node_counts[i] = (uint32_t)forest->trees[i].node_count;
+    }
+
+    // 2. Checksum everything with the checksum field zeroed, then store it
+    memcpy(prefix, &header, sizeof(header));
+    uint64_t checksum = update_checksum(CHECKSUM_SEED, prefix, nodes_offset);
+    header.checksum = update_checksum(checksum, forest->node_arena, arena_size);
+    memcpy(prefix, &header, sizeof(header));
+
+    // 3. Write prefix and arena
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Error opening model file for writing");
+        free(prefix);
+        return false;
+    }
+    bool ok = fwrite(prefix, nodes_offset, 1, file) == 1 &&
+              fwrite(forest->node_arena, arena_size, 1, file) == 1;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    free(prefix);
+    if (!ok) {
+        perror("Error writing model file");
+        remove(path);
+    }
+    return ok;
+}
+
+// --- Load ---
+
+/**
+ * @brief Checks a mapped model's header, tree table and nodes against the file.
+ * @return true if the model is usable; otherwise the problem is reported.
+ */
+static bool validate_model(const unsigned char* data, size_t size, const char* path) {
+    ModelFileHeader header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Error: Model file '%s' is truncated.\n", path);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, MODEL_FILE_MAGIC, sizeof(MODEL_FILE_MAGIC)) != 0) {
+        fprintf(stderr, "Error: '%s' is not a model file.\n", path);
+        return false;
+    }
+    if (header.version == MODEL_FILE_VERSION && header.node_size != sizeof(Node)) {
+        // Float32 builds (make FLOAT32=1) store 8-byte nodes, double builds 16-byte nodes
+        fprintf(stderr, "Error: Model file '%s' was saved by a %s build; this build stores %s.\n", path,
+                (header.node_size < sizeof(Node)) ? "float32" : "double", (sizeof(feature_t) == sizeof(float)) ? "float32" : "double");
+        return false;
+    }
+    if (header.version != MODEL_FILE_VERSION || header.header_size != sizeof(ModelFileHeader) ||
+        header.node_size != sizeof(Node) || header.byte_order != MODEL_BYTE_ORDER) {
+        fprintf(stderr, "Error: Model file '%s' has an incompatible format (version %u).\n", path, header.version);
+        return false;
+    }
+    if (header.file_size != size) {
+        fprintf(stderr, "Error: Model file '%s' is truncated (%zu of %llu bytes).\n",
+                path, size, (unsigned long long)header.file_size);
+        return false;
+    }
+
+    // Structural sanity before trusting any offsets
+    if (header.num_features < 1 || header.num_trees < 1 ||
+        header.sample_size < 2 || header.sample_size > MAX_SAMPLE_SIZE ||
+        header.max_depth != compute_max_depth(header.sample_size) ||
+        header.nodes_per_tree != max_tree_nodes(header.max_depth) ||
+        header.nodes_offset % MODEL_NODE_ALIGNMENT != 0 || header.nodes_offset > size ||
+        header.nodes_offset < sizeof(header) + sizeof(uint32_t) * (uint64_t)header.num_trees ||
+        (size - header.nodes_offset) / sizeof(Node) != (uint64_t)header.nodes_per_tree * (uint64_t)header.num_trees ||
+        (size - header.nodes_offset) % sizeof(Node) != 0) {
+        fprintf(stderr, "Error: Model file '%s' has an inconsistent header.\n", path);
+        return false;
+    }
+    if (header.path_length_constant != average_path_length_constant(header.sample_size)) {
+        fprintf(stderr, "Error: Model file '%s' was saved with a different c(psi) definition.\n", path);
+        return false;
+    }
+
+    // Checksum over the file with the checksum field taken as 0
+    uint64_t expected = header.checksum;
+    header.checksum = 0;
+    uint64_t checksum = update_checksum(CHECKSUM_SEED, &header, sizeof(header));
+    checksum = update_checksum(checksum, data + sizeof(header), size - sizeof(header));
+    if (checksum != expected) {
+        fprintf(stderr, "Error: Model file '%s' is corrupt (checksum mismatch).\n", path);
+        return false;
+    }
+
+    // Every tree is either empty or complete, and every split refers to a real feature
+    // (the SIMD kernels read the feature index and the reserved word as one 64-bit index)
+    const uint32_t* node_counts = (const uint32_t*)(data + sizeof(header));
+    for (int i = 0; i < header.num_trees; i++) {
+        if (node_counts[i] != 0 && node_counts[i] != (uint32_t)header.nodes_per_tree) {
+            fprintf(stderr, "Error: Model file '%s' has an invalid node count for tree %d.\n", path, i);
+            return false;
+        }
+    }
+    const Node* nodes = (const Node*)(data + header.nodes_offset);
+    size_t node_total = (size_t)header.nodes_per_tree * (size_t)header.num_trees;
+    for (size_t i = 0; i < node_total; i++) {
+        if (nodes[i].split_feature_index < 0 || nodes[i].split_feature_index >= header.num_features) {
+            fprintf(stderr, "Error: Model file '%s' has an invalid split feature.\n", path);
+            return false;
+        }
+#ifndef IFOREST_FLOAT32
+        if (nodes[i].reserved != 0) {
+            fprintf(stderr, "Error: Model file '%s' has a nonzero reserved node word.\n", path);
+            return false;
+        }
+#endif
+    }
+    return true;
+}
+
+IsolationForest* load_forest(const char* path, IForestConfig* config) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening model file");
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        fprintf(stderr, "Error: Model file '%s' is empty or unreadable.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    // 1. Private writable mapping: scoring reads it in place, a retrain copies only touched pages
+    size_t size = (size_t)info.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping model file");
+        return NULL;
+    }
+    if (!validate_model((const unsigned char*)mapping, size, path)) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    // 2. Forest and tree descriptors reference the mapped arena; no node is copied
+    ModelFileHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    IsolationForest* forest = (IsolationForest*)calloc(1, sizeof(IsolationForest));
+    ITree* trees = (ITree*)malloc(sizeof(ITree) * (size_t)header.num_trees);
+    long* tree_ages = (long*)malloc(sizeof(long) * 2 * (size_t)header.num_trees);
+    int* update_trees = (int*)malloc(sizeof(int) * (size_t)header.num_trees);
+    if (forest == NULL || trees == NULL || tree_ages == NULL || update_trees == NULL) {
+        perror("Error: Memory allocation failed for loaded IsolationForest");
+        free(forest);
+        free(trees);
+        free(tree_ages);
+        free(update_trees);
+        munmap(mapping, size);
+        return NULL;
+    }
+    forest->trees = trees;
+    forest->tree_ages = tree_ages;
+    forest->update_trees = update_trees;
+    forest->num_trees = header.num_trees;
+    forest->num_features = header.num_features;
+    forest->sample_size = header.sample_size;
+    forest->max_depth = header.max_depth;
+    forest->nodes_per_tree = header.nodes_per_tree;
+    forest->node_arena = (Node*)((unsigned char*)mapping + header.nodes_offset);
+    forest->mapping = mapping;
+    forest->mapping_size = size;
+    forest->pool = NULL;
+
+    const uint32_t* node_counts = (const uint32_t*)((const unsigned char*)mapping + sizeof(header));
+    for (int i = 0; i < forest->num_trees; i++) {
+        forest->trees[i].nodes = forest->node_arena + (size_t)i * forest->nodes_per_tree;
+        forest->trees[i].node_count = (int)node_counts[i];
+        forest->trees[i].depth = forest->max_depth;
+        forest->trees[i].built_at = 0; // Loaded trees are the oldest once training resumes
+        compute_path_length_bounds(&forest->trees[i]);
+    }
+    update_path_length_totals(forest);
+
+    config->num_features = header.num_features;
+    config->num_trees = header.num_trees;
+    config->window_size = header.window_size;
+    config->sample_size = header.sample_size;
+    config->anomaly_threshold = header.anomaly_threshold;
+    config->desired_anomaly_rate_u = header.desired_anomaly_rate_u;
+    return forest;
+}
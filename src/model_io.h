@@ -0,0 +1,62 @@
+#ifndef MODEL_IO_H
+#define MODEL_IO_H
+
+#include "core_ds.h" // For IsolationForest, IForestConfig, Node
+#include <stdbool.h>
+#include <stdint.h>
+
+// --- Binary Model Format ---
+
+#define MODEL_FILE_MAGIC "IFMODEL"   // First 8 bytes (including the terminating NUL)
+#define MODEL_FILE_VERSION 1
+#define MODEL_NODE_ALIGNMENT 64      // File offset alignment of the node arena
+
+/**
+ * @brief Fixed header at the start of a model file (native byte order).
+ * * It is followed by one uint32_t node count per tree and, from nodes_offset on,
+ * the forest's node arena exactly as it is laid out in memory (num_trees slices of
+ * nodes_per_tree Nodes), so a loaded forest scores straight from the mapped file.
+ */
+typedef struct {
+    char magic[8];                  // MODEL_FILE_MAGIC
+    uint32_t version;               // MODEL_FILE_VERSION
+    uint32_t header_size;           // sizeof(ModelFileHeader)
+    uint32_t node_size;             // sizeof(Node), guards against layout changes
+    uint32_t byte_order;            // 0x01020304 as written by the saving machine
+    // Detector configuration the model was trained with
+    int32_t num_features;           // D
+    int32_t num_trees;              // T
+    int32_t window_size;            // W
+    int32_t sample_size;            // ψ
+    double anomaly_threshold;
+    double desired_anomaly_rate_u;
+    double path_length_constant;    // c(ψ), the score normalization constant
+    // Tree storage
+    int32_t max_depth;              // Depth of every tree
+    int32_t nodes_per_tree;         // Node slice length of each tree in the arena
+    uint64_t nodes_offset;          // File offset of the node arena (MODEL_NODE_ALIGNMENT aligned)
+    uint64_t file_size;             // Total length of the file
+    uint64_t checksum;              // Checksum of the whole file, computed with this field set to 0
+} ModelFileHeader;
+
+/**
+ * @brief Writes a trained forest and the configuration it was trained with to a model file.
+ * * @param forest The trained IsolationForest.
+ * @param config The detector configuration (window size and thresholds are stored with the trees).
+ * @param path Destination file.
+ * @return true on success, false on failure (already reported on stderr).
+ */
+bool save_forest(const IsolationForest* forest, const IForestConfig* config, const char* path);
+
+/**
+ * @brief Maps a model file and returns a forest that scores directly from the mapping.
+ * * The version, node layout and checksum are verified. Nodes are not copied or
+ * allocated individually: the forest's node arena points into a private mapping,
+ * which is copy-on-write if the forest is later retrained. free_forest unmaps it.
+ * @param path The model file.
+ * @param config Receives the configuration stored with the model.
+ * @return The loaded forest, or NULL on failure (already reported on stderr).
+ */
+IsolationForest* load_forest(const char* path, IForestConfig* config);
+
+#endif // MODEL_IO_H
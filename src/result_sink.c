@@ -0,0 +1,377 @@
+#define _POSIX_C_SOURCE 200809L // For fileno
+
+#include "result_sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define SINK_MAX_RECORD 512 // Longest single record or status line (longer lines are truncated)
+
+struct ResultSink {
+    int fd;
+    bool owns_fd;
+    SinkFormat format;
+    SinkVerbosity verbosity;
+    bool keyed;
+
+    char* buffers[SINK_BUFFERS];
+    size_t buffer_size;
+
+    // Producer side: the buffer being filled
+    int current;
+    size_t used;
+
+    // Handoff (under lock): filled buffers in FIFO order, and the free ones
+    pthread_mutex_t lock;
+    pthread_cond_t filled;      // Writer: a buffer was queued, or stop
+    pthread_cond_t drained;     // Producer: a buffer was written (free again)
+    int queue[SINK_BUFFERS];
+    size_t queue_bytes[SINK_BUFFERS];
+    int queue_head;
+    int queue_count;
+    int free_buffers[SINK_BUFFERS];
+    int free_count;
+    bool writing;               // The writer holds a buffer
+    bool stop;
+    pthread_t thread;
+
+    ResultSinkStats stats;
+};
+
+// --- Writer Thread ---
+
+static bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static void* writer_thread(void* arg) {
+    ResultSink* sink = (ResultSink*)arg;
+    pthread_mutex_lock(&sink->lock);
+    for (;;) {
+        while (sink->queue_count == 0 && !sink->stop) {
+            pthread_cond_wait(&sink->filled, &sink->lock);
+        }
+        if (sink->queue_count == 0) {
+            break; // Stopped and drained
+        }
+        int buffer = sink->queue[sink->queue_head];
+        size_t bytes = sink->queue_bytes[sink->queue_head];
+        sink->queue_head = (sink->queue_head + 1) % SINK_BUFFERS;
+        sink->queue_count--;
+        sink->writing = true;
+        bool failed = sink->stats.write_error;
+        pthread_mutex_unlock(&sink->lock);
+
+        // The only place the sink touches the file descriptor
+        bool ok = failed || write_all(sink->fd, sink->buffers[buffer], bytes);
+
+        pthread_mutex_lock(&sink->lock);
+        if (!ok) {
+            perror("Error: writing results failed");
+            sink->stats.write_error = true;
+        }
+        sink->free_buffers[sink->free_count++] = buffer;
+        sink->writing = false;
+        pthread_cond_broadcast(&sink->drained);
+    }
+    pthread_mutex_unlock(&sink->lock);
+    return NULL;
+}
+
+// --- Producer Side ---
+
+/**
+ * Queues the current buffer for writing and switches to a free one (waiting if none is free).
+ */
+static void submit_buffer(ResultSink* sink) {
+    pthread_mutex_lock(&sink->lock);
+    int slot = (sink->queue_head + sink->queue_count) % SINK_BUFFERS;
+    sink->queue[slot] = sink->current;
+    sink->queue_bytes[slot] = sink->used;
+    sink->queue_count++;
+    sink->stats.bytes += (long)sink->used;
+    pthread_cond_signal(&sink->filled);
+    if (sink->free_count == 0) {
+        sink->stats.stalls++;
+        while (sink->free_count == 0) {
+            pthread_cond_wait(&sink->drained, &sink->lock);
+        }
+    }
+    sink->current = sink->free_buffers[--sink->free_count];
+    pthread_mutex_unlock(&sink->lock);
+    sink->used = 0;
+}
+
+/**
+ * Returns room for n bytes in the current buffer.
+ */
+static char* reserve(ResultSink* sink, size_t n) {
+    if (sink->used + n > sink->buffer_size) {
+        submit_buffer(sink);
+    }
+    return sink->buffers[sink->current] + sink->used;
+}
+
+static char* append_uint(char* out, uint64_t value) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (n > 0) {
+        *out++ = digits[--n];
+    }
+    return out;
+}
+
+/**
+ * Appends score as %.4f would. Values within rounding noise of a tie (or out of the
+ * plain fixed-point range) are left to snprintf, so the text always matches printf.
+ */
+static char* append_score(char* out, double score) {
+    double scaled = score * 10000.0;
+    if (!(scaled >= 0.0 && scaled < 1e15)) {
+        return out + snprintf(out, 32, "%.4f", score);
+    }
+    double whole = floor(scaled);
+    double fraction = scaled - whole;
+    if (fabs(fraction - 0.5) < 1e-6) {
+        return out + snprintf(out, 32, "%.4f", score);
+    }
+    uint64_t fixed = (uint64_t)whole + (fraction > 0.5);
+    out = append_uint(out, fixed / 10000);
+    *out++ = '.';
+    uint64_t decimals = fixed % 10000;
+    out[0] = (char)('0' + decimals / 1000);
+    out[1] = (char)('0' + decimals / 100 % 10);
+    out[2] = (char)('0' + decimals / 10 % 10);
+    out[3] = (char)('0' + decimals % 10);
+    return out + 4;
+}
+
+static char* append_text(char* out, const char* text) {
+    size_t n = strlen(text);
+    memcpy(out, text, n);
+    return out + n;
+}
+
+void result_sink_point(ResultSink* sink, uint64_t key, long point, double score, bool anomaly) {
+    if (sink->verbosity == SINK_VERBOSITY_NONE || (sink->verbosity == SINK_VERBOSITY_ANOMALIES && !anomaly)) {
+        return;
+    }
+    sink->stats.points++;
+    char* start = reserve(sink, SINK_MAX_RECORD);
+    char* out = start;
+    switch (sink->format) {
+    case SINK_FORMAT_TEXT:
+        if (sink->keyed) {
+            out = append_text(out, "Stream ");
+            out = append_uint(out, key);
+            *out++ = ' ';
+        }
+        out = append_text(out, "Point ");
+        out = append_uint(out, (uint64_t)point);
+        out = append_text(out, ": Score=");
+        out = append_score(out, score);
+        out = append_text(out, anomaly ? " (ANOMALY)\n" : " (Normal)\n");
+        break;
+    case SINK_FORMAT_CSV:
+        if (sink->keyed) {
+            out = append_uint(out, key);
+            *out++ = ',';
+        }
+        out = append_uint(out, (uint64_t)point);
+        *out++ = ',';
+        out = append_score(out, score);
+        *out++ = ',';
+        *out++ = anomaly ? '1' : '0';
+        *out++ = '\n';
+        break;
+    case SINK_FORMAT_BINARY:
+        if (sink->keyed) {
+            SinkKeyedRecord record = { key, (uint64_t)point, anomaly ? 1u : 0u, 0u, score };
+            memcpy(out, &record, sizeof(record));
+            out += sizeof(record);
+        } else {
+            SinkRecord record = { (uint64_t)point, anomaly ? 1u : 0u, 0u, score };
+            memcpy(out, &record, sizeof(record));
+            out += sizeof(record);
+        }
+        break;
+    }
+    sink->used += (size_t)(out - start);
+}
+
+void result_sink_printf(ResultSink* sink, const char* format, ...) {
+    if (sink->format == SINK_FORMAT_BINARY) {
+        return;
+    }
+    char* start = reserve(sink, SINK_MAX_RECORD);
+    char* out = start;
+    size_t room = SINK_MAX_RECORD;
+    if (sink->format == SINK_FORMAT_CSV) {
+        *out++ = '#';
+        *out++ = ' ';
+        room -= 2;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out, room, format, args);
+    va_end(args);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n >= room) {
+        n = (int)room - 1;
+        out[n - 1] = '\n'; // Truncated: keep the line break
+    }
+    sink->used += (size_t)(out - start) + (size_t)n;
+}
+
+void result_sink_flush(ResultSink* sink) {
+    if (sink->used > 0) {
+        submit_buffer(sink);
+    }
+    pthread_mutex_lock(&sink->lock);
+    while (sink->queue_count > 0 || sink->writing) {
+        pthread_cond_wait(&sink->drained, &sink->lock);
+    }
+    pthread_mutex_unlock(&sink->lock);
+}
+
+ResultSinkStats result_sink_stats(ResultSink* sink) {
+    pthread_mutex_lock(&sink->lock);
+    ResultSinkStats stats = sink->stats;
+    pthread_mutex_unlock(&sink->lock);
+    return stats;
+}
+
+SinkVerbosity result_sink_verbosity(const ResultSink* sink) {
+    return sink->verbosity;
+}
+
+// --- Lifetime ---
+
+ResultSink* result_sink_create(const char* path, SinkFormat format, SinkVerbosity verbosity, bool keyed) {
+    ResultSink* sink = (ResultSink*)calloc(1, sizeof(ResultSink));
+    if (sink == NULL) {
+        perror("Error: Memory allocation failed for ResultSink");
+        return NULL;
+    }
+    sink->format = format;
+    sink->verbosity = verbosity;
+    sink->keyed = keyed;
+    sink->buffer_size = SINK_DEFAULT_BUFFER_SIZE;
+    for (int i = 0; i < SINK_BUFFERS; i++) {
+        sink->buffers[i] = (char*)malloc(sink->buffer_size);
+        if (sink->buffers[i] == NULL) {
+            perror("Error: Memory allocation failed for ResultSink buffers");
+            for (int j = 0; j < i; j++) free(sink->buffers[j]);
+            free(sink);
+            return NULL;
+        }
+    }
+    // Buffer 0 is filled first; the rest start free
+    sink->current = 0;
+    for (int i = SINK_BUFFERS - 1; i >= 1; i--) {
+        sink->free_buffers[sink->free_count++] = i;
+    }
+
+    if (path != NULL) {
+        sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (sink->fd < 0) {
+            perror("Error opening output file");
+            for (int i = 0; i < SINK_BUFFERS; i++) free(sink->buffers[i]);
+            free(sink);
+            return NULL;
+        }
+        sink->owns_fd = true;
+    } else {
+        // Anything printed through stdio so far must come out before the sink's writes
+        fflush(stdout);
+        sink->fd = fileno(stdout);
+    }
+
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->filled, NULL);
+    pthread_cond_init(&sink->drained, NULL);
+    if (pthread_create(&sink->thread, NULL, writer_thread, sink) != 0) {
+        perror("Error: could not start the output writer");
+        if (sink->owns_fd) close(sink->fd);
+        for (int i = 0; i < SINK_BUFFERS; i++) free(sink->buffers[i]);
+        free(sink);
+        return NULL;
+    }
+
+    if (format == SINK_FORMAT_BINARY) {
+        SinkBinaryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SINK_BINARY_MAGIC, 4);
+        header.version = SINK_BINARY_VERSION;
+        header.record_size = keyed ? sizeof(SinkKeyedRecord) : sizeof(SinkRecord);
+        header.keyed = keyed ? 1 : 0;
+        memcpy(reserve(sink, sizeof(header)), &header, sizeof(header));
+        sink->used += sizeof(header);
+    } else if (format == SINK_FORMAT_CSV) {
+        const char* columns = keyed ? "key,point,score,anomaly\n" : "point,score,anomaly\n";
+        size_t n = strlen(columns);
+        memcpy(reserve(sink, n), columns, n);
+        sink->used += n;
+    }
+    return sink;
+}
+
+void result_sink_close(ResultSink* sink) {
+    if (sink == NULL) {
+        return;
+    }
+    result_sink_flush(sink);
+    pthread_mutex_lock(&sink->lock);
+    sink->stop = true;
+    pthread_cond_signal(&sink->filled);
+    pthread_mutex_unlock(&sink->lock);
+    pthread_join(sink->thread, NULL);
+
+    pthread_mutex_destroy(&sink->lock);
+    pthread_cond_destroy(&sink->filled);
+    pthread_cond_destroy(&sink->drained);
+    if (sink->owns_fd) {
+        close(sink->fd);
+    }
+    for (int i = 0; i < SINK_BUFFERS; i++) {
+        free(sink->buffers[i]);
+    }
+    free(sink);
+}
+
+bool parse_sink_format(const char* name, SinkFormat* format) {
+    if (strcmp(name, "text") == 0) *format = SINK_FORMAT_TEXT;
+    else if (strcmp(name, "csv") == 0) *format = SINK_FORMAT_CSV;
+    else if (strcmp(name, "binary") == 0) *format = SINK_FORMAT_BINARY;
+    else return false;
+    return true;
+}
+
+bool parse_sink_verbosity(const char* name, SinkVerbosity* verbosity) {
+    if (strcmp(name, "none") == 0) *verbosity = SINK_VERBOSITY_NONE;
+    else if (strcmp(name, "anomalies") == 0) *verbosity = SINK_VERBOSITY_ANOMALIES;
+    else if (strcmp(name, "all") == 0) *verbosity = SINK_VERBOSITY_ALL;
+    else return false;
+    return true;
+}
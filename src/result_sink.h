@@ -0,0 +1,127 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Buffered Asynchronous Result Output ---
+// Scored points and status lines are encoded straight into large preallocated
+// buffers; full buffers are handed to a dedicated writer thread, so the scoring
+// thread never waits on terminal, pipe or file I/O (only, briefly, when every
+// buffer is still queued for writing).
+
+#define SINK_DEFAULT_BUFFER_SIZE (1 << 20) // Bytes per buffer
+#define SINK_BUFFERS 4                     // Buffers in rotation between producer and writer
+
+/**
+ * @brief Which scored points are written (status lines are always written).
+ */
+typedef enum {
+    SINK_VERBOSITY_NONE = 0,  // No per-point output
+    SINK_VERBOSITY_ANOMALIES, // Only points at or above the anomaly threshold
+    SINK_VERBOSITY_ALL        // Every scored point
+} SinkVerbosity;
+
+/**
+ * @brief Encoding of the output.
+ */
+typedef enum {
+    SINK_FORMAT_TEXT = 0,     // "Point N: Score=S (ANOMALY|Normal)" lines
+    SINK_FORMAT_CSV,          // "point,score,anomaly" rows; status lines become '#' comments
+    SINK_FORMAT_BINARY        // SinkBinaryHeader, then fixed-size records; status lines are dropped
+} SinkFormat;
+
+#define SINK_BINARY_MAGIC "IFRS"
+#define SINK_BINARY_VERSION 2 // 2: 64-bit point indices
+
+/**
+ * @brief Header of a binary result stream (native byte order).
+ */
+typedef struct {
+    char magic[4];          // SINK_BINARY_MAGIC
+    uint32_t version;       // SINK_BINARY_VERSION
+    uint32_t record_size;   // sizeof(SinkRecord) or sizeof(SinkKeyedRecord)
+    uint32_t keyed;         // 1: records carry a stream key
+} SinkBinaryHeader;
+
+typedef struct {
+    uint64_t point;         // Position in the stream (long replays exceed 32 bits)
+    uint32_t anomaly;       // 1 if score >= threshold
+    uint32_t reserved;      // Always 0
+    double score;
+} SinkRecord;
+
+typedef struct {
+    uint64_t key;
+    uint64_t point;
+    uint32_t anomaly;
+    uint32_t reserved;
+    double score;
+} SinkKeyedRecord;
+
+typedef struct ResultSink ResultSink;
+
+/**
+ * @brief Creates a sink and starts its writer thread.
+ * @param path Output file, or NULL for stdout (stdio's pending output is flushed first).
+ * @param format The encoding.
+ * @param verbosity Which points are written.
+ * @param keyed true if points carry stream keys (keyed streams).
+ * @return The sink, or NULL on failure.
+ */
+ResultSink* result_sink_create(const char* path, SinkFormat format, SinkVerbosity verbosity, bool keyed);
+
+/**
+ * @brief Writes everything still buffered, stops the writer and frees the sink (NULL is ignored).
+ */
+void result_sink_close(ResultSink* sink);
+
+/**
+ * @brief Blocks until everything submitted so far has been written.
+ */
+void result_sink_flush(ResultSink* sink);
+
+/**
+ * @brief Adds one scored point (filtered by the verbosity).
+ * @param sink The sink.
+ * @param key The point's stream key (ignored unless the sink is keyed).
+ * @param point The point's position in its stream.
+ * @param score Its anomaly score.
+ * @param anomaly Whether the score reaches the threshold.
+ */
+void result_sink_point(ResultSink* sink, uint64_t key, long point, double score, bool anomaly);
+
+/**
+ * @brief Adds a status line (printf-style; include the trailing newline).
+ */
+void result_sink_printf(ResultSink* sink, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Output statistics.
+ */
+typedef struct {
+    long points;        // Point records written (after filtering)
+    long bytes;         // Bytes handed to the writer
+    long stalls;        // Times the producer waited for a free buffer
+    bool write_error;   // A write failed (the rest of the output was discarded)
+} ResultSinkStats;
+
+ResultSinkStats result_sink_stats(ResultSink* sink);
+
+/**
+ * @brief Returns which points the sink writes (fixed when it is created).
+ */
+SinkVerbosity result_sink_verbosity(const ResultSink* sink);
+
+/**
+ * @brief Parses "text", "csv" or "binary".
+ */
+bool parse_sink_format(const char* name, SinkFormat* format);
+
+/**
+ * @brief Parses "none", "anomalies" or "all".
+ */
+bool parse_sink_verbosity(const char* name, SinkVerbosity* verbosity);
+
+#endif // RESULT_SINK_H
@@ -0,0 +1,184 @@
+#include "rng.h"
+
+// --- xoshiro256** Implementation ---
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * SplitMix64 output function: advances the state and returns a well-mixed 64-bit value.
+ * Only used to expand seeds into xoshiro states.
+ */
+static uint64_t splitmix_next(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * xoshiro256** step on a state array (the bulk functions pass a local copy).
+ */
+static inline uint64_t next(uint64_t* s) {
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * The top 53 bits give a uniformly distributed double in [0.0, 1.0).
+ */
+static inline double unit_double(uint64_t bits) {
+    return (double)(bits >> 11) * 0x1.0p-53;
+}
+
+/**
+ * Maps 32 random bits onto [0, range) by multiplication (Lemire's method); draws are
+ * rejected only in the rare biased case, which costs one division to detect.
+ */
+static inline uint32_t bounded(uint64_t* s, uint32_t range) {
+    uint64_t m = (next(s) >> 32) * (uint64_t)range;
+    uint32_t low = (uint32_t)m;
+    if (low < range) {
+        uint32_t threshold = (uint32_t)(-range) % range;
+        while (low < threshold) {
+            m = (next(s) >> 32) * (uint64_t)range;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/**
+ * @brief Seeds a random stream from a base seed and a stream number.
+ */
+void rng_seed(RngState* rng, uint64_t seed, uint64_t stream) {
+    // Scramble the stream number so neighbouring trees do not get overlapping sequences
+    uint64_t mixer = stream;
+    uint64_t state = seed ^ splitmix_next(&mixer);
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix_next(&state);
+    }
+}
+
+uint64_t rng_next(RngState* rng) {
+    return next(rng->s);
+}
+
+/**
+ * @brief Advances a stream by 2^128 draws (the reference xoshiro256 jump polynomial).
+ */
+void rng_jump(RngState* rng) {
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+    uint64_t s[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (1ULL << b)) {
+                s[0] ^= rng->s[0];
+                s[1] ^= rng->s[1];
+                s[2] ^= rng->s[2];
+                s[3] ^= rng->s[3];
+            }
+            next(rng->s);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = s[i];
+    }
+}
+
+void rng_split(RngState* rng, RngState* child) {
+    *child = *rng;
+    rng_jump(rng);
+}
+
+/**
+ * @brief Generates a random integer within [min, max], inclusive, from an explicit stream.
+ */
+int rng_integer(RngState* rng, int min, int max) {
+    if (min > max) {
+        return min;
+    }
+    uint64_t range = (uint64_t)((int64_t)max - (int64_t)min + 1);
+    if (range > UINT32_MAX) {
+        // The full int range: any 32 bits will do
+        return (int)((int64_t)min + (int64_t)(next(rng->s) >> 32));
+    }
+    return (int)((int64_t)min + bounded(rng->s, (uint32_t)range));
+}
+
+/**
+ * @brief Generates a random double uniformly distributed within [min, max) from an explicit stream.
+ */
+double rng_uniform(RngState* rng, double min, double max) {
+    if (min >= max) {
+        return min;
+    }
+    return min + unit_double(next(rng->s)) * (max - min);
+}
+
+void rng_fill_uniform(RngState* rng, double* out, size_t count, double min, double max) {
+    if (min >= max) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = min;
+        }
+        return;
+    }
+    uint64_t s[4] = { rng->s[0], rng->s[1], rng->s[2], rng->s[3] };
+    double span = max - min;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = min + unit_double(next(s)) * span;
+    }
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = s[i];
+    }
+}
+
+void rng_fill_integers(RngState* rng, int* out, size_t count, int min, int max) {
+    uint64_t range = (min > max) ? 0 : (uint64_t)((int64_t)max - (int64_t)min + 1);
+    if (range == 0 || range > UINT32_MAX) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = rng_integer(rng, min, max);
+        }
+        return;
+    }
+    uint64_t s[4] = { rng->s[0], rng->s[1], rng->s[2], rng->s[3] };
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (int)((int64_t)min + bounded(s, (uint32_t)range));
+    }
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = s[i];
+    }
+}
+
+
+// --- Global Seed Source ---
+
+static RngState global_rng;
+static int global_rng_seeded = 0;
+
+/**
+ * @brief Seeds the global generator (stream 0 of the run's seed).
+ */
+void initialize_rng(uint64_t seed) {
+    rng_seed(&global_rng, seed, 0);
+    global_rng_seeded = 1;
+}
+
+/**
+ * @brief Draws a 64-bit seed from the global generator.
+ */
+uint64_t get_random_seed() {
+    if (!global_rng_seeded) {
+        initialize_rng(0); // Unseeded programs still get a fixed, valid sequence
+    }
+    return next(global_rng.s);
+}
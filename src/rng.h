@@ -0,0 +1,90 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint64_t
+
+// --- Random Number Generation ---
+// xoshiro256** generators with explicit state. Nothing here is locked or shared: each
+// tree, thread or stream owns its RngState. The global generator only hands out seeds
+// for those states, so seeding it (initialize_rng) fixes every random choice of a run.
+
+/**
+ * @brief An explicit, thread-confined random number generator state (xoshiro256**).
+ * Training gives every tree its own stream, seeded from a per-retrain seed and the
+ * tree index, so the forest is independent of which thread builds which tree.
+ */
+typedef struct {
+    uint64_t s[4];
+} RngState;
+
+/**
+ * @brief Seeds a random stream; distinct (seed, stream) pairs yield independent sequences.
+ * The state is expanded from the pair with SplitMix64, so it is never all zero.
+ * @param rng The state to initialize.
+ * @param seed The base seed.
+ * @param stream The stream number (e.g., the tree index).
+ */
+void rng_seed(RngState* rng, uint64_t seed, uint64_t stream);
+
+/**
+ * @brief Returns the next 64 random bits of a stream.
+ */
+uint64_t rng_next(RngState* rng);
+
+/**
+ * @brief Advances a stream by 2^128 draws (as many as 2^128 calls to rng_next).
+ * Starting from one seed, k jumps give k + 1 sequences that never overlap.
+ */
+void rng_jump(RngState* rng);
+
+/**
+ * @brief Splits off an independent stream: child continues the current sequence and
+ * rng jumps 2^128 draws ahead, so the two never overlap. Use it to hand each thread
+ * its own generator.
+ * @param rng The stream to split (advanced by the jump).
+ * @param child Receives the new stream.
+ */
+void rng_split(RngState* rng, RngState* child);
+
+/**
+ * @brief Generates a random integer within [min, max], inclusive, from an explicit stream.
+ * Every value is equally likely (no modulo bias).
+ */
+int rng_integer(RngState* rng, int min, int max);
+
+/**
+ * @brief Generates a random double uniformly distributed within [min, max) from an explicit stream.
+ */
+double rng_uniform(RngState* rng, double min, double max);
+
+/**
+ * @brief Fills out with count doubles uniformly distributed within [min, max).
+ * Equivalent to count calls of rng_uniform, with the state kept in registers.
+ */
+void rng_fill_uniform(RngState* rng, double* out, size_t count, double min, double max);
+
+/**
+ * @brief Fills out with count integers within [min, max], inclusive.
+ * Equivalent to count calls of rng_integer, with the range set up once.
+ */
+void rng_fill_integers(RngState* rng, int* out, size_t count, int min, int max);
+
+
+// --- Global Seed Source ---
+
+/**
+ * @brief Seeds the global generator. Runs with the same seed (and the same input and
+ * options) make the same random choices.
+ * @param seed The run's seed (main uses --seed, or the current time).
+ */
+void initialize_rng(uint64_t seed);
+
+/**
+ * @brief Draws a 64-bit seed from the global generator (used to seed RngState streams).
+ * Call it from one thread at a time (the stream reader or routing thread).
+ * @return A random 64-bit seed.
+ */
+uint64_t get_random_seed();
+
+#endif // RNG_H
@@ -0,0 +1,443 @@
+#include "score_kernels.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+typedef void (*PathLengthKernel)(const ITree* tree, const DataPoint* pts, int n, double* acc);
+
+// Tree depths (ceil(log2(ψ)), i.e. ψ from 16 to 4096) that get kernels with a
+// compile-time trip count; other depths use the generic kernels
+#define MIN_SPECIALIZED_DEPTH 4
+#define MAX_SPECIALIZED_DEPTH 12
+
+// Independent vectors advanced in lockstep so their gather latencies overlap
+#define SIMD_INTERLEAVE 4
+
+/**
+ * @brief One instruction-set flavour of the traversal kernel.
+ */
+typedef struct {
+    const char* name;
+    PathLengthKernel generic;                               // Any depth
+    PathLengthKernel by_depth[MAX_SPECIALIZED_DEPTH + 1];   // Unrolled for a fixed depth (or NULL)
+} KernelSet;
+
+/**
+ * Offset, in feature values, of a point's features from the batch's first point.
+ * Points are views, so lanes address them relative to a common base.
+ */
+static inline long long row_offset(const DataPoint* pts, int j) {
+    return (long long)(((intptr_t)pts[j].features - (intptr_t)pts[0].features) / (intptr_t)sizeof(feature_t));
+}
+
+// --- Scalar Kernel ---
+
+/**
+ * Fixed-depth branchless walk (see get_path_length); inlined with a constant depth
+ * into the specialized kernels.
+ */
+static inline __attribute__((always_inline))
+void scalar_body(const ITree* tree, const DataPoint* pts, int n, double* acc, int depth) {
+    const Node* nodes = tree->nodes;
+    if (nodes == NULL || tree->node_count == 0) {
+        return;
+    }
+    for (int j = 0; j < n; j++) {
+        const feature_t* x = pts[j].features;
+        int index = 0;
+        for (int d = 0; d < depth; d++) {
+            int go_right = !(x[nodes[index].split_feature_index] <= nodes[index].value);
+            index = 2 * index + 1 + go_right;
+        }
+        acc[j] += nodes[index].value;
+    }
+}
+
+static void path_lengths_scalar(const ITree* tree, const DataPoint* pts, int n, double* acc) {
+    scalar_body(tree, pts, n, acc, tree->depth);
+}
+
+#ifdef HAVE_X86_KERNELS
+
+#ifndef IFOREST_FLOAT32
+
+// The kernels gather split_feature_index and reserved as one 64-bit index, which is only
+// the feature index while reserved is 0 (training writes 0, model loading rejects anything else)
+_Static_assert(offsetof(Node, split_feature_index) == 0 && offsetof(Node, reserved) == sizeof(int) &&
+               offsetof(Node, value) == 8 && sizeof(Node) == 16, "Node must be two 64-bit words");
+
+// --- AVX2 Kernel ---
+
+/**
+ * Advances 4 x SIMD_INTERLEAVE points through the tree per step. A Node is two 64-bit
+ * words (feature index, split value), so node i's feature is word 2i and its value
+ * word 2i+1. The child index update 2i+1+go_right is branchless: the comparison mask
+ * is -1 for "right".
+ */
+static inline __attribute__((always_inline, target("avx2")))
+void avx2_body(const ITree* tree, const DataPoint* pts, int n, double* acc, int depth) {
+    if (tree->nodes == NULL || tree->node_count == 0) {
+        return;
+    }
+    assert(tree->nodes[0].reserved == 0);
+    const long long* node_words = (const long long*)tree->nodes;
+    const double* node_values = (const double*)tree->nodes;
+    const double* base = pts[0].features;
+    const __m256i one = _mm256_set1_epi64x(1);
+    const int step = 4 * SIMD_INTERLEAVE;
+
+    int j = 0;
+    for (; j + step <= n; j += step) {
+        __m256i rows[SIMD_INTERLEAVE];
+        __m256i index[SIMD_INTERLEAVE]; // Current node i of each lane
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            int k = j + 4 * g;
+            rows[g] = _mm256_set_epi64x(row_offset(pts, k + 3), row_offset(pts, k + 2),
+                                        row_offset(pts, k + 1), row_offset(pts, k));
+            index[g] = _mm256_setzero_si256();
+        }
+
+        for (int d = 0; d < depth; d++) {
+            for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+                __m256i word = _mm256_add_epi64(index[g], index[g]);
+                __m256i feature = _mm256_i64gather_epi64(node_words, word, 8);
+                __m256d split = _mm256_i64gather_pd(node_values, _mm256_add_epi64(word, one), 8);
+                __m256d x = _mm256_i64gather_pd(base, _mm256_add_epi64(rows[g], feature), 8);
+                // !(x <= v) matches the scalar walk, including NaN going right
+                __m256i go_right = _mm256_castpd_si256(_mm256_cmp_pd(x, split, _CMP_NLE_UQ));
+                index[g] = _mm256_sub_epi64(_mm256_add_epi64(word, one), go_right); // 2i + 1 + go_right
+            }
+        }
+
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            __m256i word = _mm256_add_epi64(index[g], index[g]);
+            __m256d leaf = _mm256_i64gather_pd(node_values, _mm256_add_epi64(word, one), 8);
+            double* out = acc + j + 4 * g;
+            _mm256_storeu_pd(out, _mm256_add_pd(_mm256_loadu_pd(out), leaf));
+        }
+    }
+    scalar_body(tree, pts + j, n - j, acc + j, depth);
+}
+
+__attribute__((target("avx2")))
+static void path_lengths_avx2(const ITree* tree, const DataPoint* pts, int n, double* acc) {
+    avx2_body(tree, pts, n, acc, tree->depth);
+}
+
+// --- AVX-512 Kernel ---
+
+/**
+ * Same walk as the AVX2 kernel with 8 lanes; the comparison yields a mask register
+ * that conditionally adds 1 to the left child index.
+ */
+static inline __attribute__((always_inline, target("avx512f")))
+void avx512_body(const ITree* tree, const DataPoint* pts, int n, double* acc, int depth) {
+    if (tree->nodes == NULL || tree->node_count == 0) {
+        return;
+    }
+    assert(tree->nodes[0].reserved == 0);
+    const long long* node_words = (const long long*)tree->nodes;
+    const double* node_values = (const double*)tree->nodes;
+    const double* base = pts[0].features;
+    const __m512i one = _mm512_set1_epi64(1);
+    const int step = 8 * SIMD_INTERLEAVE;
+
+    int j = 0;
+    for (; j + step <= n; j += step) {
+        __m512i rows[SIMD_INTERLEAVE];
+        __m512i index[SIMD_INTERLEAVE];
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            int k = j + 8 * g;
+            rows[g] = _mm512_set_epi64(row_offset(pts, k + 7), row_offset(pts, k + 6),
+                                       row_offset(pts, k + 5), row_offset(pts, k + 4),
+                                       row_offset(pts, k + 3), row_offset(pts, k + 2),
+                                       row_offset(pts, k + 1), row_offset(pts, k));
+            index[g] = _mm512_setzero_si512();
+        }
+
+        for (int d = 0; d < depth; d++) {
+            for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+                __m512i word = _mm512_add_epi64(index[g], index[g]);
+                __m512i feature = _mm512_i64gather_epi64(word, node_words, 8);
+                __m512d split = _mm512_i64gather_pd(_mm512_add_epi64(word, one), node_values, 8);
+                __m512d x = _mm512_i64gather_pd(_mm512_add_epi64(rows[g], feature), base, 8);
+                __mmask8 go_right = _mm512_cmp_pd_mask(x, split, _CMP_NLE_UQ);
+                index[g] = _mm512_mask_add_epi64(_mm512_add_epi64(word, one), go_right,
+                                                 _mm512_add_epi64(word, one), one);
+            }
+        }
+
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            __m512i word = _mm512_add_epi64(index[g], index[g]);
+            __m512d leaf = _mm512_i64gather_pd(_mm512_add_epi64(word, one), node_values, 8);
+            double* out = acc + j + 8 * g;
+            _mm512_storeu_pd(out, _mm512_add_pd(_mm512_loadu_pd(out), leaf));
+        }
+    }
+    scalar_body(tree, pts + j, n - j, acc + j, depth);
+}
+
+#else // IFOREST_FLOAT32
+
+// --- Float32 Storage ---
+// A Node is two 32-bit words and features are floats, so lanes are 32 bits wide and a
+// vector advances twice as many points as in the double build. Leaf path lengths are
+// widened to double before they are added, so the sums match the scalar walk exactly.
+
+#define MAX_LANE_OFFSET (1 << 30) // Row offsets (plus a feature index) must fit in 32-bit lanes
+
+/**
+ * Fills offsets with the row offsets of points k .. k+count-1; false if any is too far
+ * from the batch base for a 32-bit lane (such points are walked by the scalar code).
+ */
+static inline bool lane_offsets(const DataPoint* pts, int k, int count, int* offsets) {
+    for (int i = 0; i < count; i++) {
+        long long offset = row_offset(pts, k + i);
+        if (offset < -MAX_LANE_OFFSET || offset > MAX_LANE_OFFSET) {
+            return false;
+        }
+        offsets[i] = (int)offset;
+    }
+    return true;
+}
+
+// --- AVX2 Kernel ---
+
+/**
+ * Advances 8 x SIMD_INTERLEAVE points through the tree per step: node i's feature is
+ * word 2i and its split value word 2i+1, and the child index update 2i+1+go_right is
+ * branchless (the comparison mask is -1 for "right").
+ */
+static inline __attribute__((always_inline, target("avx2")))
+void avx2_body(const ITree* tree, const DataPoint* pts, int n, double* acc, int depth) {
+    if (tree->nodes == NULL || tree->node_count == 0) {
+        return;
+    }
+    const int* node_words = (const int*)tree->nodes;
+    const float* node_values = (const float*)tree->nodes;
+    const float* base = pts[0].features;
+    const __m256i one = _mm256_set1_epi32(1);
+    const int step = 8 * SIMD_INTERLEAVE;
+
+    int j = 0;
+    for (; j + step <= n; j += step) {
+        int offsets[8 * SIMD_INTERLEAVE];
+        if (!lane_offsets(pts, j, step, offsets)) {
+            scalar_body(tree, pts + j, step, acc + j, depth);
+            continue;
+        }
+        __m256i rows[SIMD_INTERLEAVE];
+        __m256i index[SIMD_INTERLEAVE]; // Current node i of each lane
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            rows[g] = _mm256_loadu_si256((const __m256i*)(offsets + 8 * g));
+            index[g] = _mm256_setzero_si256();
+        }
+
+        for (int d = 0; d < depth; d++) {
+            for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+                __m256i word = _mm256_add_epi32(index[g], index[g]);
+                __m256i feature = _mm256_i32gather_epi32(node_words, word, 4);
+                __m256 split = _mm256_i32gather_ps(node_values, _mm256_add_epi32(word, one), 4);
+                __m256 x = _mm256_i32gather_ps(base, _mm256_add_epi32(rows[g], feature), 4);
+                // !(x <= v) matches the scalar walk, including NaN going right
+                __m256i go_right = _mm256_castps_si256(_mm256_cmp_ps(x, split, _CMP_NLE_UQ));
+                index[g] = _mm256_sub_epi32(_mm256_add_epi32(word, one), go_right); // 2i + 1 + go_right
+            }
+        }
+
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            __m256i word = _mm256_add_epi32(index[g], index[g]);
+            __m256 leaf = _mm256_i32gather_ps(node_values, _mm256_add_epi32(word, one), 4);
+            double* out = acc + j + 8 * g;
+            _mm256_storeu_pd(out, _mm256_add_pd(_mm256_loadu_pd(out), _mm256_cvtps_pd(_mm256_castps256_ps128(leaf))));
+            _mm256_storeu_pd(out + 4, _mm256_add_pd(_mm256_loadu_pd(out + 4), _mm256_cvtps_pd(_mm256_extractf128_ps(leaf, 1))));
+        }
+    }
+    scalar_body(tree, pts + j, n - j, acc + j, depth);
+}
+
+__attribute__((target("avx2")))
+static void path_lengths_avx2(const ITree* tree, const DataPoint* pts, int n, double* acc) {
+    avx2_body(tree, pts, n, acc, tree->depth);
+}
+
+// --- AVX-512 Kernel ---
+
+/**
+ * Same walk as the AVX2 kernel with 16 lanes; the comparison yields a mask register
+ * that conditionally adds 1 to the left child index.
+ */
+static inline __attribute__((always_inline, target("avx512f")))
+void avx512_body(const ITree* tree, const DataPoint* pts, int n, double* acc, int depth) {
+    if (tree->nodes == NULL || tree->node_count == 0) {
+        return;
+    }
+    const int* node_words = (const int*)tree->nodes;
+    const float* node_values = (const float*)tree->nodes;
+    const float* base = pts[0].features;
+    const __m512i one = _mm512_set1_epi32(1);
+    const int step = 16 * SIMD_INTERLEAVE;
+
+    int j = 0;
+    for (; j + step <= n; j += step) {
+        int offsets[16 * SIMD_INTERLEAVE];
+        if (!lane_offsets(pts, j, step, offsets)) {
+            scalar_body(tree, pts + j, step, acc + j, depth);
+            continue;
+        }
+        __m512i rows[SIMD_INTERLEAVE];
+        __m512i index[SIMD_INTERLEAVE];
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            rows[g] = _mm512_loadu_si512(offsets + 16 * g);
+            index[g] = _mm512_setzero_si512();
+        }
+
+        for (int d = 0; d < depth; d++) {
+            for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+                __m512i word = _mm512_add_epi32(index[g], index[g]);
+                __m512i feature = _mm512_i32gather_epi32(word, node_words, 4);
+                __m512 split = _mm512_i32gather_ps(_mm512_add_epi32(word, one), node_values, 4);
+                __m512 x = _mm512_i32gather_ps(_mm512_add_epi32(rows[g], feature), base, 4);
+                __mmask16 go_right = _mm512_cmp_ps_mask(x, split, _CMP_NLE_UQ);
+                index[g] = _mm512_mask_add_epi32(_mm512_add_epi32(word, one), go_right,
+                                                 _mm512_add_epi32(word, one), one);
+            }
+        }
+
+        for (int g = 0; g < SIMD_INTERLEAVE; g++) {
+            __m512i word = _mm512_add_epi32(index[g], index[g]);
+            __m512 leaf = _mm512_i32gather_ps(_mm512_add_epi32(word, one), node_values, 4);
+            __m256 high = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(leaf), 1));
+            double* out = acc + j + 16 * g;
+            _mm512_storeu_pd(out, _mm512_add_pd(_mm512_loadu_pd(out), _mm512_cvtps_pd(_mm512_castps512_ps256(leaf))));
+            _mm512_storeu_pd(out + 8, _mm512_add_pd(_mm512_loadu_pd(out + 8), _mm512_cvtps_pd(high)));
+        }
+    }
+    scalar_body(tree, pts + j, n - j, acc + j, depth);
+}
+
+#endif // IFOREST_FLOAT32
+
+__attribute__((target("avx512f")))
+static void path_lengths_avx512(const ITree* tree, const DataPoint* pts, int n, double* acc) {
+    avx512_body(tree, pts, n, acc, tree->depth);
+}
+
+#endif // HAVE_X86_KERNELS
+
+// --- Depth-Specialized Kernels ---
+
+// Instantiates each kernel body with a constant depth so the walk is fully unrolled
+#define DEFINE_SCALAR_DEPTH_KERNEL(D) \
+    static void path_lengths_scalar_d##D(const ITree* tree, const DataPoint* pts, int n, double* acc) { \
+        scalar_body(tree, pts, n, acc, D); \
+    }
+
+#ifdef HAVE_X86_KERNELS
+#define DEFINE_DEPTH_KERNELS(D) \
+    DEFINE_SCALAR_DEPTH_KERNEL(D) \
+    __attribute__((target("avx2"))) \
+    static void path_lengths_avx2_d##D(const ITree* tree, const DataPoint* pts, int n, double* acc) { \
+        avx2_body(tree, pts, n, acc, D); \
+    } \
+    __attribute__((target("avx512f"))) \
+    static void path_lengths_avx512_d##D(const ITree* tree, const DataPoint* pts, int n, double* acc) { \
+        avx512_body(tree, pts, n, acc, D); \
+    }
+#else
+#define DEFINE_DEPTH_KERNELS(D) DEFINE_SCALAR_DEPTH_KERNEL(D)
+#endif
+
+DEFINE_DEPTH_KERNELS(4)
+DEFINE_DEPTH_KERNELS(5)
+DEFINE_DEPTH_KERNELS(6)
+DEFINE_DEPTH_KERNELS(7)
+DEFINE_DEPTH_KERNELS(8)
+DEFINE_DEPTH_KERNELS(9)
+DEFINE_DEPTH_KERNELS(10)
+DEFINE_DEPTH_KERNELS(11)
+DEFINE_DEPTH_KERNELS(12)
+
+#define DEPTH_TABLE(prefix) { \
+    [4] = prefix##_d4, [5] = prefix##_d5, [6] = prefix##_d6, [7] = prefix##_d7, [8] = prefix##_d8, \
+    [9] = prefix##_d9, [10] = prefix##_d10, [11] = prefix##_d11, [12] = prefix##_d12 }
+
+static const KernelSet scalar_kernels = { "scalar", path_lengths_scalar, DEPTH_TABLE(path_lengths_scalar) };
+#ifdef HAVE_X86_KERNELS
+static const KernelSet avx2_kernels = { "avx2", path_lengths_avx2, DEPTH_TABLE(path_lengths_avx2) };
+static const KernelSet avx512_kernels = { "avx512", path_lengths_avx512, DEPTH_TABLE(path_lengths_avx512) };
+#endif
+
+// --- Runtime Dispatch ---
+
+// NULL until the first selection (explicit or auto-detected on first use)
+static const KernelSet* _Atomic active_kernels = NULL;
+
+int select_score_kernel(ScoreKernelType type) {
+    const KernelSet* kernels = NULL;
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    int has_avx512 = __builtin_cpu_supports("avx512f");
+    int has_avx2 = __builtin_cpu_supports("avx2");
+#else
+    int has_avx512 = 0;
+    int has_avx2 = 0;
+#endif
+
+    if (type == SCORE_KERNEL_AUTO) {
+        type = has_avx512 ? SCORE_KERNEL_AVX512 : (has_avx2 ? SCORE_KERNEL_AVX2 : SCORE_KERNEL_SCALAR);
+    }
+
+    switch (type) {
+        case SCORE_KERNEL_SCALAR:
+            kernels = &scalar_kernels;
+            break;
+#ifdef HAVE_X86_KERNELS
+        case SCORE_KERNEL_AVX2:
+            kernels = has_avx2 ? &avx2_kernels : NULL;
+            break;
+        case SCORE_KERNEL_AVX512:
+            kernels = has_avx512 ? &avx512_kernels : NULL;
+            break;
+#endif
+        default:
+            break;
+    }
+
+    if (kernels == NULL) {
+        return 0;
+    }
+    atomic_store(&active_kernels, kernels);
+    return 1;
+}
+
+/**
+ * Returns the active kernel set, auto-selecting it on first use.
+ */
+static const KernelSet* current_kernels() {
+    const KernelSet* kernels = atomic_load_explicit(&active_kernels, memory_order_acquire);
+    if (kernels == NULL) {
+        select_score_kernel(SCORE_KERNEL_AUTO);
+        kernels = atomic_load(&active_kernels);
+    }
+    return kernels;
+}
+
+const char* score_kernel_name() {
+    return current_kernels()->name;
+}
+
+void accumulate_path_lengths(const ITree* tree, const DataPoint* pts, int n, double* acc) {
+    const KernelSet* kernels = current_kernels();
+    int depth = tree->depth;
+    PathLengthKernel kernel = (depth >= MIN_SPECIALIZED_DEPTH && depth <= MAX_SPECIALIZED_DEPTH)
+                                  ? kernels->by_depth[depth] : kernels->generic;
+    kernel(tree, pts, n, acc);
+}
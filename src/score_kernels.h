@@ -0,0 +1,44 @@
+#ifndef SCORE_KERNELS_H
+#define SCORE_KERNELS_H
+
+#include "core_ds.h" // For ITree, DataPoint
+
+// --- Multi-Point Tree Traversal Kernels ---
+
+/**
+ * @brief Available implementations of the multi-point traversal kernel.
+ */
+typedef enum {
+    SCORE_KERNEL_AUTO = 0, // Best kernel supported by the running CPU
+    SCORE_KERNEL_SCALAR,   // Portable one-point-at-a-time walk
+    SCORE_KERNEL_AVX2,     // 4 points per step using AVX2 gathers
+    SCORE_KERNEL_AVX512    // 8 points per step using AVX-512F gathers
+} ScoreKernelType;
+
+/**
+ * @brief Selects the traversal kernel used by accumulate_path_lengths.
+ * * SCORE_KERNEL_AUTO picks the widest kernel the CPU supports (detected at runtime).
+ * All kernels produce bit-identical path lengths.
+ * @param type The requested kernel.
+ * @return 1 if the kernel is available and now active, 0 otherwise (selection unchanged).
+ */
+int select_score_kernel(ScoreKernelType type);
+
+/**
+ * @brief Returns the name of the active kernel ("scalar", "avx2" or "avx512").
+ */
+const char* score_kernel_name();
+
+/**
+ * @brief Walks n points through one tree and adds each point's path length to acc[j].
+ * * Dispatches to the active kernel (auto-selected on first use), using the variant
+ * unrolled for the tree's depth when one exists. Points are addressed through their
+ * feature pointers, so the kernels do not depend on the feature count.
+ * @param tree The trained iTree.
+ * @param pts The points to traverse.
+ * @param n The number of points.
+ * @param acc Per-point path length accumulators (n entries).
+ */
+void accumulate_path_lengths(const ITree* tree, const DataPoint* pts, int n, double* acc);
+
+#endif // SCORE_KERNELS_H
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L // For sched_yield, clock_gettime
+
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+
+#define CACHE_LINE 64
+#define SPIN_LIMIT 128   // Polls before a waiting side starts yielding the CPU
+#define YIELD_LIMIT 1024 // Polls before it sleeps until the other side makes progress
+#define SLEEP_TIMEOUT_NS 10000000L // Longest sleep between rechecks (lets a cancel be seen)
+
+struct SpscRing {
+    // Producer and consumer indices live on separate cache lines; each side also keeps
+    // a private copy of the other's index and only reloads it when the ring looks full/empty
+    _Alignas(CACHE_LINE) atomic_size_t tail; // Next slot to publish (written by the producer)
+    size_t head_cache;                       // Producer's view of head
+    _Alignas(CACHE_LINE) atomic_size_t head; // Next slot to consume (written by the consumer)
+    size_t tail_cache;                       // Consumer's view of tail
+    _Alignas(CACHE_LINE) unsigned char* slots;
+    size_t slot_size;
+    size_t mask;                             // capacity - 1
+    // Sleeping: each side checks the other's flag after publishing, so the mutex is
+    // only taken once a side has been waiting for a long time
+    _Alignas(CACHE_LINE) atomic_bool producer_sleeping;
+    atomic_bool consumer_sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t progress;
+};
+
+SpscRing* spsc_ring_create(int capacity, size_t slot_size) {
+    size_t slots = 1;
+    while (slots < (size_t)capacity) {
+        slots <<= 1;
+    }
+    size_t bytes = (sizeof(SpscRing) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    SpscRing* ring = (SpscRing*)aligned_alloc(CACHE_LINE, bytes);
+    if (ring == NULL) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->slots = (unsigned char*)calloc(slots, slot_size);
+    if (ring->slots == NULL) {
+        free(ring);
+        return NULL;
+    }
+    ring->slot_size = slot_size;
+    ring->mask = slots - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->producer_sleeping, false);
+    atomic_init(&ring->consumer_sleeping, false);
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->progress, NULL);
+    return ring;
+}
+
+void spsc_ring_destroy(SpscRing* ring) {
+    if (ring == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->progress);
+    free(ring->slots);
+    free(ring);
+}
+
+int spsc_ring_capacity(const SpscRing* ring) {
+    return (int)(ring->mask + 1);
+}
+
+void* spsc_ring_slot(SpscRing* ring, int i) {
+    return ring->slots + (size_t)i * ring->slot_size;
+}
+
+/**
+ * Sleeps until the other side moves index away from stale (or SLEEP_TIMEOUT_NS passes).
+ * The sleeping flag is set before the last check of index, and the other side reads it
+ * after storing index (both sequentially consistent), so a wakeup cannot be missed.
+ */
+static void sleep_until_progress(SpscRing* ring, atomic_bool* sleeping, const atomic_size_t* index, size_t stale) {
+    pthread_mutex_lock(&ring->lock);
+    atomic_store(sleeping, true);
+    if (atomic_load(index) == stale) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += SLEEP_TIMEOUT_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&ring->progress, &ring->lock, &deadline);
+    }
+    atomic_store(sleeping, false);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static void wait_a_little(SpscRing* ring, int* spins, atomic_bool* sleeping, const atomic_size_t* index, size_t stale) {
+    ++*spins;
+    if (*spins > YIELD_LIMIT) {
+        sleep_until_progress(ring, sleeping, index, stale);
+    } else if (*spins > SPIN_LIMIT) {
+        sched_yield();
+    }
+}
+
+/**
+ * Wakes the other side if it is sleeping (called after storing this side's index).
+ */
+static inline void wake_sleeper(SpscRing* ring, atomic_bool* sleeping) {
+    if (atomic_load(sleeping)) {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_broadcast(&ring->progress);
+        pthread_mutex_unlock(&ring->lock);
+    }
+}
+
+void* spsc_ring_begin_push(SpscRing* ring, const atomic_bool* cancel) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins = 0;
+    while (tail - ring->head_cache > ring->mask) {
+        ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail - ring->head_cache <= ring->mask) break;
+        if (cancel != NULL && atomic_load_explicit(cancel, memory_order_relaxed)) {
+            return NULL;
+        }
+        wait_a_little(ring, &spins, &ring->producer_sleeping, &ring->head, ring->head_cache);
+    }
+    return ring->slots + (tail & ring->mask) * ring->slot_size;
+}
+
+void spsc_ring_end_push(SpscRing* ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store(&ring->tail, tail + 1);
+    wake_sleeper(ring, &ring->consumer_sleeping);
+}
+
+void* spsc_ring_begin_pop(SpscRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins = 0;
+    while (head == ring->tail_cache) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head != ring->tail_cache) break;
+        wait_a_little(ring, &spins, &ring->consumer_sleeping, &ring->tail, ring->tail_cache);
+    }
+    return ring->slots + (head & ring->mask) * ring->slot_size;
+}
+
+void spsc_ring_end_pop(SpscRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store(&ring->head, head + 1);
+    // A producer sleeping on a full ring is woken once half of it is free, not for every
+    // slot (it would only fill the one slot and sleep again)
+    if (atomic_load(&ring->producer_sleeping) &&
+        atomic_load_explicit(&ring->tail, memory_order_relaxed) - (head + 1) <= (ring->mask + 1) / 2) {
+        wake_sleeper(ring, &ring->producer_sleeping);
+    }
+}
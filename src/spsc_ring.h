@@ -0,0 +1,61 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @brief A bounded lock-free single-producer/single-consumer ring of fixed-size slots.
+ * Slots are used in place: the producer fills the slot returned by spsc_ring_begin_push
+ * and publishes it with spsc_ring_end_push; the consumer reads the slot returned by
+ * spsc_ring_begin_pop and hands it back with spsc_ring_end_pop, so nothing is copied
+ * and slot contents (e.g. row pointers) survive a round trip. A full ring blocks the
+ * producer (backpressure); an empty ring blocks the consumer. Waiting spins briefly,
+ * then yields the CPU, then sleeps until the other side publishes or frees a slot, so an
+ * idle input (e.g. a live feed on stdin) does not keep a core busy.
+ */
+typedef struct SpscRing SpscRing;
+
+/**
+ * @brief Creates a ring.
+ * @param capacity Number of slots (rounded up to a power of two).
+ * @param slot_size Bytes per slot; slots start zeroed.
+ * @return The ring, or NULL on failure.
+ */
+SpscRing* spsc_ring_create(int capacity, size_t slot_size);
+
+void spsc_ring_destroy(SpscRing* ring);
+
+/**
+ * @brief Returns the number of slots.
+ */
+int spsc_ring_capacity(const SpscRing* ring);
+
+/**
+ * @brief Direct access to slot i in [0, capacity), for setting slots up before use.
+ */
+void* spsc_ring_slot(SpscRing* ring, int i);
+
+/**
+ * @brief Producer: waits for a free slot and returns it.
+ * @param cancel Optional flag; if it becomes true while waiting, NULL is returned.
+ */
+void* spsc_ring_begin_push(SpscRing* ring, const atomic_bool* cancel);
+
+/**
+ * @brief Producer: publishes the slot returned by spsc_ring_begin_push.
+ */
+void spsc_ring_end_push(SpscRing* ring);
+
+/**
+ * @brief Consumer: waits for a published slot and returns it (oldest first).
+ */
+void* spsc_ring_begin_pop(SpscRing* ring);
+
+/**
+ * @brief Consumer: frees the slot returned by spsc_ring_begin_pop for the producer.
+ */
+void spsc_ring_end_pop(SpscRing* ring);
+
+#endif // SPSC_RING_H
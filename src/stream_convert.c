@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream_reader.h"
+
+// --- CSV/TSV to Binary Stream Converter ---
+
+#define DEFAULT_BLOCK_ROWS 1 // Row-major records: process_stream reads each with one memcpy
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s <input.csv|input.tsv|-> <output%s> [options]\n"
+            "  --float32          Store values as float32 (default float64)\n"
+            "  --block-rows N     Store column blocks of N rows (default %d = row records)\n",
+            program, BINARY_STREAM_EXTENSION, DEFAULT_BLOCK_ROWS);
+}
+
+/**
+ * @brief Writes one block of rows (held row-major in rows) column-major to out.
+ * @return true on success.
+ */
+static bool write_block(FILE* out, const double* rows, int rows_in_block, int num_features, StreamDType dtype) {
+    for (int j = 0; j < num_features; j++) {
+        for (int r = 0; r < rows_in_block; r++) {
+            double value = rows[(size_t)r * num_features + j];
+            size_t written;
+            if (dtype == STREAM_DTYPE_FLOAT32) {
+                float narrowed = (float)value;
+                written = fwrite(&narrowed, sizeof(narrowed), 1, out);
+            } else {
+                written = fwrite(&value, sizeof(value), 1, out);
+            }
+            if (written != 1) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* input_path = NULL;
+    const char* output_path = NULL;
+    StreamDType dtype = STREAM_DTYPE_FLOAT64;
+    long block_rows = DEFAULT_BLOCK_ROWS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--float32") == 0) {
+            dtype = STREAM_DTYPE_FLOAT32;
+        } else if (strcmp(argv[i], "--block-rows") == 0 && i + 1 < argc) {
+            block_rows = strtol(argv[++i], NULL, 10);
+        } else if (input_path == NULL) {
+            input_path = argv[i];
+        } else if (output_path == NULL) {
+            output_path = argv[i];
+        } else {
+            input_path = NULL;
+            break;
+        }
+    }
+    if (input_path == NULL || output_path == NULL || block_rows < 1 || block_rows > (1 << 20)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // 1. Open the text input; its header supplies the feature count and names
+    StreamReader* reader = stream_reader_open(input_path);
+    if (reader == NULL) {
+        return EXIT_FAILURE;
+    }
+    if (reader->binary || reader->header_columns == 0) {
+        fprintf(stderr, "Error: '%s' is not a delimited text stream.\n", input_path);
+        stream_reader_close(reader);
+        return EXIT_FAILURE;
+    }
+    int num_features = reader->header_columns;
+
+    FILE* out = fopen(output_path, "wb");
+    double* rows = (double*)malloc(sizeof(double) * (size_t)block_rows * (size_t)num_features);
+    if (out == NULL || rows == NULL) {
+        perror("Error opening output");
+        free(rows);
+        if (out != NULL) fclose(out);
+        stream_reader_close(reader);
+        return EXIT_FAILURE;
+    }
+
+    // 2. Header and names; num_records is patched in once the input is consumed
+    BinaryStreamHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_STREAM_MAGIC, sizeof(header.magic));
+    header.version = BINARY_STREAM_VERSION;
+    header.num_features = (uint32_t)num_features;
+    header.dtype = (uint32_t)dtype;
+    header.block_rows = (uint32_t)block_rows;
+    for (int j = 0; j < num_features; j++) {
+        header.names_size += (uint32_t)strlen(reader->column_names[j]) + 1;
+    }
+    header.data_offset = (uint32_t)((sizeof(header) + header.names_size + 7) & ~(size_t)7);
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (int j = 0; ok && j < num_features; j++) {
+        ok = fwrite(reader->column_names[j], strlen(reader->column_names[j]) + 1, 1, out) == 1;
+    }
+    static const char padding[8] = {0};
+    size_t padding_size = header.data_offset - (sizeof(header) + header.names_size);
+    if (ok && padding_size > 0) {
+        ok = fwrite(padding, padding_size, 1, out) == 1;
+    }
+
+    // 3. Records, buffered one block at a time; malformed lines are reported and skipped
+    long skipped = 0;
+    int buffered = 0;
+    while (ok) {
+        ReadStatus status = stream_reader_next(reader, rows + (size_t)buffered * num_features, num_features);
+        if (status == READ_EOF) {
+            break;
+        }
+        if (status == READ_ERROR) {
+            skipped++;
+            continue;
+        }
+        header.num_records++;
+        if (++buffered == block_rows) {
+            ok = write_block(out, rows, buffered, num_features, dtype);
+            buffered = 0;
+        }
+    }
+    if (ok && buffered > 0) {
+        ok = write_block(out, rows, buffered, num_features, dtype);
+    }
+
+    // 4. Patch the record count into the header
+    if (ok) {
+        ok = fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    }
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    free(rows);
+    stream_reader_close(reader);
+
+    if (!ok) {
+        perror("Error writing binary stream");
+        remove(output_path);
+        return EXIT_FAILURE;
+    }
+    printf("Converted %llu records x %d features (%s, %ld rows per block) to %s",
+           (unsigned long long)header.num_records, num_features,
+           (dtype == STREAM_DTYPE_FLOAT32) ? "float32" : "float64", block_rows, output_path);
+    if (skipped > 0) {
+        printf(" (%ld malformed lines skipped)", skipped);
+    }
+    printf("\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,381 @@
+#include "stream_engine.h"
+#include "stream_manager.h"
+#include "iforest.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Drift detector parameters of every stream (as in process_stream)
+#define STREAM_ADWIN_CAPACITY 512
+#define STREAM_ADWIN_DELTA 0.02
+#define STREAM_KSWIN_CAPACITY 200
+#define STREAM_KSWIN_RECENT 50
+#define STREAM_KSWIN_ALPHA 0.05
+
+#define INITIAL_TABLE_SIZE 64 // Routing table slots (a power of two, kept at most half full)
+
+struct StreamEngine {
+    IForestConfig config;
+    struct ThreadPool* pool;    // Not owned
+
+    StreamContext* streams;     // In order of first appearance
+    int num_streams;
+    int streams_capacity;
+
+    int* table;                 // Open addressing: stream index, or -1 for an empty slot
+    int table_size;
+
+    // Routing of the current batch
+    int* record_streams;        // Stream of each record
+    int* order;                 // Record indices grouped by stream, batch order within a stream
+    int batch_capacity;
+    int* active;                // Streams that received records in this batch
+    int active_capacity;
+};
+
+/**
+ * Spreads a key over the routing table (SplitMix64 finalizer).
+ */
+static uint64_t hash_key(uint64_t key) {
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+StreamEngine* stream_engine_create(const IForestConfig* config, struct ThreadPool* pool) {
+    StreamEngine* engine = (StreamEngine*)calloc(1, sizeof(StreamEngine));
+    if (engine == NULL) {
+        perror("Error: Memory allocation failed for StreamEngine");
+        return NULL;
+    }
+    engine->config = *config;
+    engine->pool = pool;
+    engine->table_size = INITIAL_TABLE_SIZE;
+    engine->table = (int*)malloc(sizeof(int) * (size_t)engine->table_size);
+    if (engine->table == NULL) {
+        perror("Error: Memory allocation failed for StreamEngine routing table");
+        free(engine);
+        return NULL;
+    }
+    for (int i = 0; i < engine->table_size; i++) {
+        engine->table[i] = -1;
+    }
+    return engine;
+}
+
+static void free_stream(StreamContext* stream) {
+    destroy_sliding_window(stream->sw);
+    free_forest(stream->forest);
+    adwin_destroy(stream->adwin);
+    kswin_destroy(stream->kswin);
+}
+
+void stream_engine_destroy(StreamEngine* engine) {
+    if (engine == NULL) {
+        return;
+    }
+    for (int i = 0; i < engine->num_streams; i++) {
+        free_stream(&engine->streams[i]);
+    }
+    free(engine->streams);
+    free(engine->table);
+    free(engine->record_streams);
+    free(engine->order);
+    free(engine->active);
+    free(engine);
+}
+
+// --- Routing ---
+
+/**
+ * Doubles the routing table and reinserts every stream.
+ */
+static bool grow_table(StreamEngine* engine) {
+    int size = engine->table_size * 2;
+    int* table = (int*)malloc(sizeof(int) * (size_t)size);
+    if (table == NULL) {
+        return false;
+    }
+    for (int i = 0; i < size; i++) {
+        table[i] = -1;
+    }
+    for (int s = 0; s < engine->num_streams; s++) {
+        size_t slot = hash_key(engine->streams[s].key) & (size_t)(size - 1);
+        while (table[slot] >= 0) {
+            slot = (slot + 1) & (size_t)(size - 1);
+        }
+        table[slot] = s;
+    }
+    free(engine->table);
+    engine->table = table;
+    engine->table_size = size;
+    return true;
+}
+
+/**
+ * Creates the state of a new key: window and detectors now, forest once the window fills.
+ */
+static int add_stream(StreamEngine* engine, uint64_t key) {
+    if ((engine->num_streams + 1) * 2 > engine->table_size && !grow_table(engine)) {
+        return -1;
+    }
+    if (engine->num_streams == engine->streams_capacity) {
+        int capacity = (engine->streams_capacity > 0) ? engine->streams_capacity * 2 : 16;
+        StreamContext* streams = (StreamContext*)realloc(engine->streams, sizeof(StreamContext) * (size_t)capacity);
+        if (streams == NULL) {
+            return -1;
+        }
+        engine->streams = streams;
+        engine->streams_capacity = capacity;
+    }
+
+    StreamContext* stream = &engine->streams[engine->num_streams];
+    memset(stream, 0, sizeof(*stream));
+    stream->key = key;
+    stream->sw = create_sliding_window(&engine->config);
+    stream->adwin = adwin_create(STREAM_ADWIN_CAPACITY, STREAM_ADWIN_DELTA);
+    stream->kswin = kswin_create(STREAM_KSWIN_CAPACITY, STREAM_KSWIN_RECENT, STREAM_KSWIN_ALPHA);
+    if (stream->sw == NULL || stream->adwin == NULL || stream->kswin == NULL) {
+        free_stream(stream);
+        return -1;
+    }
+    // Drawn on the routing thread: the global generator is not used inside tasks
+    stream->seed = get_random_seed();
+
+    size_t slot = hash_key(key) & (size_t)(engine->table_size - 1);
+    while (engine->table[slot] >= 0) {
+        slot = (slot + 1) & (size_t)(engine->table_size - 1);
+    }
+    engine->table[slot] = engine->num_streams;
+    return engine->num_streams++;
+}
+
+static int find_or_add_stream(StreamEngine* engine, uint64_t key) {
+    size_t slot = hash_key(key) & (size_t)(engine->table_size - 1);
+    while (engine->table[slot] >= 0) {
+        int s = engine->table[slot];
+        if (engine->streams[s].key == key) {
+            return s;
+        }
+        slot = (slot + 1) & (size_t)(engine->table_size - 1);
+    }
+    return add_stream(engine, key);
+}
+
+static bool reserve_batch(StreamEngine* engine, int n) {
+    if (n > engine->batch_capacity) {
+        int* record_streams = (int*)realloc(engine->record_streams, sizeof(int) * (size_t)n);
+        if (record_streams == NULL) return false;
+        engine->record_streams = record_streams;
+        int* order = (int*)realloc(engine->order, sizeof(int) * (size_t)n);
+        if (order == NULL) return false;
+        engine->order = order;
+        engine->batch_capacity = n;
+    }
+    if (engine->num_streams + n > engine->active_capacity) {
+        // At most every existing stream plus one new stream per record can be active
+        int capacity = engine->num_streams + n;
+        int* active = (int*)realloc(engine->active, sizeof(int) * (size_t)capacity);
+        if (active == NULL) return false;
+        engine->active = active;
+        engine->active_capacity = capacity;
+    }
+    return true;
+}
+
+// --- Per-Stream Processing ---
+
+/**
+ * Trains the stream's forest on its full window and rebuilds the score cache.
+ */
+static void retrain_stream(StreamContext* stream, const IForestConfig* config) {
+    if (stream->forest == NULL) {
+        stream->forest = create_forest(config);
+        if (stream->forest == NULL) {
+            return; // Retried when the next record arrives
+        }
+    }
+    // Serial build: the stream already runs on one of the pool's workers
+    uint64_t seed = stream->seed ^ ((uint64_t)stream->retrains * 0x9E3779B97F4A7C15ULL);
+    METRICS_TIMER(train_timer);
+    train_iforest_seeded(stream->forest, &stream->sw->columns, stream->sw->capacity, seed);
+    METRICS_STOP(STAGE_TRAIN, train_timer);
+    METRICS_COUNT(COUNTER_RETRAINS);
+    rescore_window(stream->forest, stream->sw);
+    stream->retrains++;
+}
+
+static void process_record(StreamContext* stream, const IForestConfig* config, const DataPoint* point,
+                           StreamRecordResult* result) {
+    SlidingWindow* sw = stream->sw;
+    int slot = slide_window(sw, point);
+    result->point = stream->points++;
+    result->scored = false;
+    result->score = 0.0;
+    result->drift = false;
+
+    if (!forest_is_trained(stream->forest)) {
+        if (sw->current_size == sw->capacity) {
+            retrain_stream(stream, config);
+        }
+        return;
+    }
+
+    double score = score_window_slot(stream->forest, sw, slot);
+    METRICS_COUNT(COUNTER_POINTS);
+    result->scored = true;
+    result->score = score;
+    if (score >= sw->anomaly_threshold) {
+        stream->anomalies++;
+    }
+
+    adwin_add(stream->adwin, score);
+    bool drift_adwin = adwin_detect_change(stream->adwin);
+    kswin_add(stream->kswin, score);
+    bool drift_ks = kswin_detect_change(stream->kswin);
+    bool drift_u = evaluate_window_anomaly_rate(sw) > config->desired_anomaly_rate_u;
+    if (drift_adwin) METRICS_COUNT(COUNTER_DRIFT_ADWIN);
+    if (drift_ks)    METRICS_COUNT(COUNTER_DRIFT_KSWIN);
+    if (drift_u)     METRICS_COUNT(COUNTER_DRIFT_U_RULE);
+
+    if (drift_adwin || drift_ks || drift_u) {
+        result->drift = true;
+        retrain_stream(stream, config);
+        adwin_destroy(stream->adwin);
+        kswin_destroy(stream->kswin);
+        stream->adwin = adwin_create(STREAM_ADWIN_CAPACITY, STREAM_ADWIN_DELTA);
+        stream->kswin = kswin_create(STREAM_KSWIN_CAPACITY, STREAM_KSWIN_RECENT, STREAM_KSWIN_ALPHA);
+    }
+}
+
+/**
+ * Shared, read-only state of one batch.
+ */
+typedef struct {
+    StreamEngine* engine;
+    const DataPoint* points;
+    StreamRecordResult* results;
+} BatchJob;
+
+/**
+ * Thread pool task: runs one active stream's records of the batch, in order.
+ */
+static void stream_task(void* ctx, int task_index, int worker_index) {
+    (void)worker_index;
+    BatchJob* job = (BatchJob*)ctx;
+    StreamEngine* engine = job->engine;
+    StreamContext* stream = &engine->streams[engine->active[task_index]];
+    const int* records = engine->order + stream->batch_first;
+    for (int i = 0; i < stream->batch_count; i++) {
+        int r = records[i];
+        job->results[r].stream = engine->active[task_index];
+        process_record(stream, &engine->config, &job->points[r], &job->results[r]);
+    }
+}
+
+int stream_engine_process(StreamEngine* engine, const uint64_t* keys, const DataPoint* points, int n,
+                          StreamRecordResult* results) {
+    if (n <= 0) return 0;
+    if (!reserve_batch(engine, n)) {
+        perror("Error: Memory allocation failed for StreamEngine batch");
+        return -1;
+    }
+
+    // 1. Route: look up (or create) each record's stream and count its records
+    int num_active = 0;
+    for (int i = 0; i < n; i++) {
+        int s = find_or_add_stream(engine, keys[i]);
+        if (s < 0) {
+            fprintf(stderr, "Error: could not allocate stream %llu\n", (unsigned long long)keys[i]);
+            for (int a = 0; a < num_active; a++) engine->streams[engine->active[a]].batch_count = 0;
+            return -1;
+        }
+        engine->record_streams[i] = s;
+        if (engine->streams[s].batch_count++ == 0) {
+            engine->active[num_active++] = s;
+        }
+    }
+
+    // 2. Group the records by stream (a counting sort that keeps batch order)
+    int first = 0;
+    for (int a = 0; a < num_active; a++) {
+        StreamContext* stream = &engine->streams[engine->active[a]];
+        stream->batch_first = first;
+        first += stream->batch_count;
+        stream->batch_count = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        StreamContext* stream = &engine->streams[engine->record_streams[i]];
+        engine->order[stream->batch_first + stream->batch_count++] = i;
+    }
+
+    // 3. One task per active stream on the shared pool
+    BatchJob job = { engine, points, results };
+    thread_pool_run(engine->pool, num_active, stream_task, &job);
+
+    for (int a = 0; a < num_active; a++) {
+        engine->streams[engine->active[a]].batch_count = 0;
+    }
+    return n;
+}
+
+// --- Introspection ---
+
+int stream_engine_num_streams(const StreamEngine* engine) {
+    return engine->num_streams;
+}
+
+const StreamContext* stream_engine_stream(const StreamEngine* engine, int index) {
+    return &engine->streams[index];
+}
+
+size_t stream_context_bytes(const StreamContext* stream) {
+    size_t bytes = sizeof(StreamContext);
+    const SlidingWindow* sw = stream->sw;
+    if (sw != NULL) {
+        bytes += sizeof(SlidingWindow)
+               + sizeof(feature_t) * ((size_t)sw->capacity + 1) * (size_t)sw->num_features // data
+               + sizeof(DataPoint) * (size_t)sw->capacity                                  // buffer
+               + sizeof(feature_t) * (size_t)sw->capacity * (size_t)sw->num_features       // column_data
+               + 4 * sizeof(double) * (size_t)sw->capacity;                                // scores, path_sums, update_sums
+    }
+    const IsolationForest* forest = stream->forest;
+    if (forest != NULL) {
+        bytes += sizeof(IsolationForest)
+               + sizeof(ITree) * (size_t)forest->num_trees
+               + sizeof(Node) * (size_t)forest->nodes_per_tree * (size_t)forest->num_trees
+               + sizeof(int) * forest->train_scratch_size
+               + (2 * sizeof(long) + sizeof(int)) * (size_t)forest->num_trees; // tree_ages, update_trees
+    }
+    if (stream->adwin != NULL) {
+        bytes += sizeof(ADWIN);
+    }
+    if (stream->kswin != NULL) {
+        bytes += sizeof(KSWIN)
+               + sizeof(double) * 2 * (size_t)stream->kswin->r
+               + sizeof(KswinNode) * (2 * (size_t)stream->kswin->r + 1);
+    }
+    return bytes;
+}
+
+StreamEngineStats stream_engine_stats(const StreamEngine* engine) {
+    StreamEngineStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.streams = engine->num_streams;
+    for (int i = 0; i < engine->num_streams; i++) {
+        const StreamContext* stream = &engine->streams[i];
+        stats.points += stream->points;
+        stats.retrains += stream->retrains;
+        stats.anomalies += stream->anomalies;
+        stats.stream_bytes += stream_context_bytes(stream);
+    }
+    stats.engine_bytes = sizeof(StreamEngine)
+                       + sizeof(StreamContext) * (size_t)(engine->streams_capacity - engine->num_streams)
+                       + sizeof(int) * (size_t)engine->table_size
+                       + 2 * sizeof(int) * (size_t)engine->batch_capacity
+                       + sizeof(int) * (size_t)engine->active_capacity;
+    return stats;
+}
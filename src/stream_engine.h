@@ -0,0 +1,114 @@
+#ifndef STREAM_ENGINE_H
+#define STREAM_ENGINE_H
+
+#include "core_ds.h" // For IsolationForest, SlidingWindow, DataPoint, IForestConfig
+#include "adwin.h"
+#include "kswin.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct ThreadPool; // Defined in thread_pool.h
+
+// --- Multi-Stream Engine ---
+// Hosts many independent keyed streams (cards, hosts, ...) in one process. Every key
+// gets its own window, forest and drift detectors, created on its first record. Records
+// are processed in batches: the batch is routed by key on the calling thread, then each
+// stream that received records runs them, in arrival order, as one task on the shared
+// worker pool. Streams never share mutable state, so no locks are taken while scoring.
+
+/**
+ * @brief Per-key detector state: IForestASD with ADWIN, KSWIN and the u-rule, as in
+ * process_stream, retraining the whole forest (serially, on the stream's task) on drift.
+ */
+typedef struct {
+    uint64_t key;
+    SlidingWindow* sw;
+    IsolationForest* forest; // Allocated when the first window fills (NULL until then)
+    ADWIN* adwin;
+    KSWIN* kswin;
+    uint64_t seed;           // Base seed of the stream's retrains
+    long points;             // Records received
+    long retrains;           // Full trainings, the initial one included
+    long anomalies;          // Records scored at or above the threshold
+    int batch_first;         // Position of the stream's first record in the routed batch
+    int batch_count;         // Records of the current batch routed to the stream
+} StreamContext;
+
+/**
+ * @brief Outcome of one record.
+ */
+typedef struct {
+    int stream;      // Index of the record's stream (see stream_engine_stream)
+    long point;      // 0-based position of the record within its stream
+    bool scored;     // false while the stream's first window is filling
+    double score;    // s(x) under the stream's model (if scored)
+    bool drift;      // The record triggered a retrain of its stream
+} StreamRecordResult;
+
+typedef struct StreamEngine StreamEngine;
+
+/**
+ * @brief Creates an empty engine.
+ * @param config Dimensions and thresholds shared by every stream. Per-stream memory is
+ * dominated by T x (2^(ceil(log2 ψ)+1) - 1) tree nodes of sizeof(Node) bytes and about
+ * 2 x W x D window values: at the defaults (T=100, ψ=256, W=256) and D=29 that is
+ * 100 x 511 x 16 B = 798 KiB of nodes plus 116 KiB of window, about 940 KiB per key
+ * (0.9 GiB for a thousand keys). Every stream shares config, so keyed deployments
+ * size their per-key state with it: T=25 and ψ=64 (25 x 127 nodes, 50 KiB) with
+ * W=128 bring a key to about 125 KiB, and FLOAT32 builds halve nodes and window.
+ * @param pool Worker pool the streams run on (not owned; NULL runs them serially).
+ * @return The engine, or NULL on failure.
+ */
+StreamEngine* stream_engine_create(const IForestConfig* config, struct ThreadPool* pool);
+
+/**
+ * @brief Frees the engine and every stream it hosts.
+ */
+void stream_engine_destroy(StreamEngine* engine);
+
+/**
+ * @brief Processes a batch of keyed records.
+ * Records of one key are applied in batch order; different keys run in parallel.
+ * The points are read during the call only.
+ * @param engine The engine.
+ * @param keys The stream key of each record.
+ * @param points The record features (D values each).
+ * @param n The number of records.
+ * @param results Receives the outcome of each record (n entries, batch order).
+ * @return The number of records processed (n), or -1 if a new stream could not be allocated.
+ */
+int stream_engine_process(StreamEngine* engine, const uint64_t* keys, const DataPoint* points, int n,
+                          StreamRecordResult* results);
+
+/**
+ * @brief Returns the number of streams created so far.
+ */
+int stream_engine_num_streams(const StreamEngine* engine);
+
+/**
+ * @brief Returns a stream by index (in order of first appearance); valid until the next
+ * stream_engine_process call.
+ */
+const StreamContext* stream_engine_stream(const StreamEngine* engine, int index);
+
+/**
+ * @brief Bytes held by one stream: window, score cache, forest (once trained) and detectors.
+ */
+size_t stream_context_bytes(const StreamContext* stream);
+
+/**
+ * @brief Totals over all streams.
+ */
+typedef struct {
+    int streams;
+    long points;
+    long retrains;
+    long anomalies;
+    size_t stream_bytes;  // Sum of stream_context_bytes
+    size_t engine_bytes;  // Routing table and batch buffers
+} StreamEngineStats;
+
+StreamEngineStats stream_engine_stats(const StreamEngine* engine);
+
+#endif // STREAM_ENGINE_H
@@ -1,198 +1,871 @@
+#define _POSIX_C_SOURCE 200809L // For clock_gettime
+
 #include "adwin.h"
 #include "kswin.h"
 #include "stream_manager.h"
 #include "core_ds.h"
 #include "iforest.h"
 #include "utils.h"
+#include "stream_reader.h"
+#include "score_kernels.h"
+#include "async_trainer.h"
+#include "metrics.h"
+#include "stream_engine.h"
+#include "spsc_ring.h"
+#include "result_sink.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
-#define MAX_LINE_BUFFER 4096
+#define OFFLINE_BATCH_SIZE 256 // Points read and scored together in offline mode
+#define RESCORE_BLOCK_SIZE 64   // Window slots walked through each tree together when rescoring
+#define KEYED_BATCH_SIZE 4096   // Keyed records routed and scored together
+#define PIPELINE_INPUT_SLOTS 1024 // Parsed points in flight between the reader and scorer stages
 
-static FILE* stream_file = NULL;
-static bool header_skipped = false;
+static StreamReader* stream_reader = NULL;
+static int stream_num_features = DEFAULT_NUM_FEATURES; // Values parsed per data line
 
 bool open_stream(const char* filename) {
-    stream_file = fopen(filename, "r");  // TEXT MODE, NOT "rb"
-    if (stream_file == NULL) {
-        perror("Error opening data stream file");
-        return false;
-    }
-    header_skipped = false;
-    return true;
+    stream_reader = stream_reader_open(filename);
+    return stream_reader != NULL;
+}
+
+int stream_header_columns() {
+    return (stream_reader != NULL) ? stream_reader->header_columns : 0;
+}
+
+void set_stream_num_features(int num_features) {
+    stream_num_features = num_features;
 }
 
 void close_stream() {
-    if (stream_file != NULL) {
-        fclose(stream_file);
-        stream_file = NULL;
-    }
+    stream_reader_close(stream_reader);
+    stream_reader = NULL;
 }
 
-DataPoint get_next_point_from_stream() {
-    DataPoint point;
-    char line_buffer[MAX_LINE_BUFFER];
-    point.features[0] = NAN;
-    
-    if (stream_file == NULL) {
+/**
+ * True while count is below a record limit (a limit of 0 or less means no limit).
+ */
+static inline bool below_limit(long count, long limit) {
+    return limit <= 0 || count < limit;
+}
+
+/**
+ * Parses the next record straight into feature storage (see feature_t).
+ */
+static inline ReadStatus read_features(feature_t* features, int num_features) {
+#ifdef IFOREST_FLOAT32
+    return stream_reader_next_float(stream_reader, features, num_features);
+#else
+    return stream_reader_next(stream_reader, features, num_features);
+#endif
+}
+
+ReadStatus get_next_point_from_stream(DataPoint* point) {
+    if (stream_reader == NULL) {
         fprintf(stderr, "Error: Stream file not open.\n");
-        return point;
+        return READ_EOF;
     }
     
-    // SKIP HEADER ON FIRST CALL
-    if (!header_skipped) {
-        if (fgets(line_buffer, MAX_LINE_BUFFER, stream_file) == NULL) {
-            fprintf(stderr, "Error: Could not read header line.\n");
-            return point;
-        }
-        fprintf(stderr, "Header skipped: %s", line_buffer);
-        header_skipped = true;
+    // Parse straight into the destination (the reader reports errors with their line number)
+    ReadStatus status = read_features(point->features, stream_num_features);
+    if (status == READ_ERROR) {
+        METRICS_COUNT(COUNTER_PARSE_FAILURES);
     }
-    
-    // READ DATA LINE
-    if (fgets(line_buffer, MAX_LINE_BUFFER, stream_file) == NULL) {
-        point.features[0] = NAN;
-        return point;
+    return status;
+}
+
+/**
+ * True if a record read with this status carries a point to process: parse errors
+ * (already reported) and points without a leading value (NaN) are skipped.
+ */
+static inline bool is_usable_point(ReadStatus status, const DataPoint* point) {
+    return status == READ_OK && !isnan(point->features[0]);
+}
+
+DataPoint* window_staging_point(SlidingWindow* sw) {
+    return &sw->staging;
+}
+
+int slide_window(SlidingWindow* sw, const DataPoint* new_point) {
+    int slot = sw->tail;
+    if (sw->current_size == sw->capacity) {
+        // The evicted point no longer counts towards the window anomaly rate
+        set_window_score(sw, slot, 0.0);
     }
-    
-    // REPLACE COMMAS WITH SPACES
-    for (int i = 0; line_buffer[i] != '\0'; i++) {
-        if (line_buffer[i] == ',') {
-            line_buffer[i] = ' ';
-        }
+    if (new_point->features == sw->staging.features) {
+        // Zero-copy insert: the staged row becomes the slot, the evicted row the new spare
+        feature_t* evicted = sw->buffer[slot].features;
+        sw->buffer[slot].features = sw->staging.features;
+        sw->staging.features = evicted;
+    } else {
+        memcpy(sw->buffer[slot].features, new_point->features, sizeof(feature_t) * (size_t)sw->num_features);
     }
-    
-    // PARSE 29 VALUES
-    int success_count = sscanf(line_buffer,
-        "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf"
-        "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf"
-        "%lf %lf %lf %lf %lf %lf %lf %lf %lf",
-        &point.features[0], &point.features[1], &point.features[2], &point.features[3], &point.features[4],
-        &point.features[5], &point.features[6], &point.features[7], &point.features[8], &point.features[9],
-        &point.features[10], &point.features[11], &point.features[12], &point.features[13], &point.features[14],
-        &point.features[15], &point.features[16], &point.features[17], &point.features[18], &point.features[19],
-        &point.features[20], &point.features[21], &point.features[22], &point.features[23], &point.features[24],
-        &point.features[25], &point.features[26], &point.features[27], &point.features[28]
-    );
-    
-    if (success_count != NUM_FEATURES) {
-        fprintf(stderr, "Parse Error: Expected %d features, got %d.\n", NUM_FEATURES, success_count);
-        point.features[0] = NAN;
-        return point;
+    // Keep the training columns in step with the rows
+    const feature_t* row = sw->buffer[slot].features;
+    for (int d = 0; d < sw->num_features; d++) {
+        sw->column_data[(size_t)d * sw->capacity + slot] = row[d];
     }
-    
-    return point;
-}
-
-void slide_window(SlidingWindow* sw, DataPoint new_point) {
-    sw->buffer[sw->tail] = new_point;
-    sw->tail = (sw->tail + 1) % WINDOW_SIZE;
-    if (sw->current_size < WINDOW_SIZE) {
+    sw->tail = (sw->tail + 1) % sw->capacity;
+    sw->total_inserted++;
+    if (sw->current_size < sw->capacity) {
         sw->current_size++;
     } else {
         sw->head = sw->tail;
     }
+    return slot;
+}
+
+void set_window_score(SlidingWindow* sw, int slot, double score) {
+    if (sw->scores[slot] >= sw->anomaly_threshold) sw->anomaly_count--;
+    if (score >= sw->anomaly_threshold) sw->anomaly_count++;
+    sw->scores[slot] = score;
 }
 
-double evaluate_window_anomaly_rate(IsolationForest* forest, SlidingWindow* sw) {
-    if (sw->current_size < WINDOW_SIZE) return 0.0;
-    int anomaly_count = 0;
-    for (int i = 0; i < WINDOW_SIZE; i++) {
-        double score = calculate_score(forest, sw->buffer[i], SAMPLE_SIZE);
-        if (score >= ANOMALY_THRESHOLD) {
-            anomaly_count++;
+double score_window_slot(const IsolationForest* forest, SlidingWindow* sw, int slot) {
+    double total_path_length = forest_path_length_sum(forest, &sw->buffer[slot]);
+    double score = score_from_path_length_sum(forest, total_path_length, forest->sample_size);
+    sw->path_sums[slot] = total_path_length;
+    set_window_score(sw, slot, score);
+    return score;
+}
+
+/**
+ * Recomputes every cached score from the cached path-length sums.
+ */
+static void refresh_window_scores(const IsolationForest* forest, SlidingWindow* sw) {
+    sw->anomaly_count = 0;
+    for (int i = 0; i < sw->current_size; i++) {
+        sw->scores[i] = score_from_path_length_sum(forest, sw->path_sums[i], forest->sample_size);
+        if (sw->scores[i] >= sw->anomaly_threshold) {
+            sw->anomaly_count++;
         }
     }
-    return (double)anomaly_count / (double)WINDOW_SIZE;
 }
 
-void process_stream(IsolationForest* forest, SlidingWindow* sw, double desired_u, int max_iterations) {
-    int iteration = 0;
-    int points_processed = 0;
+void rescore_window(const IsolationForest* forest, SlidingWindow* sw) {
+    // Tree-major over blocks of slots, summing trees in order (as calculate_score_batch does)
+    for (int start = 0; start < sw->current_size; start += RESCORE_BLOCK_SIZE) {
+        int block = (sw->current_size - start < RESCORE_BLOCK_SIZE) ? sw->current_size - start : RESCORE_BLOCK_SIZE;
+        double* sums = sw->path_sums + start;
+        for (int j = 0; j < block; j++) {
+            sums[j] = 0.0;
+        }
+        for (int t = 0; t < forest->num_trees; t++) {
+            accumulate_path_lengths(&forest->trees[t], &sw->buffer[start], block, sums);
+        }
+    }
+    refresh_window_scores(forest, sw);
+}
 
-    // Create drift detectors (parameters can be tuned)
-    ADWIN *adw   = adwin_create(512, 0.02);      // capacity 512, delta 0.02
-    KSWIN *kswin = kswin_create(200, 50, 0.05);  // window 200, recent r=50
+int rolling_update_window(IsolationForest* forest, SlidingWindow* sw, int k) {
+    if (k >= forest->num_trees) {
+        train_iforest(forest, &sw->columns, sw->capacity);
+        rescore_window(forest, sw);
+        return forest->num_trees;
+    }
 
-    printf("--- Waiting to fill initial window (W=%d) for first training ---\n", WINDOW_SIZE);
+    // Workspaces preallocated with the forest (T tree indices) and the window (2 x W sums)
+    int* trees = forest->update_trees;
+    double* old_sums = sw->update_sums;
+    double* new_sums = sw->update_sums + sw->capacity;
+    for (int i = 0; i < sw->current_size; i++) {
+        old_sums[i] = 0.0;
+        new_sums[i] = 0.0;
+    }
 
-    // Fill initial window
-    while (sw->current_size < WINDOW_SIZE && iteration < max_iterations) {
-        DataPoint new_point = get_next_point_from_stream();
-        if (isnan(new_point.features[0])) {
-            iteration++;
+    // 1. Contributions of the trees about to be replaced
+    int count = select_oldest_trees(forest, k, trees);
+    for (int i = 0; i < count; i++) {
+        accumulate_path_lengths(&forest->trees[trees[i]], sw->buffer, sw->current_size, old_sums);
+    }
+
+    // 2. Rebuild them from the current window, then swap their contributions in
+    train_selected_trees(forest, &sw->columns, sw->capacity, trees, count);
+    for (int i = 0; i < count; i++) {
+        accumulate_path_lengths(&forest->trees[trees[i]], sw->buffer, sw->current_size, new_sums);
+    }
+    for (int i = 0; i < sw->current_size; i++) {
+        sw->path_sums[i] = sw->path_sums[i] - old_sums[i] + new_sums[i];
+    }
+    refresh_window_scores(forest, sw);
+    return count;
+}
+
+void adopt_window_scores(const IsolationForest* forest, SlidingWindow* sw,
+                         const double* snapshot_path_sums, long snapshot_inserted) {
+    long changed = sw->total_inserted - snapshot_inserted;
+    if (changed >= sw->current_size) {
+        rescore_window(forest, sw);
+        return;
+    }
+
+    // Unchanged slots take the snapshot's sums; the newest `changed` slots are rescored
+    memcpy(sw->path_sums, snapshot_path_sums, sizeof(double) * (size_t)sw->current_size);
+    int slot = sw->tail;
+    for (long i = 0; i < changed; i++) {
+        slot = (slot == 0) ? sw->capacity - 1 : slot - 1;
+        sw->path_sums[slot] = forest_path_length_sum(forest, &sw->buffer[slot]);
+    }
+    refresh_window_scores(forest, sw);
+}
+
+double evaluate_window_anomaly_rate(const SlidingWindow* sw) {
+    if (sw->current_size < sw->capacity) return 0.0;
+    return (double)sw->anomaly_count / (double)sw->capacity;
+}
+
+// --- Result Output ---
+
+static ResultSink* output_sink = NULL;
+
+bool open_output(const char* path, SinkFormat format, SinkVerbosity verbosity, bool keyed) {
+    close_output();
+    output_sink = result_sink_create(path, format, verbosity, keyed);
+    if (output_sink == NULL) {
+        return false;
+    }
+    static bool registered = false;
+    if (!registered) {
+        atexit(close_output); // Whatever is still buffered is written on any exit path
+        registered = true;
+    }
+    return true;
+}
+
+void close_output() {
+    ResultSink* sink = output_sink;
+    output_sink = NULL;
+    result_sink_close(sink);
+}
+
+/**
+ * Returns the open sink, or opens the default one (every point as text on stdout).
+ */
+static ResultSink* current_output(bool keyed) {
+    if (output_sink == NULL && !open_output(NULL, SINK_FORMAT_TEXT, SINK_VERBOSITY_ALL, keyed)) {
+        return NULL;
+    }
+    return output_sink;
+}
+
+// --- Stream Input Stage ---
+
+/**
+ * An input ring slot: a row the reader parses into, owned by the slot.
+ */
+typedef struct {
+    DataPoint point;
+    ReadStatus status;  // READ_EOF: the stream is exhausted; no slot follows
+} InputSlot;
+
+/**
+ * Where process_stream takes its points from. Sequentially, that is the stream reader
+ * on the scoring thread. As a pipeline, a reader thread parses ahead into the input
+ * ring, so the scorer only scores (output is already written by the sink's own thread).
+ */
+typedef struct {
+    bool pipelined;
+    SpscRing* input;        // Reader -> scorer
+    feature_t* rows;        // Feature rows of the input slots
+    long max_points;        // The reader gives up after this many records (0: at the end of the stream)
+    bool input_ended;       // Scorer side: the end-of-stream slot was consumed
+    atomic_bool stop_reader;
+    pthread_t reader;
+} StreamIO;
+
+static void* reader_stage(void* arg) {
+    StreamIO* io = (StreamIO*)arg;
+    for (long i = 0; !atomic_load_explicit(&io->stop_reader, memory_order_relaxed); i++) {
+        InputSlot* slot = (InputSlot*)spsc_ring_begin_push(io->input, &io->stop_reader);
+        if (slot == NULL) {
+            break; // The scorer finished early
+        }
+        ReadStatus status = below_limit(i, io->max_points)
+                          ? read_features(slot->point.features, stream_num_features)
+                          : READ_EOF;
+        if (status == READ_ERROR) {
+            METRICS_COUNT(COUNTER_PARSE_FAILURES);
+        }
+        slot->status = status;
+        spsc_ring_end_push(io->input);
+        if (status == READ_EOF) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Starts the reader stage when config->pipeline is set.
+ */
+static bool stream_io_start(StreamIO* io, const IForestConfig* config, long max_points) {
+    memset(io, 0, sizeof(*io));
+    if (!config->pipeline) {
+        return true;
+    }
+    io->max_points = max_points;
+    atomic_init(&io->stop_reader, false);
+    io->input = spsc_ring_create(PIPELINE_INPUT_SLOTS, sizeof(InputSlot));
+    int slots = (io->input != NULL) ? spsc_ring_capacity(io->input) : 0;
+    io->rows = (feature_t*)malloc(sizeof(feature_t) * (size_t)slots * (size_t)stream_num_features);
+    if (io->input == NULL || io->rows == NULL) {
+        perror("Error: Memory allocation failed for the stream pipeline");
+        spsc_ring_destroy(io->input);
+        free(io->rows);
+        return false;
+    }
+    for (int i = 0; i < slots; i++) {
+        InputSlot* slot = (InputSlot*)spsc_ring_slot(io->input, i);
+        slot->point.features = io->rows + (size_t)i * stream_num_features;
+    }
+    if (pthread_create(&io->reader, NULL, reader_stage, io) != 0) {
+        perror("Error: could not start the reader stage");
+        spsc_ring_destroy(io->input);
+        free(io->rows);
+        return false;
+    }
+    io->pipelined = true;
+    return true;
+}
+
+/**
+ * Stops and joins the reader (the stream can then be closed).
+ */
+static void stream_io_finish(StreamIO* io) {
+    if (!io->pipelined) {
+        return;
+    }
+    // The reader stops at the end of the stream, or early when told to (even if the ring is full)
+    atomic_store(&io->stop_reader, true);
+    pthread_join(io->reader, NULL);
+    spsc_ring_destroy(io->input);
+    free(io->rows);
+    io->pipelined = false;
+}
+
+/**
+ * Reads the next point into the window's staging row and returns how the read ended
+ * (the row is only valid for READ_OK).
+ */
+static ReadStatus stream_io_next_point(StreamIO* io, SlidingWindow* sw) {
+    DataPoint* staged = window_staging_point(sw);
+    if (!io->pipelined) {
+        return get_next_point_from_stream(staged);
+    }
+    if (io->input_ended) {
+        return READ_EOF;
+    }
+    InputSlot* slot = (InputSlot*)spsc_ring_begin_pop(io->input);
+    ReadStatus status = slot->status;
+    if (status == READ_OK) {
+        memcpy(staged->features, slot->point.features, sizeof(feature_t) * (size_t)sw->num_features);
+    }
+    io->input_ended = (status == READ_EOF);
+    spsc_ring_end_pop(io->input);
+    return status;
+}
+
+/**
+ * Reads points into the window until it is full, counting every read in *iteration and
+ * every inserted point in *points_processed. Returns false (after reporting it and
+ * closing the input) if the stream ends first.
+ */
+static bool fill_initial_window(StreamIO* io, SlidingWindow* sw, ResultSink* out, long max_iterations,
+                                long* iteration, long* points_processed) {
+    while (sw->current_size < sw->capacity && below_limit(*iteration, max_iterations)) {
+        // Points are parsed straight into the window's spare row
+        ReadStatus status = stream_io_next_point(io, sw);
+        (*iteration)++;
+        if (status == READ_EOF) {
+            break;
+        }
+        DataPoint* new_point = window_staging_point(sw);
+        if (!is_usable_point(status, new_point)) {
             continue;
         }
         slide_window(sw, new_point);
-        points_processed++;
-        iteration++;
+        (*points_processed)++;
     }
+    if (sw->current_size < sw->capacity) {
+        result_sink_printf(out, "Stream ended before window filled (%d/%d).\n", sw->current_size, sw->capacity);
+        stream_io_finish(io);
+        result_sink_flush(out);
+        close_stream();
+        return false;
+    }
+    return true;
+}
 
-    if (sw->current_size == WINDOW_SIZE) {
-        printf("Window filled with %d points. Initial IForest training...\n", points_processed);
-        train_iforest(forest, sw->buffer, WINDOW_SIZE);
-    } else {
-        printf("Stream ended before window filled (%d/%d).\n", sw->current_size, WINDOW_SIZE);
+void process_stream(IsolationForest* forest, SlidingWindow* sw, const IForestConfig* config, long max_iterations) {
+    long iteration = 0;
+    long points_processed = 0;
+    int points_since_update = 0;
+    double desired_u = config->desired_anomaly_rate_u;
+
+    // Input: direct, or a reader stage ahead of this (scoring) thread; output goes to the sink
+    ResultSink* out = current_output(false);
+    StreamIO io;
+    if (out == NULL || !stream_io_start(&io, config, max_iterations)) {
         close_stream();
-        adwin_destroy(adw);
-        kswin_destroy(kswin);
         return;
     }
 
-    printf("--- Starting Stream Processing ---\n");
+    // Create drift detectors (parameters can be tuned)
+    ADWIN *adw   = adwin_create(512, 0.02);      // capacity 512, delta 0.02
+    KSWIN *kswin = kswin_create(200, 50, 0.05);  // window 200, recent r=50
 
-    while (iteration < max_iterations) {
-        DataPoint new_point = get_next_point_from_stream();
-        if (isnan(new_point.features[0])) {
-            if (points_processed > WINDOW_SIZE) {
-                printf("End of stream reached.\n");
-                break;
-            }
+    if (forest_is_trained(forest)) {
+        // Warm start from a loaded model: score from the first point while the window fills
+        result_sink_printf(out, "--- Model preloaded: scoring from the first point (W=%d) ---\n", sw->capacity);
+    } else {
+        result_sink_printf(out, "--- Waiting to fill initial window (W=%d) for first training ---\n", sw->capacity);
+
+        if (!fill_initial_window(&io, sw, out, max_iterations, &iteration, &points_processed)) {
+            adwin_destroy(adw);
+            kswin_destroy(kswin);
+            return;
+        }
+        result_sink_printf(out, "Window filled with %ld points. Initial IForest training...\n", points_processed);
+        METRICS_TIMER(train_timer);
+        train_iforest(forest, &sw->columns, sw->capacity);
+        METRICS_STOP(STAGE_TRAIN, train_timer);
+        METRICS_COUNT(COUNTER_RETRAINS);
+        METRICS_TIMER(rescore_timer);
+        rescore_window(forest, sw);
+        METRICS_STOP(STAGE_RESCORE, rescore_timer);
+    }
+
+    // Background retraining: the scoring loop reads the model through the trainer
+    AsyncTrainer* trainer = NULL;
+    if (config->async_retrain) {
+        trainer = async_trainer_create(forest, config);
+        if (trainer == NULL) {
+            fprintf(stderr, "Warning: background retraining unavailable, retraining inline.\n");
+        }
+    }
+    const IsolationForest* model = forest;
+
+    result_sink_printf(out, "--- Starting Stream Processing ---\n");
+
+    while (below_limit(iteration, max_iterations)) {
+        METRICS_TIMER(event_timer);
+        METRICS_TIMER(stage_timer);
+        ReadStatus status = stream_io_next_point(&io, sw); // In a pipeline: waiting for the reader
+        DataPoint* new_point = window_staging_point(sw);
+        METRICS_STOP(STAGE_PARSE, stage_timer);
+        if (status == READ_EOF) {
+            result_sink_printf(out, "End of stream reached.\n");
+            break;
+        }
+        if (!is_usable_point(status, new_point)) {
             iteration++;
             continue;
         }
 
-        slide_window(sw, new_point);
+        METRICS_RESTART(stage_timer);
+        int slot = slide_window(sw, new_point);
+        METRICS_STOP(STAGE_SLIDE, stage_timer);
+
+        if (trainer != NULL) {
+            // Pick up a model published by the background build; the trainer has already
+            // scored its snapshot, so only points that arrived since are walked here
+            const IsolationForest* published = async_trainer_read_begin(trainer, 0);
+            if (published != model) {
+                long snapshot_inserted;
+                const double* sums = async_trainer_snapshot_path_sums(trainer, &snapshot_inserted);
+                METRICS_RESTART(stage_timer);
+                adopt_window_scores(published, sw, sums, snapshot_inserted);
+                METRICS_STOP(STAGE_RESCORE, stage_timer);
+                model = published;
 
-        // Score new point
-        double score = calculate_score(forest, new_point, SAMPLE_SIZE);
-        printf("Point %d: Score=%.4f (%s)\n", points_processed, score,
-               (score >= ANOMALY_THRESHOLD) ? "ANOMALY" : "Normal");
+                AsyncTrainerStats stats = async_trainer_stats(trainer);
+                result_sink_printf(out, ">>> MODEL SWAPPED (generation %ld): trigger-to-swap %.2f ms, %d triggers coalesced\n",
+                       model->generation, stats.last_trigger_to_swap_ms, stats.last_coalesced);
+
+                // The new model takes over: restart the detectors on its scores
+                adwin_destroy(adw);
+                kswin_destroy(kswin);
+                adw   = adwin_create(512, 0.02);
+                kswin = kswin_create(200, 50, 0.05);
+            }
+        }
+
+        // Score new point; only this slot's cache entry changes
+        METRICS_RESTART(stage_timer);
+        double score = score_window_slot(model, sw, slot);
+        METRICS_STOP(STAGE_SCORE, stage_timer);
+        METRICS_COUNT(COUNTER_POINTS);
+        result_sink_point(out, 0, points_processed, score, score >= sw->anomaly_threshold);
 
         // Feed score to drift detectors
+        METRICS_RESTART(stage_timer);
         adwin_add(adw, score);
-        kswin_add(kswin, score);
-
         bool drift_adwin = adwin_detect_change(adw);
+        METRICS_STOP(STAGE_ADWIN, stage_timer);
+
+        METRICS_RESTART(stage_timer);
+        kswin_add(kswin, score);
         bool drift_ks    = kswin_detect_change(kswin);
+        METRICS_STOP(STAGE_KSWIN, stage_timer);
 
-        // Optional: still compute anomaly-rate u as in original paper
-        double rate = evaluate_window_anomaly_rate(forest, sw);
+        // Optional: still compute anomaly-rate u as in original paper (O(1) from the score cache)
+        METRICS_RESTART(stage_timer);
+        double rate = evaluate_window_anomaly_rate(sw);
+        METRICS_STOP(STAGE_RATE, stage_timer);
 
-        if (drift_adwin || drift_ks || rate > desired_u) {
-            printf(">>> DRIFT DETECTED by ");
-            if (drift_adwin) printf("ADWIN ");
-            if (drift_ks)    printf("KSWIN ");
-            if (rate > desired_u) printf("(u-rule) ");
-            printf(" — Retraining...\n");
+        // Scheduled rolling updates run every rolling_interval points, drift or not
+        points_since_update++;
+        bool drift = drift_adwin || drift_ks || rate > desired_u;
+        bool scheduled = config->rolling_interval > 0 && points_since_update >= config->rolling_interval;
 
-            train_iforest(forest, sw->buffer, WINDOW_SIZE);
+        // A retrain needs a full window (only relevant after a warm start); triggers that
+        // arrive while a background build is in flight are coalesced into it
+        bool update = (drift || scheduled) && sw->current_size == sw->capacity;
+        if (update && trainer != NULL && !async_trainer_request(trainer, sw)) {
+            update = false;
+        }
+        if (update) {
+            // The status line names the trigger, then the action taken
+            char trigger[64];
+            if (drift) {
+                snprintf(trigger, sizeof(trigger), ">>> DRIFT DETECTED by %s%s%s",
+                         drift_adwin ? "ADWIN " : "", drift_ks ? "KSWIN " : "", (rate > desired_u) ? "(u-rule) " : "");
+                if (drift_adwin) METRICS_COUNT(COUNTER_DRIFT_ADWIN);
+                if (drift_ks)    METRICS_COUNT(COUNTER_DRIFT_KSWIN);
+                if (rate > desired_u) METRICS_COUNT(COUNTER_DRIFT_U_RULE);
+            } else {
+                snprintf(trigger, sizeof(trigger), ">>> SCHEDULED UPDATE ");
+            }
 
-            // Simple reset: recreate detectors after retrain
-            adwin_destroy(adw);
-            kswin_destroy(kswin);
-            adw   = adwin_create(512, 0.02);
-            kswin = kswin_create(200, 50, 0.05);
+            points_since_update = 0;
+            if (trainer != NULL) {
+                // The snapshot was taken; the current model keeps scoring until the swap,
+                // which also resets the detectors
+                result_sink_printf(out, "%s — Retraining in background...\n", trigger);
+            } else {
+                if (config->rolling_trees > 0) {
+                    // Bounded work per event: only the k oldest trees are rebuilt
+                    METRICS_RESTART(stage_timer);
+                    int replaced = rolling_update_window(forest, sw, config->rolling_trees);
+                    METRICS_STOP(STAGE_TRAIN, stage_timer);
+                    METRICS_COUNT(COUNTER_ROLLING_UPDATES);
+                    result_sink_printf(out, "%s — Replacing %d oldest trees (generation %ld)...\n", trigger, replaced, forest->generation);
+                } else {
+                    result_sink_printf(out, "%s — Retraining...\n", trigger);
+                    METRICS_RESTART(stage_timer);
+                    train_iforest(forest, &sw->columns, sw->capacity);
+                    METRICS_STOP(STAGE_TRAIN, stage_timer);
+                    METRICS_COUNT(COUNTER_RETRAINS);
+                    METRICS_RESTART(stage_timer);
+                    rescore_window(forest, sw); // The model changed: the score cache is stale
+                    METRICS_STOP(STAGE_RESCORE, stage_timer);
+                }
+
+                // Simple reset: recreate detectors after retrain
+                adwin_destroy(adw);
+                kswin_destroy(kswin);
+                adw   = adwin_create(512, 0.02);
+                kswin = kswin_create(200, 50, 0.05);
+            }
+        }
+        if (trainer != NULL) {
+            async_trainer_read_end(trainer, 0);
         }
+        METRICS_STOP(STAGE_EVENT, event_timer);
+        METRICS_TICK();
 
         points_processed++;
         iteration++;
     }
 
+    if (trainer != NULL) {
+        // Let an in-flight build finish; the forest is left holding the latest model
+        async_trainer_wait(trainer);
+        AsyncTrainerStats stats = async_trainer_stats(trainer);
+        async_trainer_destroy(trainer);
+        if (stats.swaps > 0) {
+            result_sink_printf(out, "Background retrains: %d swaps, trigger-to-swap mean %.2f ms, max %.2f ms, %d triggers coalesced\n",
+                   stats.swaps, stats.total_trigger_to_swap_ms / stats.swaps, stats.max_trigger_to_swap_ms, stats.coalesced);
+        }
+    }
+
+    result_sink_printf(out, "Total points processed: %ld\n", points_processed);
+    stream_io_finish(&io);
+    result_sink_flush(out); // Later stdout output (the caller's) follows ours
     close_stream();
     adwin_destroy(adw);
     kswin_destroy(kswin);
-    printf("Total points processed: %d\n", points_processed);
-}
\ No newline at end of file
+}
+void process_hst_stream(HalfSpaceForest* forest, SlidingWindow* sw, const IForestConfig* config, long max_iterations) {
+    long iteration = 0;
+    long points_processed = 0;
+
+    ResultSink* out = current_output(false);
+    StreamIO io;
+    if (out == NULL || !stream_io_start(&io, config, max_iterations)) {
+        close_stream();
+        return;
+    }
+
+    result_sink_printf(out, "--- Waiting to fill initial window (W=%d) for the Half-Space Trees' work space ---\n", sw->capacity);
+    if (!fill_initial_window(&io, sw, out, max_iterations, &iteration, &points_processed)) {
+        return;
+    }
+
+    // The only batch step: the window's ranges fix the splits, its points the first masses
+    result_sink_printf(out, "Window filled with %ld points. Building %d Half-Space Trees of depth %d...\n",
+                       points_processed, forest->num_trees, forest->depth);
+    METRICS_TIMER(train_timer);
+    hst_build(forest, sw->buffer, sw->capacity, get_random_seed());
+    METRICS_STOP(STAGE_TRAIN, train_timer);
+
+    result_sink_printf(out, "--- Starting Stream Processing (mass windows of %d points, no retraining) ---\n", forest->window_size);
+
+    while (below_limit(iteration, max_iterations)) {
+        METRICS_TIMER(event_timer);
+        METRICS_TIMER(stage_timer);
+        ReadStatus status = stream_io_next_point(&io, sw);
+        DataPoint* new_point = window_staging_point(sw);
+        METRICS_STOP(STAGE_PARSE, stage_timer);
+        if (status == READ_EOF) {
+            result_sink_printf(out, "End of stream reached.\n");
+            break;
+        }
+        if (!is_usable_point(status, new_point)) {
+            iteration++;
+            continue;
+        }
+
+        // Scoring and the model update are one walk per tree
+        METRICS_RESTART(stage_timer);
+        double score = hst_score_and_update(forest, new_point);
+        METRICS_STOP(STAGE_SCORE, stage_timer);
+        METRICS_COUNT(COUNTER_POINTS);
+        result_sink_point(out, 0, points_processed, score, score >= config->anomaly_threshold);
+        METRICS_STOP(STAGE_EVENT, event_timer);
+        METRICS_TICK();
+
+        points_processed++;
+        iteration++;
+    }
+
+    result_sink_printf(out, "Total points processed: %ld\n", points_processed);
+    stream_io_finish(&io);
+    result_sink_flush(out);
+    close_stream();
+}
+
+void score_stream_offline(IsolationForest* forest, SlidingWindow* sw, long max_iterations) {
+    long iteration = 0;
+    long points_processed = 0;
+
+    // Batch buffers: OFFLINE_BATCH_SIZE rows of features, their views, scores and decisions
+    feature_t* batch_data = (feature_t*)malloc(sizeof(feature_t) * OFFLINE_BATCH_SIZE * (size_t)sw->num_features);
+    DataPoint* batch = (DataPoint*)malloc(sizeof(DataPoint) * OFFLINE_BATCH_SIZE);
+    double* scores = (double*)malloc(sizeof(double) * OFFLINE_BATCH_SIZE);
+    bool* anomalies = (bool*)malloc(sizeof(bool) * OFFLINE_BATCH_SIZE);
+    ResultSink* out = current_output(false);
+    if (batch_data == NULL || batch == NULL || scores == NULL || anomalies == NULL || out == NULL) {
+        perror("Error: Memory allocation failed for offline scoring batch");
+        free(batch_data);
+        free(batch);
+        free(scores);
+        free(anomalies);
+        close_stream();
+        return;
+    }
+    for (int i = 0; i < OFFLINE_BATCH_SIZE; i++) {
+        batch[i].features = batch_data + (size_t)i * sw->num_features;
+    }
+
+    if (forest_is_trained(forest)) {
+        result_sink_printf(out, "Model preloaded. Scoring the whole stream...\n");
+    } else {
+        // Fill the training window
+        while (sw->current_size < sw->capacity && below_limit(iteration, max_iterations)) {
+            ReadStatus status = get_next_point_from_stream(&batch[0]);
+            iteration++;
+            if (status == READ_EOF) {
+                break;
+            }
+            if (!is_usable_point(status, &batch[0])) {
+                continue;
+            }
+            slide_window(sw, &batch[0]);
+            points_processed++;
+        }
+
+        if (sw->current_size < sw->capacity) {
+            result_sink_printf(out, "Stream ended before window filled (%d/%d).\n", sw->current_size, sw->capacity);
+            result_sink_flush(out);
+            free(batch_data);
+            free(batch);
+            free(scores);
+            free(anomalies);
+            close_stream();
+            return;
+        }
+
+        result_sink_printf(out, "Window filled with %ld points. Training static IForest model...\n", points_processed);
+        METRICS_TIMER(train_timer);
+        train_iforest(forest, &sw->columns, sw->capacity);
+        METRICS_STOP(STAGE_TRAIN, train_timer);
+        METRICS_COUNT(COUNTER_RETRAINS);
+    }
+
+    result_sink_printf(out, "--- Starting Offline Scoring (no drift adaptation) ---\n");
+
+    // Without drift detectors, a score is only needed for a point that is written: unless
+    // every point is, the batch is classified and only flagged points get an exact score
+    SinkVerbosity verbosity = result_sink_verbosity(out);
+
+    // Read the rest of the stream in batches and score each batch tree-major
+    bool end_of_stream = false;
+    while (!end_of_stream && below_limit(iteration, max_iterations)) {
+        int count = 0;
+        while (count < OFFLINE_BATCH_SIZE && below_limit(iteration, max_iterations)) {
+            METRICS_TIMER(parse_timer);
+            ReadStatus status = get_next_point_from_stream(&batch[count]);
+            METRICS_STOP(STAGE_PARSE, parse_timer);
+            iteration++;
+            if (status == READ_EOF) {
+                end_of_stream = true;
+                break;
+            }
+            if (is_usable_point(status, &batch[count])) {
+                count++;
+            }
+        }
+
+        METRICS_TIMER(score_timer);
+        if (verbosity == SINK_VERBOSITY_ALL) {
+            calculate_score_batch(forest, batch, count, forest->sample_size, scores);
+            for (int i = 0; i < count; i++) {
+                anomalies[i] = scores[i] >= sw->anomaly_threshold;
+            }
+        } else {
+            classify_batch(forest, batch, count, forest->sample_size, sw->anomaly_threshold, anomalies);
+            for (int i = 0; i < count; i++) {
+                scores[i] = (anomalies[i] && verbosity == SINK_VERBOSITY_ANOMALIES)
+                          ? calculate_score(forest, &batch[i], forest->sample_size) : 0.0;
+            }
+        }
+        METRICS_STOP(STAGE_SCORE, score_timer); // One sample per batch
+        METRICS_ADD(COUNTER_POINTS, count);
+        METRICS_TICK();
+        for (int i = 0; i < count; i++) {
+            result_sink_point(out, 0, points_processed, scores[i], anomalies[i]);
+            points_processed++;
+        }
+    }
+
+    free(batch_data);
+    free(batch);
+    free(scores);
+    free(anomalies);
+    close_stream();
+    result_sink_printf(out, "Total points processed: %ld\n", points_processed);
+    result_sink_flush(out);
+}
+
+void process_keyed_stream(const IForestConfig* config, struct ThreadPool* pool, long max_records) {
+    // Each record is an integer key column followed by D features; keys are parsed as
+    // integers so that 64-bit IDs stay distinct, the features in double before the batch stores them
+    double* record = (double*)malloc(sizeof(double) * (size_t)config->num_features);
+    feature_t* batch_data = (feature_t*)malloc(sizeof(feature_t) * KEYED_BATCH_SIZE * (size_t)config->num_features);
+    DataPoint* batch = (DataPoint*)malloc(sizeof(DataPoint) * KEYED_BATCH_SIZE);
+    uint64_t* keys = (uint64_t*)malloc(sizeof(uint64_t) * KEYED_BATCH_SIZE);
+    StreamRecordResult* results = (StreamRecordResult*)malloc(sizeof(StreamRecordResult) * KEYED_BATCH_SIZE);
+    StreamEngine* engine = stream_engine_create(config, pool);
+    ResultSink* out = current_output(true);
+    if (record == NULL || batch_data == NULL || batch == NULL || keys == NULL || results == NULL || engine == NULL || out == NULL) {
+        perror("Error: Memory allocation failed for keyed stream processing");
+        free(record);
+        free(batch_data);
+        free(batch);
+        free(keys);
+        free(results);
+        stream_engine_destroy(engine);
+        close_stream();
+        return;
+    }
+    for (int i = 0; i < KEYED_BATCH_SIZE; i++) {
+        batch[i].features = batch_data + (size_t)i * config->num_features;
+    }
+
+    result_sink_printf(out, "--- Starting Keyed Stream Processing (one window and forest per key, W=%d) ---\n", config->window_size);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // Thousands of keys each need W records before their first score, so by default
+    // a keyed stream is read to its end rather than to a fixed record count
+    long iteration = 0;
+    long points_processed = 0;
+    bool end_of_stream = false;
+    while (!end_of_stream && below_limit(iteration, max_records)) {
+        int count = 0;
+        while (count < KEYED_BATCH_SIZE && below_limit(iteration, max_records)) {
+            METRICS_TIMER(parse_timer);
+            ReadStatus status = stream_reader_next_keyed(stream_reader, &keys[count], record, config->num_features);
+            METRICS_STOP(STAGE_PARSE, parse_timer);
+            iteration++;
+            if (status == READ_EOF) {
+                end_of_stream = true;
+                break;
+            }
+            if (status != READ_OK) {
+                if (status == READ_ERROR) METRICS_COUNT(COUNTER_PARSE_FAILURES);
+                continue;
+            }
+            for (int j = 0; j < config->num_features; j++) {
+                batch[count].features[j] = (feature_t)record[j];
+            }
+            count++;
+        }
+
+        if (stream_engine_process(engine, keys, batch, count, results) < 0) {
+            break;
+        }
+        METRICS_TICK();
+        for (int i = 0; i < count; i++) {
+            const StreamRecordResult* r = &results[i];
+            if (!r->scored) continue;
+            result_sink_point(out, keys[i], r->point, r->score, r->score >= config->anomaly_threshold);
+            if (r->drift) {
+                result_sink_printf(out, ">>> Stream %llu: DRIFT DETECTED — Retraining...\n", (unsigned long long)keys[i]);
+            }
+        }
+        points_processed += count;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    StreamEngineStats stats = stream_engine_stats(engine);
+    result_sink_printf(out, "Total points processed: %ld in %d streams (%ld retrains, %ld anomalies)\n",
+           points_processed, stats.streams, stats.retrains, stats.anomalies);
+    if (stats.streams > 0) {
+        result_sink_printf(out, "Memory: %.1f KiB per stream, %.1f MiB in total\n",
+               (double)stats.stream_bytes / stats.streams / 1024.0,
+               (double)(stats.stream_bytes + stats.engine_bytes) / (1024.0 * 1024.0));
+    }
+    if (seconds > 0.0) {
+        result_sink_printf(out, "Throughput: %.0f points/s\n", (double)points_processed / seconds);
+    }
+
+    result_sink_flush(out);
+
+    free(record);
+    free(batch_data);
+    free(batch);
+    free(keys);
+    free(results);
+    stream_engine_destroy(engine);
+    close_stream();
+}
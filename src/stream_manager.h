@@ -2,47 +2,205 @@
 #define STREAM_MANAGER_H
 
 #include "core_ds.h"  // For SlidingWindow, DataPoint, IsolationForest
+#include "result_sink.h" // For SinkFormat, SinkVerbosity
+#include "hstree.h"   // For HalfSpaceForest
+#include "stream_reader.h" // For ReadStatus
 #include <stdbool.h>  // For bool type
 
 // --- Stream Interface (Simulation) ---
 
 /**
- * @brief Placeholder function to simulate reading the next DataPoint from the stream.
- * In the final implementation, this will read from your file or network connection.
- * @return The next DataPoint object.
+ * @brief Opens a delimited text stream (memory-mapped when possible) and consumes its header line.
+ * Binary streams written by stream_convert are detected and mapped without parsing.
+ * @param filename Path of the stream data file.
+ * @return true on success, false if the file cannot be opened.
  */
-DataPoint get_next_point_from_stream();
+bool open_stream(const char* filename);
+
+/**
+ * @brief Closes the stream opened by open_stream (safe to call repeatedly).
+ */
+void close_stream();
+
+/**
+ * @brief Returns the number of columns in the stream's header line (0 if unknown).
+ */
+int stream_header_columns();
+
+/**
+ * @brief Sets how many feature values are parsed from each data line.
+ * @param num_features The stream dimensionality (D).
+ */
+void set_stream_num_features(int num_features);
+
+/**
+ * @brief Sends the scored points and status lines of the process_* functions to a
+ * buffered result sink written by its own thread (see result_sink.h). Without this call,
+ * the first process_* call opens the default: every point as text on stdout.
+ * Each process_* call flushes the sink before returning; the sink is also closed
+ * (flushed) at exit.
+ * @param path Output file, or NULL for stdout.
+ * @param format Text, CSV or binary records.
+ * @param verbosity All points, anomalies only, or none.
+ * @param keyed true for process_keyed_stream output (records carry the stream key).
+ * @return true on success, false if the file cannot be opened.
+ */
+bool open_output(const char* path, SinkFormat format, SinkVerbosity verbosity, bool keyed);
+
+/**
+ * @brief Writes out and closes the sink opened by open_output (safe to call repeatedly).
+ */
+void close_output();
+
+/**
+ * @brief Reads the next DataPoint from the stream into caller-provided storage.
+ * The delimiter (tab, comma, semicolon or whitespace) is detected from the header;
+ * parse errors are reported on stderr with their line number.
+ * @param point Receives the parsed features (typically window_staging_point(sw));
+ * unspecified unless READ_OK is returned.
+ * @return READ_OK, READ_EOF (also when no stream is open) or READ_ERROR (the line is
+ * reported and counted; the caller skips it and reads on).
+ */
+ReadStatus get_next_point_from_stream(DataPoint* point);
 
 
 // --- Sliding Window Management ---
 
+/**
+ * @brief Returns the window's spare row, into which the next point can be read directly.
+ * Passing it to slide_window inserts it without copying. The returned view changes
+ * after every insertion.
+ * @param sw The SlidingWindow structure.
+ */
+DataPoint* window_staging_point(SlidingWindow* sw);
+
 /**
  * @brief Inserts a new DataPoint into the Sliding Window, potentially evicting the oldest point.
- * Implements the circular buffer logic.
+ * Implements the circular buffer logic. A staged point (see window_staging_point) is
+ * inserted by swapping row views; any other point is copied. Its features are also written
+ * into the slot's position in the training columns (sw->columns). The evicted point's cached score is removed
+ * from the window's anomaly count; the new slot stays unscored until
+ * set_window_score is called for it.
  * @param sw The SlidingWindow structure.
  * @param new_point The incoming data point.
+ * @return The buffer slot the point was written to.
+ */
+int slide_window(SlidingWindow* sw, const DataPoint* new_point);
+
+/**
+ * @brief Caches the score of a window slot and updates the running anomaly count.
+ * @param sw The SlidingWindow structure.
+ * @param slot The buffer slot that was scored (as returned by slide_window).
+ * @param score The slot's anomaly score under the current model.
+ */
+void set_window_score(SlidingWindow* sw, int slot, double score);
+
+/**
+ * @brief Scores a window slot under the current model and caches its score and path-length sum.
+ * The score equals calculate_score for the slot's point.
+ * @param forest The current IsolationForest model.
+ * @param sw The SlidingWindow structure.
+ * @param slot The buffer slot to score (as returned by slide_window).
+ * @return The slot's anomaly score.
  */
-void slide_window(SlidingWindow* sw, DataPoint new_point);
+double score_window_slot(const IsolationForest* forest, SlidingWindow* sw, int slot);
 
 
 // --- IForestASD Logic ---
 
 /**
- * @brief Evaluates the current anomaly rate within the full Sliding Window.
- * Scores every point in the window and counts how many exceed the ANOMALY_THRESHOLD.
+ * @brief Rescores every point in the window and rebuilds the score cache.
+ * Must be called whenever the whole model changes (i.e. after train_iforest).
+ * @param forest The current IsolationForest model.
+ * @param sw The current SlidingWindow data.
+ */
+void rescore_window(const IsolationForest* forest, SlidingWindow* sw);
+
+/**
+ * @brief Rolling update: replaces the k oldest trees from the full window and
+ * refreshes the score cache incrementally.
+ * Only the replaced trees are walked, before and after the rebuild, and their
+ * contributions are swapped in each slot's cached path-length sum, so the work
+ * per update is bounded by k tree builds plus 2k window walks.
  * @param forest The current IsolationForest model.
+ * @param sw The current (full) SlidingWindow data.
+ * @param k Number of trees to replace (k >= T retrains and rescores everything).
+ * @return The number of trees replaced.
+ */
+int rolling_update_window(IsolationForest* forest, SlidingWindow* sw, int k);
+
+/**
+ * @brief Rebuilds the score cache for a model built from an earlier snapshot of the window.
+ * Slots unchanged since the snapshot take the precomputed sums; only the points inserted
+ * since then are walked through the new model.
+ * @param forest The newly published model.
+ * @param sw The current SlidingWindow data.
+ * @param snapshot_path_sums Path-length sums of the snapshot's slots under forest.
+ * @param snapshot_inserted sw->total_inserted when the snapshot was taken.
+ */
+void adopt_window_scores(const IsolationForest* forest, SlidingWindow* sw,
+                         const double* snapshot_path_sums, long snapshot_inserted);
+
+/**
+ * @brief Evaluates the current anomaly rate within the full Sliding Window.
+ * Uses the running count of cached scores that reach the anomaly threshold, so it is O(1).
  * @param sw The current SlidingWindow data.
  * @return The calculated anomaly rate (e.g., 0.05 for 5%).
  */
-double evaluate_window_anomaly_rate(IsolationForest* forest, SlidingWindow* sw);
+double evaluate_window_anomaly_rate(const SlidingWindow* sw);
 
 /**
  * @brief The main loop that simulates stream processing, scoring, and drift detection.
+ * If the forest is already trained (loaded with load_forest), points are scored from
+ * the first one and the initial training is skipped; retraining waits for a full window.
+ * With config->rolling_trees = k > 0, each model update (on drift, or every
+ * config->rolling_interval points) replaces only the k oldest trees instead of
+ * retraining the whole forest. With config->async_retrain, full retrains run on a
+ * background thread (see async_trainer.h) while the current model keeps scoring.
+ * With config->pipeline, a reader thread parses ahead into a bounded lock-free ring, so
+ * together with the sink's writer thread this one only slides, scores and detects
+ * drift; the output is the same, in the same order.
  * @param forest The IsolationForest model.
  * @param sw The SlidingWindow structure.
- * @param desired_u The desired anomaly rate (u) for the drift heuristic.
- * @param max_iterations Maximum points to process before stopping (for testing).
+ * @param config The drift threshold (u) and rolling-update settings.
+ * @param max_iterations Maximum points to read before stopping (0: read to the end of the stream).
+ */
+void process_stream(IsolationForest* forest, SlidingWindow* sw, const IForestConfig* config, long max_iterations);
+
+/**
+ * @brief Scores a stream offline: trains once on the first W points, then scores the
+ * remainder in batches with calculate_score_batch (no drift detection or retraining).
+ * An already trained (loaded) forest scores the whole stream without training.
+ * @param forest The IsolationForest model.
+ * @param sw The SlidingWindow structure used for the training window.
+ * @param max_iterations Maximum points to read before stopping (0: read to the end of the stream).
+ */
+void score_stream_offline(IsolationForest* forest, SlidingWindow* sw, long max_iterations);
+
+/**
+ * @brief Processes a stream with Half-Space Trees instead of IForestASD (see hstree.h).
+ * The first W points fill the window and set the trees' work space; every later point
+ * is scored and added to the model in one pass, so there is no drift detection and no
+ * retraining. With config->pipeline, a reader thread parses ahead as in process_stream.
+ * @param forest The (unbuilt) HalfSpaceForest.
+ * @param sw The SlidingWindow that collects the first W points.
+ * @param config The anomaly threshold and pipeline setting.
+ * @param max_iterations Maximum points to read before stopping (0: read to the end of the stream).
+ */
+void process_hst_stream(HalfSpaceForest* forest, SlidingWindow* sw, const IForestConfig* config, long max_iterations);
+
+struct ThreadPool; // Defined in thread_pool.h
+
+/**
+ * @brief Processes a keyed stream: the first column of every record is a non-negative
+ * integer stream key, followed by D features. Each key gets its own window, forest and
+ * drift detectors in a StreamEngine (see stream_engine.h); records are routed in batches
+ * and the streams of a batch run in parallel on the pool. Call
+ * set_stream_num_features(D + 1) first. Ends with the per-stream memory and throughput.
+ * @param config Dimensions and thresholds of every stream.
+ * @param pool Worker pool shared by all streams (NULL runs them serially).
+ * @param max_records Maximum records to read before stopping (0: read to the end of the stream).
  */
-void process_stream(IsolationForest* forest, SlidingWindow* sw, double desired_u, int max_iterations);
+void process_keyed_stream(const IForestConfig* config, struct ThreadPool* pool, long max_records);
 
 #endif // STREAM_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,610 @@
+#define _POSIX_C_SOURCE 200809L // For fstat, mmap, posix_madvise
+
+#include "stream_reader.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define READ_CHUNK_SIZE (1 << 20)  // Buffered mode: bytes requested per read()
+#define MAX_NUMBER_LENGTH 128      // Longest token handed to the strtod fallback
+
+// Exact powers of ten representable as doubles (Clinger's fast path)
+static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// --- Input Management ---
+
+/**
+ * Buffered mode: makes sure a complete line (or the end of input) is available
+ * from reader->pos, moving the unread tail to the front and reading more as needed.
+ */
+static void ensure_line_available(StreamReader* reader) {
+    if (reader->mapped) {
+        return;
+    }
+    for (;;) {
+        const char* start = reader->data + reader->pos;
+        size_t available = reader->size - reader->pos;
+        if (memchr(start, '\n', available) != NULL || reader->input_exhausted) {
+            return;
+        }
+
+        // Compact the unread bytes, growing the buffer for very long lines
+        memmove(reader->buffer, start, available);
+        reader->pos = 0;
+        reader->size = available;
+        if (reader->buffer_capacity - reader->size < READ_CHUNK_SIZE / 2) {
+            size_t capacity = reader->buffer_capacity * 2;
+            char* grown = (char*)realloc(reader->buffer, capacity);
+            if (grown == NULL) {
+                perror("Error: Memory allocation failed for stream buffer");
+                reader->input_exhausted = true;
+                return;
+            }
+            reader->buffer = grown;
+            reader->buffer_capacity = capacity;
+        }
+        reader->data = reader->buffer;
+
+        ssize_t got = read(reader->fd, reader->buffer + reader->size, reader->buffer_capacity - reader->size);
+        if (got <= 0) {
+            if (got < 0) {
+                perror("Error reading data stream");
+            }
+            reader->input_exhausted = true;
+        } else {
+            reader->size += (size_t)got;
+        }
+    }
+}
+
+/**
+ * Returns the end of the line starting at reader->pos (its '\n' or the end of data).
+ */
+static const char* current_line_end(StreamReader* reader) {
+    ensure_line_available(reader);
+    const char* start = reader->data + reader->pos;
+    const char* newline = (const char*)memchr(start, '\n', reader->size - reader->pos);
+    return (newline != NULL) ? newline : reader->data + reader->size;
+}
+
+/**
+ * Moves past the line ending at line_end.
+ */
+static void advance_past(StreamReader* reader, const char* line_end) {
+    size_t next = (size_t)(line_end - reader->data);
+    reader->pos = (next < reader->size) ? next + 1 : reader->size;
+    reader->line_number++;
+}
+
+// --- Headers ---
+
+static char* copy_name(const char* start, size_t length) {
+    char* name = (char*)malloc(length + 1);
+    if (name != NULL) {
+        memcpy(name, start, length);
+        name[length] = '\0';
+    }
+    return name;
+}
+
+/**
+ * Splits the text header [start, end) on the detected delimiter into
+ * reader->column_names, trimming surrounding blanks.
+ */
+static bool split_header(StreamReader* reader, const char* start, const char* end) {
+    if (end > start && end[-1] == '\r') {
+        end--;
+    }
+    int capacity = 16;
+    reader->column_names = (char**)malloc(sizeof(char*) * (size_t)capacity);
+    if (reader->column_names == NULL) {
+        perror("Error: Memory allocation failed for column names");
+        return false;
+    }
+
+    const char* p = start;
+    for (;;) {
+        const char* field_end;
+        if (reader->delimiter == ' ') {
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (p == end) break;
+            field_end = p;
+            while (field_end < end && *field_end != ' ' && *field_end != '\t') field_end++;
+        } else {
+            field_end = (const char*)memchr(p, reader->delimiter, (size_t)(end - p));
+            if (field_end == NULL) field_end = end;
+        }
+
+        const char* name = p;
+        const char* name_end = field_end;
+        while (name < name_end && (*name == ' ' || *name == '\t')) name++;
+        while (name_end > name && (name_end[-1] == ' ' || name_end[-1] == '\t')) name_end--;
+
+        if (reader->header_columns == capacity) {
+            capacity *= 2;
+            char** grown = (char**)realloc(reader->column_names, sizeof(char*) * (size_t)capacity);
+            if (grown == NULL) {
+                perror("Error: Memory allocation failed for column names");
+                return false;
+            }
+            reader->column_names = grown;
+        }
+        reader->column_names[reader->header_columns] = copy_name(name, (size_t)(name_end - name));
+        if (reader->column_names[reader->header_columns] == NULL) {
+            perror("Error: Memory allocation failed for column names");
+            return false;
+        }
+        reader->header_columns++;
+
+        if (field_end == end) break;
+        p = (reader->delimiter == ' ') ? field_end : field_end + 1;
+    }
+    return true;
+}
+
+/**
+ * Validates a mapped binary stream's header and positions the reader at its first record.
+ */
+static bool open_binary_stream(StreamReader* reader) {
+    BinaryStreamHeader header;
+    if (reader->size < sizeof(header)) {
+        fprintf(stderr, "Error: Binary stream '%s' is truncated.\n", reader->path);
+        return false;
+    }
+    memcpy(&header, reader->data, sizeof(header));
+
+    size_t width = (header.dtype == STREAM_DTYPE_FLOAT32) ? sizeof(float) : sizeof(double);
+    if (header.version != BINARY_STREAM_VERSION ||
+        (header.dtype != STREAM_DTYPE_FLOAT32 && header.dtype != STREAM_DTYPE_FLOAT64) ||
+        header.num_features == 0 || header.num_features > INT32_MAX || header.block_rows == 0 ||
+        header.data_offset < sizeof(header) + header.names_size || header.data_offset > reader->size) {
+        fprintf(stderr, "Error: Unsupported or corrupt binary stream header in '%s'.\n", reader->path);
+        return false;
+    }
+    size_t record_bytes = width * header.num_features;
+    if (header.num_records > (reader->size - header.data_offset) / record_bytes) {
+        fprintf(stderr, "Error: Binary stream '%s' is truncated (%llu records declared).\n",
+                reader->path, (unsigned long long)header.num_records);
+        return false;
+    }
+
+    reader->binary = true;
+    reader->dtype = (StreamDType)header.dtype;
+    reader->block_rows = header.block_rows;
+    reader->num_records = header.num_records;
+    reader->records = (const unsigned char*)reader->data + header.data_offset;
+
+    // Feature names: NUL-terminated strings; missing names default to their column number
+    reader->column_names = (char**)calloc(header.num_features, sizeof(char*));
+    if (reader->column_names == NULL) {
+        perror("Error: Memory allocation failed for column names");
+        return false;
+    }
+    reader->header_columns = (int)header.num_features;
+    const char* names = reader->data + sizeof(header);
+    const char* names_end = names + header.names_size;
+    for (int i = 0; i < reader->header_columns; i++) {
+        const char* terminator = (names < names_end) ? (const char*)memchr(names, '\0', (size_t)(names_end - names)) : NULL;
+        if (terminator != NULL) {
+            reader->column_names[i] = copy_name(names, (size_t)(terminator - names));
+            names = terminator + 1;
+        } else {
+            char fallback[32];
+            snprintf(fallback, sizeof(fallback), "V%d", i + 1);
+            reader->column_names[i] = copy_name(fallback, strlen(fallback));
+        }
+        if (reader->column_names[i] == NULL) {
+            perror("Error: Memory allocation failed for column names");
+            return false;
+        }
+    }
+
+    fprintf(stderr, "Binary stream: %d features (%s), %llu records, %llu rows per block\n",
+            reader->header_columns, (reader->dtype == STREAM_DTYPE_FLOAT32) ? "float32" : "float64",
+            (unsigned long long)reader->num_records, (unsigned long long)reader->block_rows);
+    return true;
+}
+
+StreamReader* stream_reader_open(const char* path) {
+    StreamReader* reader = (StreamReader*)calloc(1, sizeof(StreamReader));
+    if (reader == NULL) {
+        perror("Error: Memory allocation failed for StreamReader");
+        return NULL;
+    }
+    reader->path = path;
+    reader->fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+    if (reader->fd < 0) {
+        perror("Error opening data stream file");
+        free(reader);
+        return NULL;
+    }
+
+    // 1. Map regular files; fall back to buffered reads for pipes and empty files
+    struct stat info;
+    if (fstat(reader->fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+            reader->mapped = true;
+            reader->data = (const char*)map;
+            reader->size = (size_t)info.st_size;
+        }
+    }
+    if (!reader->mapped) {
+        reader->buffer_capacity = 2 * READ_CHUNK_SIZE;
+        reader->buffer = (char*)malloc(reader->buffer_capacity);
+        if (reader->buffer == NULL) {
+            perror("Error: Memory allocation failed for stream buffer");
+            stream_reader_close(reader);
+            return NULL;
+        }
+        reader->data = reader->buffer;
+    }
+
+    // 2. Binary streams carry their own header; everything else is delimited text
+    const char* start = reader->data + reader->pos;
+    const char* end = current_line_end(reader);
+    start = reader->data + reader->pos; // The buffer may have moved
+    if (reader->size - reader->pos >= sizeof(BINARY_STREAM_MAGIC) - 1 &&
+        memcmp(start, BINARY_STREAM_MAGIC, sizeof(BINARY_STREAM_MAGIC) - 1) == 0) {
+        if (!reader->mapped || !open_binary_stream(reader)) {
+            if (!reader->mapped) {
+                fprintf(stderr, "Error: Binary stream '%s' must be a regular file.\n", path);
+            }
+            stream_reader_close(reader);
+            return NULL;
+        }
+        return reader;
+    }
+
+    // 3. Consume the header and detect the delimiter from it
+    if (start == end && reader->pos >= reader->size) {
+        fprintf(stderr, "Error: Could not read header line.\n");
+        return reader; // Empty stream: reads will report end of stream
+    }
+    fprintf(stderr, "Header skipped: %.*s\n", (int)(end - start), start);
+
+    int tabs = 0, commas = 0, semicolons = 0;
+    for (const char* p = start; p < end; p++) {
+        tabs += (*p == '\t');
+        commas += (*p == ',');
+        semicolons += (*p == ';');
+    }
+    if (tabs > 0 && tabs >= commas && tabs >= semicolons) {
+        reader->delimiter = '\t';
+    } else if (commas > 0 && commas >= semicolons) {
+        reader->delimiter = ',';
+    } else if (semicolons > 0) {
+        reader->delimiter = ';';
+    } else {
+        reader->delimiter = ' ';
+    }
+    if (!split_header(reader, start, end)) {
+        stream_reader_close(reader);
+        return NULL;
+    }
+    advance_past(reader, end);
+    return reader;
+}
+
+void stream_reader_close(StreamReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+    if (reader->mapped) {
+        munmap((void*)reader->data, reader->size);
+    }
+    free(reader->buffer);
+    if (reader->column_names != NULL) {
+        for (int i = 0; i < reader->header_columns; i++) {
+            free(reader->column_names[i]);
+        }
+        free(reader->column_names);
+    }
+    if (reader->fd >= 0 && reader->fd != STDIN_FILENO) {
+        close(reader->fd);
+    }
+    free(reader);
+}
+
+// --- Number Parsing ---
+
+/**
+ * Parses a decimal floating-point number in [p, end).
+ * Numbers with at most 19 significant digits and a decimal exponent within
+ * ±22 are converted exactly with one multiplication or division (Clinger's fast
+ * path, correctly rounded like strtod); anything else falls back to strtod.
+ * @return The position after the number, or NULL if no number starts at p.
+ */
+static const char* parse_double(const char* p, const char* end, double* out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;       // Significant digits accumulated in mantissa
+    int exponent = 0;     // Decimal exponent applied to mantissa
+    bool any_digit = false;
+    bool exact = true;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        any_digit = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += (mantissa != 0);
+        } else {
+            exponent++;
+            exact = false;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            any_digit = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += (mantissa != 0);
+                exponent--;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (any_digit && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exponent_negative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exponent_negative = (*q == '-');
+            q++;
+        }
+        if (q < end && *q >= '0' && *q <= '9') {
+            int value = 0;
+            for (; q < end && *q >= '0' && *q <= '9'; q++) {
+                if (value < 100000) value = value * 10 + (*q - '0');
+            }
+            exponent += exponent_negative ? -value : value;
+            p = q;
+        }
+    }
+
+    if (any_digit && exact && mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        value = (exponent < 0) ? value / POWERS_OF_TEN[-exponent] : value * POWERS_OF_TEN[exponent];
+        *out = negative ? -value : value;
+        return p;
+    }
+
+    // Slow path: long mantissas, large exponents, nan/inf, ...
+    char token[MAX_NUMBER_LENGTH];
+    size_t length = 0;
+    for (const char* q = start; q < end && length < MAX_NUMBER_LENGTH - 1; q++) {
+        if (*q == ',' || *q == '\t' || *q == ';' || *q == ' ' || *q == '\r' || *q == '\n') break;
+        token[length++] = *q;
+    }
+    token[length] = '\0';
+    char* token_end = NULL;
+    double value = strtod(token, &token_end);
+    if (token_end == token) {
+        return NULL;
+    }
+    *out = value;
+    return start + (token_end - token);
+}
+
+// --- Record Parsing ---
+
+static bool is_blank_line(const char* p, const char* end) {
+    for (; p < end; p++) {
+        if (*p != ' ' && *p != '\t' && *p != '\r') return false;
+    }
+    return true;
+}
+
+/**
+ * Parses a stream key: an unsigned decimal integer filling the whole field [p, end)
+ * up to the next delimiter or blank.
+ * @return The position after the key, or NULL if the field is not an integer in [0, 2^64).
+ */
+static const char* parse_key(const char* p, const char* end, uint64_t* out) {
+    char token[MAX_NUMBER_LENGTH];
+    size_t length = 0;
+    for (const char* q = p; q < end; q++) {
+        if (*q == ',' || *q == '\t' || *q == ';' || *q == ' ' || *q == '\r' || *q == '\n') break;
+        if (length == MAX_NUMBER_LENGTH - 1) return NULL;
+        token[length++] = *q;
+    }
+    token[length] = '\0';
+    if (length == 0 || token[0] < '0' || token[0] > '9') {
+        return NULL; // strtoull would accept signs and leading blanks
+    }
+    char* token_end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(token, &token_end, 10);
+    if (token_end != token + length || errno == ERANGE) {
+        return NULL;
+    }
+    *out = (uint64_t)value;
+    return p + length;
+}
+
+/**
+ * Converts a binary stream's key value, which must be a non-negative integer below
+ * 2^24 (float32) or 2^53 (float64); from there on, neighbouring keys may already
+ * have been rounded onto the same value.
+ */
+static bool key_from_value(double value, StreamDType dtype, uint64_t* out) {
+    double limit = (dtype == STREAM_DTYPE_FLOAT32) ? 16777216.0 : 9007199254740992.0;
+    if (!(value >= 0.0 && value < limit) || (double)(uint64_t)value != value) {
+        return false;
+    }
+    *out = (uint64_t)value;
+    return true;
+}
+
+/**
+ * Copies binary record reader->next_record into features (or, when features is NULL,
+ * into narrow), converting between float32 and float64 as needed. With a key
+ * destination, column 0 is the key and the features follow it.
+ */
+static ReadStatus next_binary_record(StreamReader* reader, uint64_t* key, double* features, float* narrow, int num_features) {
+    if (reader->next_record >= reader->num_records) {
+        return READ_EOF;
+    }
+    uint64_t record = reader->next_record++;
+    reader->line_number = (long)(record + 1);
+    int first_column = (key != NULL) ? 1 : 0;
+    if (num_features + first_column > reader->header_columns) {
+        fprintf(stderr, "Parse Error (%s: record %ld): expected %d features, got %d.\n",
+                reader->path, reader->line_number, num_features, reader->header_columns - first_column);
+        return READ_ERROR;
+    }
+
+    // Locate the record's block; within it, feature j of row r is at j * rows_in_block + r
+    size_t width = (reader->dtype == STREAM_DTYPE_FLOAT32) ? sizeof(float) : sizeof(double);
+    uint64_t block = record / reader->block_rows;
+    uint64_t row = record % reader->block_rows;
+    uint64_t first = block * reader->block_rows;
+    uint64_t rows_in_block = (reader->num_records - first < reader->block_rows) ? reader->num_records - first : reader->block_rows;
+    const unsigned char* base = reader->records + (size_t)(first * (uint64_t)reader->header_columns * width);
+    if (key != NULL) {
+        double value;
+        if (reader->dtype == STREAM_DTYPE_FLOAT32) {
+            float narrow_value;
+            memcpy(&narrow_value, base + (size_t)row * width, sizeof(float));
+            value = (double)narrow_value;
+        } else {
+            memcpy(&value, base + (size_t)row * width, sizeof(double));
+        }
+        if (!key_from_value(value, reader->dtype, key)) {
+            fprintf(stderr, "Parse Error (%s: record %ld): stream key %.17g is not an exact non-negative integer.\n",
+                    reader->path, reader->line_number, value);
+            return READ_ERROR;
+        }
+        base += (size_t)(rows_in_block * width); // Skip the key column
+    }
+
+    bool same_type = (features != NULL) == (reader->dtype == STREAM_DTYPE_FLOAT64);
+    if (rows_in_block == 1 && same_type) {
+        memcpy((features != NULL) ? (void*)features : (void*)narrow, base, width * (size_t)num_features);
+    } else if (same_type) {
+        unsigned char* out = (features != NULL) ? (unsigned char*)features : (unsigned char*)narrow;
+        for (int j = 0; j < num_features; j++) {
+            memcpy(out + (size_t)j * width, base + (size_t)((uint64_t)j * rows_in_block + row) * width, width);
+        }
+    } else if (features != NULL) {
+        for (int j = 0; j < num_features; j++) {
+            float value;
+            memcpy(&value, base + (size_t)((uint64_t)j * rows_in_block + row) * sizeof(float), sizeof(float));
+            features[j] = (double)value;
+        }
+    } else {
+        for (int j = 0; j < num_features; j++) {
+            double value;
+            memcpy(&value, base + (size_t)((uint64_t)j * rows_in_block + row) * sizeof(double), sizeof(double));
+            narrow[j] = (float)value;
+        }
+    }
+    return READ_OK;
+}
+
+/**
+ * Parses the next record into features, or (when features is NULL) into narrow,
+ * after its leading key column when key is not NULL.
+ */
+static ReadStatus next_record(StreamReader* reader, uint64_t* key, double* features, float* narrow, int num_features) {
+    if (reader->binary) {
+        return next_binary_record(reader, key, features, narrow, num_features);
+    }
+    for (;;) {
+        const char* end = current_line_end(reader);
+        const char* p = reader->data + reader->pos;
+        if (p >= reader->data + reader->size) {
+            return READ_EOF;
+        }
+        advance_past(reader, end);
+        if (end > p && end[-1] == '\r') {
+            end--; // CRLF line ending
+        }
+        if (is_blank_line(p, end)) {
+            continue;
+        }
+
+        // Padding around fields: spaces, plus tabs unless tab is the delimiter
+        const char delimiter = reader->delimiter;
+        if (key != NULL) {
+            while (p < end && (*p == ' ' || (*p == '\t' && delimiter != '\t'))) p++;
+            const char* next = parse_key(p, end, key);
+            const char* q = next;
+            if (q != NULL) {
+                // Like a feature, the key must be followed by the delimiter, padding or the end of the line
+                while (q < end && (*q == ' ' || (*q == '\t' && delimiter != '\t'))) q++;
+                if (q < end && ((delimiter != ' ') ? *q != delimiter : q == next)) q = NULL;
+            }
+            if (q == NULL) {
+                const char* field_end = p;
+                while (field_end < end && ((delimiter != ' ') ? *field_end != delimiter : (*field_end != ' ' && *field_end != '\t'))) field_end++;
+                fprintf(stderr, "Parse Error (%s:%ld): invalid stream key '%.*s' (expected an integer in [0, 2^64)).\n",
+                        reader->path, reader->line_number, (int)(field_end - p), p);
+                return READ_ERROR;
+            }
+            p = (q < end && delimiter != ' ') ? q + 1 : q;
+        }
+        int parsed = 0;
+        while (parsed < num_features) {
+            while (p < end && (*p == ' ' || (*p == '\t' && delimiter != '\t'))) p++;
+            double value;
+            const char* next = (p < end) ? parse_double(p, end, &value) : NULL;
+            if (next == NULL) {
+                break;
+            }
+            if (features != NULL) {
+                features[parsed] = value;
+            } else {
+                narrow[parsed] = (float)value;
+            }
+            parsed++;
+            p = next;
+
+            // A number must be followed by the delimiter, padding or the end of the line
+            while (p < end && (*p == ' ' || (*p == '\t' && delimiter != '\t'))) p++;
+            if (p == end) {
+                continue;
+            }
+            if (delimiter != ' ') {
+                if (*p != delimiter) break;
+                p++;
+            } else if (p == next) {
+                break;
+            }
+        }
+        if (parsed != num_features) {
+            fprintf(stderr, "Parse Error (%s:%ld): expected %d features, got %d.\n",
+                    reader->path, reader->line_number, num_features, parsed);
+            return READ_ERROR;
+        }
+        return READ_OK;
+    }
+}
+
+ReadStatus stream_reader_next(StreamReader* reader, double* features, int num_features) {
+    return next_record(reader, NULL, features, NULL, num_features);
+}
+
+ReadStatus stream_reader_next_float(StreamReader* reader, float* features, int num_features) {
+    return next_record(reader, NULL, NULL, features, num_features);
+}
+
+ReadStatus stream_reader_next_keyed(StreamReader* reader, uint64_t* key, double* features, int num_features) {
+    return next_record(reader, key, features, NULL, num_features);
+}
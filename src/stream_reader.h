@@ -0,0 +1,126 @@
+#ifndef STREAM_READER_H
+#define STREAM_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Binary Stream Format ---
+
+#define BINARY_STREAM_MAGIC "IFSTREAM"   // First 8 bytes of every binary stream
+#define BINARY_STREAM_VERSION 1
+#define BINARY_STREAM_EXTENSION ".ifs"
+
+/**
+ * @brief Element type of a binary stream's feature values.
+ */
+typedef enum {
+    STREAM_DTYPE_FLOAT32 = 1,
+    STREAM_DTYPE_FLOAT64 = 2
+} StreamDType;
+
+/**
+ * @brief Fixed header at the start of a binary stream (native byte order).
+ * * It is followed by names_size bytes of NUL-terminated feature names and, from
+ * data_offset on, the records. Records are stored in blocks of block_rows rows;
+ * inside a block values are column-major (all rows of feature 0, then feature 1, ...).
+ * block_rows = 1 is plain fixed-width row records. The last block may be short.
+ */
+typedef struct {
+    char magic[8];          // BINARY_STREAM_MAGIC
+    uint32_t version;       // BINARY_STREAM_VERSION
+    uint32_t num_features;  // Values per record
+    uint32_t dtype;         // StreamDType
+    uint32_t block_rows;    // Rows per column block (1 = row-major records)
+    uint64_t num_records;   // Total records in the file
+    uint32_t names_size;    // Bytes of feature names following the header
+    uint32_t data_offset;   // File offset of the first block (8-byte aligned)
+} BinaryStreamHeader;
+
+// --- Stream Reader ---
+
+/**
+ * @brief Result of reading one record from a stream.
+ */
+typedef enum {
+    READ_OK = 0,     // A record was parsed into the destination
+    READ_EOF,        // No more records
+    READ_ERROR       // The current line could not be parsed (already reported with its line number)
+} ReadStatus;
+
+/**
+ * @brief Reads numeric records from a CSV/TSV file without copying lines, or
+ * from a binary stream (see BinaryStreamHeader) without any parsing.
+ * Regular files are memory-mapped and parsed in place; pipes and other
+ * non-mappable text inputs fall back to large buffered reads.
+ */
+typedef struct {
+    int fd;
+    bool mapped;            // true: data is an mmap of the whole file
+    const char* data;       // Mapped file, or the read buffer
+    size_t size;            // Bytes available in data
+    size_t pos;             // Parse position within data
+    char* buffer;           // Read buffer (buffered mode only)
+    size_t buffer_capacity;
+    bool input_exhausted;   // Buffered mode: read() reported end of input
+
+    char delimiter;         // Field separator detected from the header (' ' = any whitespace)
+    int header_columns;     // Number of columns in the header line
+    char** column_names;    // header_columns names from the header
+    long line_number;       // 1-based number of the last line (or binary record) consumed
+    const char* path;       // For error messages
+
+    bool binary;            // true: data is a binary stream (mapped)
+    StreamDType dtype;      // Binary streams: element type
+    uint64_t block_rows;    // Binary streams: rows per column block
+    uint64_t num_records;   // Binary streams: records in the file
+    uint64_t next_record;   // Binary streams: index of the next record to return
+    const unsigned char* records; // Binary streams: first block
+} StreamReader;
+
+/**
+ * @brief Opens a stream, consumes its header line and detects the delimiter
+ * (tab, comma or semicolon, whichever occurs most often in the header; otherwise whitespace).
+ * Files starting with BINARY_STREAM_MAGIC are opened as binary streams instead;
+ * those must be regular files, since they are consumed through mmap.
+ * @param path Path of the input file, or "-" for standard input.
+ * @return The reader, or NULL on failure.
+ */
+StreamReader* stream_reader_open(const char* path);
+
+/**
+ * @brief Closes the input and frees the reader.
+ */
+void stream_reader_close(StreamReader* reader);
+
+/**
+ * @brief Parses the next non-blank line (or binary record) into num_features doubles.
+ * * Fields beyond num_features are ignored. Values are written straight into the
+ * destination; on READ_ERROR its contents are unspecified.
+ * @param reader The stream.
+ * @param features Destination for num_features values.
+ * @param num_features Number of values to parse.
+ * @return READ_OK, READ_EOF or READ_ERROR.
+ */
+ReadStatus stream_reader_next(StreamReader* reader, double* features, int num_features);
+
+/**
+ * @brief Same as stream_reader_next, storing the values as float (float32 builds).
+ */
+ReadStatus stream_reader_next_float(StreamReader* reader, float* features, int num_features);
+
+/**
+ * @brief Parses the next record of a keyed stream: a key column followed by num_features values.
+ * * Text keys must be unsigned decimal integers below 2^64 and are parsed exactly;
+ * binary keys must be non-negative integers below 2^53 (float64) or 2^24 (float32),
+ * where the dtype still tells neighbouring keys apart. Any other key (fractional,
+ * negative, out of range) is a READ_ERROR.
+ * @param reader The stream.
+ * @param key Destination for the record's key.
+ * @param features Destination for num_features values.
+ * @param num_features Number of values to parse after the key.
+ * @return READ_OK, READ_EOF or READ_ERROR.
+ */
+ReadStatus stream_reader_next_keyed(StreamReader* reader, uint64_t* key, double* features, int num_features);
+
+#endif // STREAM_READER_H
@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L // For sysconf
+
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+struct ThreadPool {
+    pthread_t* workers;
+    int num_workers;            // Background threads (the submitting thread is one more)
+
+    pthread_mutex_t lock;
+    pthread_cond_t batch_ready; // Signalled when a new batch is published
+    pthread_cond_t batch_done;  // Signalled when the last worker leaves a batch
+
+    // Current batch (published under lock)
+    ThreadPoolTask task;
+    void* ctx;
+    int num_tasks;
+    unsigned long generation;   // Incremented for every batch
+    int busy_workers;           // Workers that have not finished the current batch
+    bool shutdown;
+
+    atomic_int next_task;       // Next unclaimed task index of the current batch
+};
+
+// --- Internal Helpers ---
+
+/**
+ * Claims and runs task indices until the current batch is exhausted.
+ */
+static void drain_batch(ThreadPool* pool, int worker_index) {
+    for (;;) {
+        int i = atomic_fetch_add_explicit(&pool->next_task, 1, memory_order_relaxed);
+        if (i >= pool->num_tasks) {
+            return;
+        }
+        pool->task(pool->ctx, i, worker_index);
+    }
+}
+
+typedef struct {
+    ThreadPool* pool;
+    int worker_index;
+} WorkerArgs;
+
+static void* worker_main(void* arg) {
+    WorkerArgs args = *(WorkerArgs*)arg;
+    free(arg);
+    ThreadPool* pool = args.pool;
+    unsigned long seen_generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen_generation) {
+            pthread_cond_wait(&pool->batch_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        drain_batch(pool, args.worker_index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy_workers == 0) {
+            pthread_cond_signal(&pool->batch_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// --- Pool Management ---
+
+ThreadPool* thread_pool_create(int num_threads) {
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (pool == NULL) {
+        perror("Error: Memory allocation failed for ThreadPool");
+        return NULL;
+    }
+    int num_workers = (num_threads > 1) ? num_threads - 1 : 0;
+    pool->workers = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)(num_workers > 0 ? num_workers : 1));
+    if (pool->workers == NULL) {
+        perror("Error: Memory allocation failed for ThreadPool workers");
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->batch_ready, NULL);
+    pthread_cond_init(&pool->batch_done, NULL);
+    atomic_init(&pool->next_task, 0);
+
+    // Worker indices 0..num_workers-1; the submitting thread uses index num_workers
+    for (int i = 0; i < num_workers; i++) {
+        WorkerArgs* args = (WorkerArgs*)malloc(sizeof(WorkerArgs));
+        if (args == NULL) {
+            perror("Error: Memory allocation failed for ThreadPool worker");
+            break;
+        }
+        args->pool = pool;
+        args->worker_index = i;
+        if (pthread_create(&pool->workers[i], NULL, worker_main, args) != 0) {
+            fprintf(stderr, "Error: Failed to start thread pool worker %d\n", i);
+            free(args);
+            break;
+        }
+        pool->num_workers++;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->batch_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    pthread_cond_destroy(&pool->batch_done);
+    pthread_cond_destroy(&pool->batch_ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+// --- Batch Execution ---
+
+void thread_pool_run(ThreadPool* pool, int num_tasks, ThreadPoolTask task, void* ctx) {
+    if (num_tasks <= 0) {
+        return;
+    }
+    if (pool == NULL || pool->num_workers == 0) {
+        for (int i = 0; i < num_tasks; i++) {
+            task(ctx, i, 0);
+        }
+        return;
+    }
+
+    // 1. Publish the batch and wake the workers
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->num_tasks = num_tasks;
+    atomic_store_explicit(&pool->next_task, 0, memory_order_relaxed);
+    pool->busy_workers = pool->num_workers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->batch_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    // 2. The submitting thread works on the batch too
+    drain_batch(pool, pool->num_workers);
+
+    // 3. Wait for the workers to finish their last claimed tasks
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy_workers > 0) {
+        pthread_cond_wait(&pool->batch_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int thread_pool_size(const ThreadPool* pool) {
+    return (pool == NULL) ? 1 : pool->num_workers + 1;
+}
+
+int thread_pool_default_size() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cores < 1) ? 1 : (int)cores;
+}
@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/**
+ * @brief A persistent pool of worker threads that runs indexed batches of tasks.
+ * Workers are created once and sleep between batches. Within a batch, every worker
+ * (and the submitting thread) repeatedly claims the next unprocessed task index from
+ * a shared atomic counter, so faster workers naturally take over remaining work.
+ */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Task callback: processes task number task_index on worker worker_index.
+ * worker_index is in [0, thread_pool_size(pool)) and is stable for the whole batch,
+ * so it can be used to select per-worker scratch state.
+ */
+typedef void (*ThreadPoolTask)(void* ctx, int task_index, int worker_index);
+
+/**
+ * @brief Creates a pool that executes batches on num_threads threads in total
+ * (num_threads - 1 background workers plus the submitting thread).
+ * @param num_threads Total parallelism; values <= 1 run every batch serially.
+ * @return The new pool, or NULL on failure.
+ */
+ThreadPool* thread_pool_create(int num_threads);
+
+/**
+ * @brief Stops and joins all workers and frees the pool.
+ */
+void thread_pool_destroy(ThreadPool* pool);
+
+/**
+ * @brief Runs task(ctx, i, worker) for every i in [0, num_tasks) and waits for completion.
+ * A NULL pool runs the tasks serially on the calling thread. Batches must not be
+ * submitted concurrently or from inside a task.
+ */
+void thread_pool_run(ThreadPool* pool, int num_tasks, ThreadPoolTask task, void* ctx);
+
+/**
+ * @brief Returns the total parallelism of the pool (1 for a NULL pool).
+ */
+int thread_pool_size(const ThreadPool* pool);
+
+/**
+ * @brief Returns the number of online CPU cores (at least 1).
+ */
+int thread_pool_default_size();
+
+#endif // THREAD_POOL_H
@@ -2,43 +2,28 @@
 #define UTILS_H
 
 #include "core_ds.h" // Needed for DataPoint structure
+#include "rng.h"     // For RngState and the global seed source
 
-// --- Randomization Functions ---
-
-/**
- * @brief Initializes the random number generator using the current time.
- */
-void initialize_rng();
-
-/**
- * @brief Generates a random integer within a specified range [min, max], inclusive.
- * @param min The minimum integer value.
- * @param max The maximum integer value.
- * @return A random integer.
- */
-int get_random_integer(int min, int max);
+// --- Sampling Functions ---
 
 /**
- * @brief Generates a random double-precision floating point number 
- * uniformly distributed within the specified range [min, max].
- * @param min The minimum double value.
- * @param max The maximum double value.
- * @return A random double.
+ * @brief Randomly selects a specified number of window positions (sample_size)
+ * without replacement. This is used to select the ψ points for building each
+ * iTree; the points themselves are never copied, trees are built on the indices.
+ * @param rng The random stream of the tree being built.
+ * @param window_size The current size of the source data (W).
+ * @param sample_indices Workspace of W entries; receives a permutation of the window
+ * positions whose first min(W, ψ) entries are the sample.
+ * @param sample_size The number of points to sample (ψ).
+ * @return The number of sampled indices (min(W, ψ)).
  */
-double get_random_uniform(double min, double max);
-
+int sample_data_stream(RngState* rng, int window_size, int* sample_indices, int sample_size);
 
-// --- Sampling Functions ---
+// --- Timing ---
 
 /**
- * @brief Randomly samples a specified number of data points (sample_size) 
- * from a larger dataset (window_data). This is used to select the ψ points 
- * for building each iTree.
- * @param window_data The source array of data points (size W).
- * @param window_size The current size of the source data (W).
- * @param sample_data The destination array to store the sampled points (size ψ).
- * @param sample_size The number of points to sample (ψ).
+ * @brief Reads the monotonic clock, in seconds from an arbitrary origin.
  */
-void sample_data_stream(DataPoint* window_data, int window_size, DataPoint* sample_data, int sample_size);
+double now_seconds(void);
 
 #endif // UTILS_H
\ No newline at end of file